@@ -0,0 +1,2489 @@
+#include "ht.h"
+#include "ht_generic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//	BENCHMARKS
+//	- ./ht_bench [options] runs the ops suite, or the suites named with
+//		--suite, and writes one row per operation measured
+//		- --format json|csv, json by default
+//		- --quick cuts every list below to a few values
+//		- lists are comma separated and replace the defaults
+//			- --hash-sizes 32,64,65,128,129,130
+//			- --key-lengths 8,16,64,256,1024
+//			- --sizes l1,l2,llc,10llc
+//			- --distributions uniform,zipf
+//			- --prefixes 0,1
+//			- --layouts chained,open,cuckoo
+//			- --threads 1,2,4,8,16,32,64
+//		- --hash-function name, --ops count, --llc bytes, --seed n
+//	- each case runs in a child process, so its peak RSS is its own and a
+//		case that runs out of memory only loses its own rows
+//	- ns_per_op is the whole loop's time over its operations, ops_per_s
+//		its inverse, one in SAMPLE operations is also timed alone for
+//		the percentiles, with the cost of reading the clock taken off
+//		- iterate and resize time whole calls, their percentiles are
+//			of those calls' time per entry
+//	- chain_max, chain_mean and chain_variance are the longest chain and
+//		the mean and variance of entries per bucket, only set by the
+//		hash-functions suite
+//	- sizes are the bytes the keys and entries of a table take, from the
+//		L1 data cache to ten times the last level cache, as the system
+//		reports them
+//	- suites
+//		- ops: every operation over every combination of the lists
+//		- layouts: the ops suite's operations on the chained, open and
+//			cuckoo layouts side by side
+//		- growth: every insert timed while a table grows from 16 buckets,
+//			with a row per decade of entries, against growing it by hand
+//			with ht_resize_table
+//		- concurrent: read and write mixes over --threads threads on a
+//			concurrent table, against an ht_t behind one mutex
+//		- sharded: the same mixes on an ht_sharded_t, against an ht_t
+//			behind one mutex
+//		- batch: ht_add_many and ht_get_many against the same batches
+//			of keys added or looked up one call at a time
+//		- bulk: ht_bulk_load over --threads threads against an ht_add
+//			loop, on tables that allocate each entry and on pooled
+//			ones
+//		- hashing: the batch suite's calls on a table that fits in L1,
+//			for key lengths in and past the reach of the SIMD kernels
+//		- hash-functions: each built in hash function's ns per key
+//			by key length, and how evenly it spreads sequential
+//			and random keys over a chained table's buckets
+//		- generic: HT_GENERIC tables for 8 and 16 byte keys against ht_t
+//			on the same keys
+//		- collisions: replays keys crafted to share one hash under a
+//			known seed, with and without max_chain_length
+////////////////////////////////////////////////////////////////////////////////
+#define SAMPLE		16
+#define MAX_RESULTS	32
+#define MAX_LIST	16
+#define ENTRY_BYTES	48
+#define ZIPF_THETA	0.99
+#define SHARDS		64
+#define BULK_PASSES	3
+
+typedef struct
+{
+	const char	*name;
+	size_t		 bytes;
+} bench_size_t;
+
+typedef struct
+{
+	char		op[24];
+	uint64_t	ops;
+	double		ns_per_op;
+	double		p50;
+	double		p90;
+	double		p99;
+	double		p999;
+	double		max;
+	size_t		table_bytes;
+	long		peak_rss_kb;
+	size_t		chain_max;
+	double		chain_mean;
+	double		chain_variance;
+} bench_result_t;
+
+////////////////////////////////////////////////////////////
+//	one table shape and workload
+//	- entries keys of key_length bytes, the first half
+//		of every key the same, given through a prefix
+//		when prefix is set
+//	- zipf picks the keys of hits and updates with a
+//		Zipfian distribution, uniformly otherwise
+//	- label names what a suite varies beyond these
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	const char			*suite;
+	const char			*label;
+	ht_layout_t			 layout;
+	ht_hash_size_t			 hash_size;
+	const ht_hash_function_t	*hash_function;
+	size_t				 key_length;
+	const char			*size;
+	size_t				 entries;
+	int				 zipf;
+	int				 prefix;
+	unsigned int			 threads;
+	uint64_t			 ops;
+	uint64_t			 seed;
+} bench_case_t;
+
+typedef struct
+{
+	const bench_case_t	*c;
+
+	unsigned char		*keys;
+	unsigned char		*missing;
+	size_t			 num_of_missing;
+	size_t			 prefix_length;
+	ht_prefix		*prefix;
+	uint32_t		*picks;
+
+	double			*samples;
+	size_t			 num_of_samples;
+	uint64_t		 clock_cost;
+
+	size_t			 table_bytes;
+	bench_result_t		*results;
+	size_t			 num_of_results;
+} bench_run_t;
+
+typedef struct
+{
+	int				 csv;
+	int				 rows;
+	uint64_t			 ops;
+	uint64_t			 seed;
+	const ht_hash_function_t	*hash_function;
+	size_t				 l1;
+	size_t				 l2;
+	size_t				 llc;
+
+	ht_hash_size_t			 hash_sizes[MAX_LIST];
+	size_t				 num_of_hash_sizes;
+	size_t				 key_lengths[MAX_LIST];
+	size_t				 num_of_key_lengths;
+	bench_size_t			 sizes[MAX_LIST];
+	size_t				 num_of_sizes;
+	int				 zipfs[MAX_LIST];
+	size_t				 num_of_zipfs;
+	int				 prefixes[MAX_LIST];
+	size_t				 num_of_prefixes;
+	ht_layout_t			 layouts[MAX_LIST];
+	size_t				 num_of_layouts;
+	unsigned int			 threads[MAX_LIST];
+	size_t				 num_of_threads;
+
+	bench_result_t			*shared;
+} bench_t;
+
+static const char *layout_names[] = { "chained", "open", "cuckoo" };
+
+////////////////////////////////////////////////////////////////////////////////
+//	TIMING
+////////////////////////////////////////////////////////////////////////////////
+static
+inline
+uint64_t
+now
+(
+	void
+)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static
+uint64_t
+clock_cost
+(
+	void
+)
+{
+	uint64_t best = UINT64_MAX;
+	for(int i = 0; i < 1000; i++)
+	{
+		uint64_t t0 = now();
+		uint64_t t1 = now();
+		if(t1 - t0 < best)
+		{
+			best = t1 - t0;
+		}
+	}
+	return best;
+}
+
+static
+inline
+void
+sample
+(
+	bench_run_t	*run,
+	double		 ns
+)
+{
+	ns -= run->clock_cost;
+	run->samples[run->num_of_samples++] = ns > 0 ? ns : 0;
+}
+
+////////////////////////////////////////////////////////////
+//	run body count times as operation i, timing one in
+//		SAMPLE alone
+////////////////////////////////////////////////////////////
+#define BENCH_LOOP(run,op,count,i,body) \
+	do \
+	{ \
+		(run)->num_of_samples = 0; \
+		uint64_t bench_start = now(); \
+		for(size_t i = 0; i < (count); i++) \
+		{ \
+			if(i % SAMPLE == 0) \
+			{ \
+				uint64_t bench_t0 = now(); \
+				body; \
+				sample((run),now() - bench_t0); \
+			} \
+			else \
+			{ \
+				body; \
+			} \
+		} \
+		uint64_t bench_total = now() - bench_start; \
+		uint64_t bench_clock = (run)->num_of_samples * 2 * (run)->clock_cost; \
+		bench_emit((run),(op),(count), \
+			bench_total > bench_clock ? bench_total - bench_clock : 0); \
+	} while(0)
+
+static
+int
+compare_samples
+(
+	const void	*a,
+	const void	*b
+)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+static
+double
+percentile
+(
+	const double	*sorted,
+	size_t		 count,
+	double		 p
+)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+	size_t i = (size_t) (p * (count - 1) + 0.5);
+	return sorted[i];
+}
+
+////////////////////////////////////////////////////////////
+//	record a result from the samples taken so far
+////////////////////////////////////////////////////////////
+static
+void
+bench_emit
+(
+	bench_run_t	*run,
+	const char	*op,
+	uint64_t	 ops,
+	uint64_t	 ns
+)
+{
+	bench_result_t *r;
+	struct rusage usage;
+
+	if(run->num_of_results == MAX_RESULTS)
+	{
+		return;
+	}
+	r = &run->results[run->num_of_results++];
+	memset(r,0,sizeof(*r));
+	snprintf(r->op,sizeof(r->op),"%s",op);
+	r->ops = ops;
+	r->ns_per_op = ops ? (double) ns / ops : 0;
+
+	qsort(run->samples,run->num_of_samples,sizeof(double),compare_samples);
+	r->p50 = percentile(run->samples,run->num_of_samples,0.5);
+	r->p90 = percentile(run->samples,run->num_of_samples,0.9);
+	r->p99 = percentile(run->samples,run->num_of_samples,0.99);
+	r->p999 = percentile(run->samples,run->num_of_samples,0.999);
+	r->max = run->num_of_samples ? run->samples[run->num_of_samples - 1] : 0;
+
+	r->table_bytes = run->table_bytes;
+	getrusage(RUSAGE_SELF,&usage);
+	r->peak_rss_kb = usage.ru_maxrss;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	KEYS
+////////////////////////////////////////////////////////////////////////////////
+static
+inline
+uint64_t
+splitmix64
+(
+	uint64_t	*state
+)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+////////////////////////////////////////////////////////////
+//	write key i
+//	- the first half is the same for every key, then i,
+//		then bytes drawn from i
+////////////////////////////////////////////////////////////
+static
+void
+make_key
+(
+	unsigned char	*key,
+	size_t		 key_length,
+	size_t		 prefix_length,
+	uint64_t	 i,
+	uint64_t	 seed
+)
+{
+	uint64_t state = seed;
+	for(size_t j = 0; j < prefix_length; j++)
+	{
+		key[j] = 'a' + j % 26;
+	}
+
+	state = seed ^ (i * 0xd6e8feb86659fd93ULL);
+	for(size_t j = prefix_length; j < key_length; j += 8)
+	{
+		uint64_t word = j == prefix_length ? i : splitmix64(&state);
+		size_t n = key_length - j < 8 ? key_length - j : 8;
+		memcpy(key + j,&word,n);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	Zipfian ranks, as in YCSB, scrambled over the keys so
+//		the popular ones are spread over the table
+////////////////////////////////////////////////////////////
+static
+void
+make_picks
+(
+	uint32_t	*picks,
+	uint64_t	 count,
+	size_t		 entries,
+	int		 zipf,
+	uint64_t	 seed
+)
+{
+	uint64_t state = seed;
+
+	if(!zipf)
+	{
+		for(uint64_t i = 0; i < count; i++)
+		{
+			picks[i] = splitmix64(&state) % entries;
+		}
+		return;
+	}
+
+	double zetan = 0, zeta2 = 1 + pow(0.5,ZIPF_THETA);
+	for(size_t i = 1; i <= entries; i++)
+	{
+		zetan += 1 / pow((double) i,ZIPF_THETA);
+	}
+	double alpha = 1 / (1 - ZIPF_THETA);
+	double eta = (1 - pow(2.0 / entries,1 - ZIPF_THETA)) / (1 - zeta2 / zetan);
+
+	for(uint64_t i = 0; i < count; i++)
+	{
+		double u = (splitmix64(&state) >> 11) * (1.0 / 9007199254740992.0);
+		double uz = u * zetan;
+		uint64_t rank;
+
+		if(uz < 1)
+		{
+			rank = 0;
+		}
+		else if(uz < zeta2)
+		{
+			rank = 1;
+		}
+		else
+		{
+			rank = (uint64_t) (entries * pow(eta * u - eta + 1,alpha));
+		}
+		uint64_t scramble = rank;
+		picks[i] = splitmix64(&scramble) % entries;
+	}
+}
+
+static
+inline
+const unsigned char *
+key_of
+(
+	bench_run_t	*run,
+	size_t		 i
+)
+{
+	return run->keys + i * run->c->key_length;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	OPERATIONS
+////////////////////////////////////////////////////////////////////////////////
+static long bench_value;
+
+static
+ht_t *
+bench_create
+(
+	const bench_case_t	*c,
+	size_t			 table_length
+)
+{
+	ht_options_t o;
+	ht_seed_t seed;
+
+	memset(&o,0,sizeof(o));
+	o.layout = c->layout;
+	o.max_load_factor = 1;
+	o.min_load_factor = 0.25;
+	o.hash_function = c->hash_function;
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+
+	return ht_create_with_options(table_length,c->hash_size,seed,0,0,0,&o);
+}
+
+static
+void
+iterate_nothing
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index
+)
+{
+	(void) value_length;
+	(void) key;
+	(void) key_length;
+	(void) index;
+	__asm__ volatile("" : : "r"(value));
+}
+
+////////////////////////////////////////////////////////////
+//	insert every key into an empty table, then time hits,
+//		misses, updates, iterating, resizing and removing
+//		every key
+////////////////////////////////////////////////////////////
+static
+void
+run_ops
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	size_t length = c->key_length - run->prefix_length;
+	size_t skip = run->prefix ? run->prefix_length : 0;
+	ht_prefix *prefix = run->prefix;
+	ht_t *ht = bench_create(c,16);
+	ht_stats_t stats;
+	void *value;
+	size_t value_length;
+
+	if(ht == 0)
+	{
+		return;
+	}
+	if(!run->prefix)
+	{
+		length = c->key_length;
+	}
+
+	BENCH_LOOP(run,"insert",n,i,
+		ht_add_with_prefix(ht,&bench_value,sizeof(long),key_of(run,i) + skip,length,prefix));
+
+	ht_stats(ht,1024,&stats);
+	run->table_bytes = stats.memory.total;
+	run->results[run->num_of_results - 1].table_bytes = run->table_bytes;
+
+	BENCH_LOOP(run,"get_hit",c->ops,i,
+		ht_get_with_prefix(ht,key_of(run,run->picks[i]) + skip,length,&value,&value_length,prefix));
+
+	BENCH_LOOP(run,"get_miss",c->ops,i,
+		ht_get_with_prefix(ht,run->missing + (i % run->num_of_missing) * c->key_length + skip,
+			length,&value,&value_length,prefix));
+
+	BENCH_LOOP(run,"update",c->ops,i,
+		ht_update_with_prefix(ht,&bench_value,sizeof(long),key_of(run,run->picks[i]) + skip,length,prefix));
+
+	////////////////////////////////////////
+	//	whole passes, per entry
+	{
+		size_t passes = 2 + c->ops / n;
+		run->num_of_samples = 0;
+		uint64_t total = 0;
+		for(size_t p = 0; p < passes; p++)
+		{
+			uint64_t t0 = now();
+			ht_iterate(ht,iterate_nothing);
+			uint64_t ns = now() - t0;
+			total += ns;
+			sample(run,(double) ns / n + run->clock_cost);
+		}
+		bench_emit(run,"iterate",(uint64_t) passes * n,total);
+	}
+
+	////////////////////////////////////////
+	//	to twice the entries and back, per
+	//		entry moved
+	{
+		run->num_of_samples = 0;
+		uint64_t total = 0;
+		for(int p = 0; p < 8; p++)
+		{
+			uint64_t t0 = now();
+			ht_resize_table(ht,p % 2 ? n : 2 * n);
+			uint64_t ns = now() - t0;
+			total += ns;
+			sample(run,(double) ns / n + run->clock_cost);
+		}
+		bench_emit(run,"resize",8 * (uint64_t) n,total);
+	}
+
+	BENCH_LOOP(run,"remove",n,i,
+		ht_remove_with_prefix(ht,key_of(run,run->picks[c->ops + i]) + skip,length,prefix));
+
+	ht_destroy(ht);
+}
+
+////////////////////////////////////////////////////////////
+//	grow a table from 16 buckets to every key, timing
+//		each insert alone
+//	- a row per decade of entries, 1000, 10000 and so on,
+//		then one for the rest
+//	- label resize_table turns growth off and doubles the
+//		table with ht_resize_table whenever entries reach
+//		its length, inside the timed insert, as a caller
+//		without growth would
+////////////////////////////////////////////////////////////
+static
+void
+run_growth
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	int manual = strcmp(c->label,"resize_table") == 0;
+	double *samples = malloc(n * sizeof(double));
+	size_t length = 16;
+	size_t from = 0;
+	size_t decade = 1000;
+	ht_options_t o;
+	ht_seed_t seed;
+	ht_stats_t stats;
+	ht_t *ht;
+
+	memset(&o,0,sizeof(o));
+	o.layout = c->layout;
+	o.max_load_factor = manual ? 0 : 1;
+	o.hash_function = c->hash_function;
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+
+	ht = ht_create_with_options(length,c->hash_size,seed,0,0,0,&o);
+	if(ht == 0 || samples == 0)
+	{
+		return;
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		uint64_t t0 = now();
+		if(manual && i == length)
+		{
+			length *= 2;
+			ht_resize_table(ht,length);
+		}
+		ht_add(ht,&bench_value,sizeof(long),key_of(run,i),c->key_length);
+		double ns = (double) (now() - t0) - run->clock_cost;
+		samples[i] = ns > 0 ? ns : 0;
+
+		if(i + 1 == decade || i + 1 == n)
+		{
+			char op[32];
+			double total = 0;
+
+			for(size_t j = from; j <= i; j++)
+			{
+				total += samples[j];
+			}
+			snprintf(op,sizeof(op),"insert_to_%zu",i + 1);
+			run->samples = samples + from;
+			run->num_of_samples = i + 1 - from;
+			bench_emit(run,op,i + 1 - from,(uint64_t) total);
+
+			from = i + 1;
+			decade *= 10;
+		}
+	}
+
+	ht_stats(ht,1024,&stats);
+	for(size_t r = 0; r < run->num_of_results; r++)
+	{
+		run->results[r].table_bytes = stats.memory.total;
+	}
+
+	ht_destroy(ht);
+}
+
+////////////////////////////////////////////////////////////
+//	one thread of a concurrent case
+//	- count operations from picks[first], a read for
+//		read_percent in every 100, otherwise a write
+//		that adds or removes the picked key in turn
+//	- lock, if set, is held around every operation
+//	- sharded, if set, takes the place of ht
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	bench_run_t		*run;
+	ht_t			*ht;
+	ht_sharded_t		*sharded;
+	pthread_mutex_t		*lock;
+	pthread_barrier_t	*barrier;
+	size_t			 first;
+	size_t			 count;
+	int			 read_percent;
+	double			*samples;
+	size_t			 num_of_samples;
+	uint64_t		 start;
+	uint64_t		 end;
+} bench_thread_t;
+
+static
+inline
+void
+mix_op
+(
+	bench_thread_t	*t,
+	size_t		 i
+)
+{
+	bench_run_t *run = t->run;
+	const unsigned char *key = key_of(run,run->picks[(t->first + i) % run->c->ops]);
+	size_t key_length = run->c->key_length;
+	void *value;
+	size_t value_length;
+	int read = (int) (i * 37 % 100) < t->read_percent;
+
+	if(t->sharded)
+	{
+		if(read)
+		{
+			long copy;
+			ht_sharded_get_into(t->sharded,key,key_length,&copy,sizeof(copy),&value_length);
+		}
+		else if(i & 1)
+		{
+			ht_sharded_remove(t->sharded,key,key_length);
+		}
+		else
+		{
+			ht_sharded_add(t->sharded,&bench_value,sizeof(long),key,key_length);
+		}
+		return;
+	}
+
+	if(t->lock)
+	{
+		pthread_mutex_lock(t->lock);
+	}
+	if(read)
+	{
+		ht_get(t->ht,key,key_length,&value,&value_length);
+	}
+	else if(i & 1)
+	{
+		ht_remove(t->ht,key,key_length);
+	}
+	else
+	{
+		ht_add(t->ht,&bench_value,sizeof(long),key,key_length);
+	}
+	if(t->lock)
+	{
+		pthread_mutex_unlock(t->lock);
+	}
+}
+
+static
+void *
+mix_thread
+(
+	void	*context
+)
+{
+	bench_thread_t *t = context;
+	uint64_t clock = t->run->clock_cost;
+
+	pthread_barrier_wait(t->barrier);
+	t->start = now();
+	for(size_t i = 0; i < t->count; i++)
+	{
+		if(i % SAMPLE == 0)
+		{
+			uint64_t t0 = now();
+			mix_op(t,i);
+			double ns = (double) (now() - t0) - clock;
+			t->samples[t->num_of_samples++] = ns > 0 ? ns : 0;
+		}
+		else
+		{
+			mix_op(t,i);
+		}
+	}
+	t->end = now();
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//	load every key, then run each read and write mix over
+//		the case's threads
+//	- ns_per_op is the wall time from the first thread
+//		starting to the last finishing over every thread's
+//		operations, so it falls as throughput scales
+//	- percentiles are of operations timed alone in every
+//		thread
+//	- label mutex uses a table that is not concurrent, with
+//		one mutex held around every operation
+//	- label sharded uses an ht_sharded_t of SHARDS shards,
+//		reads copy the value out with ht_sharded_get_into
+////////////////////////////////////////////////////////////
+static
+void
+run_concurrent
+(
+	bench_run_t	*run
+)
+{
+	static const int read_percents[] = { 100, 90, 50 };
+	const bench_case_t *c = run->c;
+	unsigned int threads = c->threads;
+	int locked = strcmp(c->label,"mutex") == 0;
+	int sharding = strcmp(c->label,"sharded") == 0;
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	pthread_barrier_t barrier;
+	pthread_t ids[threads];
+	bench_thread_t t[threads];
+	ht_options_t o;
+	ht_seed_t seed;
+	ht_stats_t stats;
+	ht_t *ht = 0;
+	ht_sharded_t *sharded = 0;
+
+	memset(&o,0,sizeof(o));
+	o.max_load_factor = 1;
+	o.min_load_factor = 0.25;
+	o.concurrent = !locked && !sharding;
+	o.hash_function = c->hash_function;
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+
+	if(sharding)
+	{
+		sharded = ht_sharded_create(SHARDS,c->entries,c->hash_size,seed,0,0,0,&o);
+		if(sharded == 0)
+		{
+			return;
+		}
+		for(size_t i = 0; i < c->entries; i++)
+		{
+			ht_sharded_add(sharded,&bench_value,sizeof(long),key_of(run,i),c->key_length);
+		}
+		ht_sharded_stats(sharded,1024,&stats);
+	}
+	else
+	{
+		ht = ht_create_with_options(c->entries,c->hash_size,seed,0,0,0,&o);
+		if(ht == 0)
+		{
+			return;
+		}
+		for(size_t i = 0; i < c->entries; i++)
+		{
+			ht_add(ht,&bench_value,sizeof(long),key_of(run,i),c->key_length);
+		}
+		ht_stats(ht,1024,&stats);
+	}
+	run->table_bytes = stats.memory.total;
+
+	for(size_t m = 0; m < sizeof(read_percents) / sizeof(read_percents[0]); m++)
+	{
+		char op[24];
+		size_t each = c->ops / threads;
+
+		pthread_barrier_init(&barrier,0,threads + 1);
+		for(unsigned int i = 0; i < threads; i++)
+		{
+			t[i] = (bench_thread_t)
+			{
+				.run = run,
+				.ht = ht,
+				.sharded = sharded,
+				.lock = locked ? &lock : 0,
+				.barrier = &barrier,
+				.first = i * each,
+				.count = each,
+				.read_percent = read_percents[m],
+				.samples = malloc((each / SAMPLE + 1) * sizeof(double)),
+			};
+			if(t[i].samples == 0 || pthread_create(&ids[i],0,mix_thread,&t[i]) != 0)
+			{
+				_exit(2);
+			}
+		}
+
+		pthread_barrier_wait(&barrier);
+
+		uint64_t start = UINT64_MAX;
+		uint64_t end = 0;
+		run->num_of_samples = 0;
+		for(unsigned int i = 0; i < threads; i++)
+		{
+			pthread_join(ids[i],0);
+			start = t[i].start < start ? t[i].start : start;
+			end = t[i].end > end ? t[i].end : end;
+			memcpy(run->samples + run->num_of_samples,t[i].samples,
+				t[i].num_of_samples * sizeof(double));
+			run->num_of_samples += t[i].num_of_samples;
+			free(t[i].samples);
+		}
+		pthread_barrier_destroy(&barrier);
+
+		snprintf(op,sizeof(op),"read_%d",read_percents[m]);
+		bench_emit(run,op,(uint64_t) each * threads,end - start);
+	}
+
+	if(sharded)
+	{
+		ht_sharded_destroy(sharded);
+	}
+	else
+	{
+		ht_destroy(ht);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	time count keys from keys in batches of batch
+//	- many uses the batch call, otherwise a loop of single
+//		calls over the same batch
+//	- add adds into ht, otherwise looks up
+//	- every batch is timed, its samples are per key
+////////////////////////////////////////////////////////////
+static
+void
+time_batches
+(
+	bench_run_t	 *run,
+	ht_t		 *ht,
+	const void	**keys,
+	size_t		  count,
+	size_t		  batch,
+	int		  many,
+	int		  add
+)
+{
+	size_t key_length = run->c->key_length;
+	size_t batches = count / batch;
+	size_t key_lengths[batch];
+	size_t value_lengths[batch];
+	void *values[batch];
+	uint64_t total = 0;
+	char op[32];
+
+	for(size_t j = 0; j < batch; j++)
+	{
+		key_lengths[j] = key_length;
+		value_lengths[j] = sizeof(long);
+		values[j] = &bench_value;
+	}
+
+	run->num_of_samples = 0;
+	for(size_t b = 0; b < batches; b++)
+	{
+		const void **k = keys + b * batch;
+		uint64_t t0 = now();
+
+		if(many && add)
+		{
+			ht_add_many(ht,batch,values,value_lengths,k,key_lengths,0);
+		}
+		else if(many)
+		{
+			ht_get_many(ht,batch,k,key_lengths,values,value_lengths,0);
+		}
+		else
+		{
+			for(size_t j = 0; j < batch; j++)
+			{
+				if(add)
+				{
+					ht_add(ht,&bench_value,sizeof(long),k[j],key_length);
+				}
+				else
+				{
+					ht_get(ht,k[j],key_length,&values[j],&value_lengths[j]);
+				}
+			}
+		}
+
+		uint64_t ns = now() - t0;
+		ns = ns > run->clock_cost ? ns - run->clock_cost : 0;
+		total += ns;
+		run->samples[run->num_of_samples++] = (double) ns / batch;
+	}
+
+	snprintf(op,sizeof(op),"%s_%s_%zu",add ? "add" : "get",many ? "many" : "loop",batch);
+	bench_emit(run,op,(uint64_t) batches * batch,total);
+}
+
+////////////////////////////////////////////////////////////
+//	fill a table one add at a time and another with
+//		ht_add_many, then look up picked keys in the
+//		second both ways, in batches of 16 to 512 keys
+////////////////////////////////////////////////////////////
+static
+void
+run_batch
+(
+	bench_run_t	*run
+)
+{
+	static const size_t batches[] = { 16, 64, 256, 512 };
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	const void **inserts = malloc(n * sizeof(void *));
+	const void **lookups = malloc(c->ops * sizeof(void *));
+	ht_stats_t stats;
+	ht_t *ht;
+
+	if(inserts == 0 || lookups == 0)
+	{
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		inserts[i] = key_of(run,run->picks[c->ops + i]);
+	}
+	for(size_t i = 0; i < c->ops; i++)
+	{
+		lookups[i] = key_of(run,run->picks[i]);
+	}
+
+	ht = bench_create(c,16);
+	if(ht == 0)
+	{
+		return;
+	}
+	time_batches(run,ht,inserts,n,64,0,1);
+	ht_destroy(ht);
+
+	ht = bench_create(c,16);
+	if(ht == 0)
+	{
+		return;
+	}
+	time_batches(run,ht,inserts,n,64,1,1);
+	ht_stats(ht,1024,&stats);
+	run->table_bytes = stats.memory.total;
+	run->results[0].table_bytes = run->table_bytes;
+	run->results[1].table_bytes = run->table_bytes;
+
+	for(size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++)
+	{
+		time_batches(run,ht,lookups,c->ops,batches[b],0,0);
+		time_batches(run,ht,lookups,c->ops,batches[b],1,0);
+	}
+
+	ht_destroy(ht);
+	free(inserts);
+	free(lookups);
+}
+
+////////////////////////////////////////////////////////////
+//	the batch calls against single calls in batches of 16
+//		on a table that fits in L1, so the difference is
+//		mostly hashing rather than cache misses
+////////////////////////////////////////////////////////////
+static
+void
+run_hashing
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	const void **inserts = malloc(n * sizeof(void *));
+	const void **lookups = malloc(c->ops * sizeof(void *));
+	ht_t *ht;
+
+	if(inserts == 0 || lookups == 0)
+	{
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		inserts[i] = key_of(run,run->picks[c->ops + i]);
+	}
+	for(size_t i = 0; i < c->ops; i++)
+	{
+		lookups[i] = key_of(run,run->picks[i]);
+	}
+
+	ht = bench_create(c,16);
+	if(ht == 0)
+	{
+		return;
+	}
+	time_batches(run,ht,inserts,n,16,0,1);
+	ht_destroy(ht);
+
+	ht = bench_create(c,16);
+	if(ht == 0)
+	{
+		return;
+	}
+	time_batches(run,ht,inserts,n,16,1,1);
+	time_batches(run,ht,lookups,c->ops,16,0,0);
+	time_batches(run,ht,lookups,c->ops,16,1,0);
+
+	ht_destroy(ht);
+	free(inserts);
+	free(lookups);
+}
+
+////////////////////////////////////////////////////////////
+//	load every key into a table growing from 16 buckets
+//	- label add adds them one by one with ht_add, timing
+//		one in SAMPLE alone
+//	- label bulk_load passes them all to ht_bulk_load on
+//		the case's threads, in BULK_PASSES passes on
+//		fresh tables, each pass a sample of its time
+//		per entry
+//	- a _pooled label carves entries from slabs, with
+//		inline_key_length 16
+////////////////////////////////////////////////////////////
+static
+void
+run_bulk
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	int bulk = strncmp(c->label,"bulk_load",9) == 0;
+	ht_record_t *records = malloc(n * sizeof(ht_record_t));
+	ht_options_t o;
+	ht_seed_t seed;
+	ht_stats_t stats;
+	ht_t *ht;
+
+	if(records == 0)
+	{
+		return;
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		records[i] = (ht_record_t)
+		{
+			.key = key_of(run,run->picks[c->ops + i]),
+			.key_length = c->key_length,
+			.value = &bench_value,
+			.value_length = sizeof(long),
+		};
+	}
+
+	memset(&o,0,sizeof(o));
+	o.max_load_factor = 1;
+	o.min_load_factor = 0.25;
+	o.hash_function = c->hash_function;
+	o.inline_key_length = strstr(c->label,"_pooled") ? 16 : 0;
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+
+	if(!bulk)
+	{
+		ht = ht_create_with_options(16,c->hash_size,seed,0,0,0,&o);
+		if(ht == 0)
+		{
+			return;
+		}
+		BENCH_LOOP(run,"load",n,i,
+			ht_add(ht,records[i].value,records[i].value_length,records[i].key,records[i].key_length));
+	}
+	else
+	{
+		uint64_t total = 0;
+
+		run->num_of_samples = 0;
+		for(int p = 0; p < BULK_PASSES; p++)
+		{
+			ht = ht_create_with_options(16,c->hash_size,seed,0,0,0,&o);
+			if(ht == 0)
+			{
+				return;
+			}
+			uint64_t t0 = now();
+			ht_bulk_load(ht,records,n,HT_DUPLICATES_REJECT,c->threads,0);
+			uint64_t ns = now() - t0;
+			total += ns;
+			sample(run,(double) ns / n + run->clock_cost);
+			if(p + 1 < BULK_PASSES)
+			{
+				ht_destroy(ht);
+			}
+		}
+		bench_emit(run,"load",(uint64_t) BULK_PASSES * n,total);
+	}
+
+	ht_stats(ht,1024,&stats);
+	run->results[run->num_of_results - 1].table_bytes = stats.memory.total;
+
+	ht_destroy(ht);
+	free(records);
+}
+
+////////////////////////////////////////////////////////////
+//	set the last result's chain spread from ht_stats
+//	- buckets past the histogram's last are counted as
+//		its last, so the variance is a floor when
+//		max_chain_length reaches it
+////////////////////////////////////////////////////////////
+static
+void
+chain_spread
+(
+	bench_run_t	*run,
+	ht_t		*ht
+)
+{
+	bench_result_t *r = &run->results[run->num_of_results - 1];
+	ht_stats_t stats;
+	double variance = 0;
+
+	ht_stats(ht,0,&stats);
+	for(size_t i = 0; i < HT_STATS_HISTOGRAM; i++)
+	{
+		double d = i - stats.load_factor;
+		variance += stats.chain_lengths[i] * d * d;
+	}
+
+	r->table_bytes = stats.memory.total;
+	r->chain_max = stats.max_chain_length;
+	r->chain_mean = stats.load_factor;
+	r->chain_variance = stats.num_of_buckets ? variance / stats.num_of_buckets : 0;
+}
+
+////////////////////////////////////////////////////////////
+//	one built in hash function on keys of one length
+//	- hash times the function alone on the case's keys,
+//		its ns_per_op is ns per key
+//	- insert_sequential adds keys that are their index,
+//		little endian, then zeros, insert_random keys of
+//		random bytes, each into a chained table as long
+//		as its entries, then reads the chain spread
+//	- a uniform hash spreads entries over buckets with
+//		a mean and variance of 1
+////////////////////////////////////////////////////////////
+static
+void
+run_hash_functions
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	const ht_hash_function_t *f = c->hash_function;
+	size_t n = c->entries;
+	size_t key_length = c->key_length;
+	unsigned char *keys = malloc(n * key_length);
+	uint64_t state = c->seed;
+	uint64_t h1 = 0;
+	uint64_t h2 = 0;
+	ht_t *ht;
+
+	if(keys == 0)
+	{
+		return;
+	}
+
+	BENCH_LOOP(run,"hash",c->ops,i,
+		f->hash(key_of(run,run->picks[i]),key_length,c->seed,c->seed,&h1,&h2));
+	__asm__ volatile("" : : "r"(h1), "r"(h2));
+
+	for(int random = 0; random < 2; random++)
+	{
+		memset(keys,0,n * key_length);
+		for(size_t i = 0; i < n; i++)
+		{
+			uint64_t word = i;
+			for(size_t j = 0; j < key_length; j += 8)
+			{
+				if(random)
+				{
+					word = splitmix64(&state);
+				}
+				memcpy(keys + i * key_length + j,&word,key_length - j < 8 ? key_length - j : 8);
+				if(!random)
+				{
+					break;
+				}
+			}
+		}
+
+		ht = bench_create(c,n);
+		if(ht == 0)
+		{
+			break;
+		}
+		BENCH_LOOP(run,random ? "insert_random" : "insert_sequential",n,i,
+			ht_add(ht,&bench_value,sizeof(long),keys + i * key_length,key_length));
+		chain_spread(run,ht);
+		ht_destroy(ht);
+	}
+
+	free(keys);
+}
+
+////////////////////////////////////////////////////////////
+//	HT_GENERIC tables for 8 and 16 byte keys
+//	- insert every key into an empty table, then time
+//		hits, misses, updates and removing every key, as
+//		run_ops does for ht_t
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	uint64_t	w[2];
+} bench_key128_t;
+
+HT_GENERIC(bench_u64,uint64_t,long,ht_generic_hash_u64,ht_generic_equal_u64)
+HT_GENERIC(bench_u128,bench_key128_t,long,ht_generic_hash_u128,ht_generic_equal_u128)
+
+#define BENCH_GENERIC_OPS(name,key_type) \
+	static \
+	key_type \
+	name##_key \
+	( \
+		const unsigned char	*p \
+	) \
+	{ \
+		key_type key; \
+		memcpy(&key,p,sizeof(key)); \
+		return key; \
+	} \
+	\
+	static \
+	void \
+	run_##name \
+	( \
+		bench_run_t	*run \
+	) \
+	{ \
+		const bench_case_t *c = run->c; \
+		size_t n = c->entries; \
+		name##_t *t = name##_create(16,c->seed); \
+		long value = 0; \
+		\
+		if(t == 0) \
+		{ \
+			return; \
+		} \
+		\
+		BENCH_LOOP(run,"insert",n,i, \
+			name##_add(t,name##_key(key_of(run,i)),bench_value)); \
+		run->table_bytes = t->capacity * (1 + sizeof(name##_slot_t)); \
+		run->results[run->num_of_results - 1].table_bytes = run->table_bytes; \
+		\
+		BENCH_LOOP(run,"get_hit",c->ops,i, \
+			name##_get(t,name##_key(key_of(run,run->picks[i])),&value)); \
+		\
+		BENCH_LOOP(run,"get_miss",c->ops,i, \
+			name##_get(t,name##_key(run->missing + (i % run->num_of_missing) * c->key_length),&value)); \
+		\
+		BENCH_LOOP(run,"update",c->ops,i, \
+			name##_update(t,name##_key(key_of(run,run->picks[i])),bench_value)); \
+		\
+		BENCH_LOOP(run,"remove",n,i, \
+			name##_remove(t,name##_key(key_of(run,run->picks[c->ops + i])))); \
+		\
+		__asm__ volatile("" : : "r"(value)); \
+		name##_destroy(t); \
+	}
+
+BENCH_GENERIC_OPS(bench_u64,uint64_t)
+BENCH_GENERIC_OPS(bench_u128,bench_key128_t)
+
+////////////////////////////////////////
+//	only names the generic rows' hash,
+//		ht_generic_hash_u64 or _u128
+static const ht_hash_function_t bench_generic_hash = {
+	.name		= "ht_generic",
+};
+
+////////////////////////////////////////////////////////////
+//	undo ht_generic_mix64, which is ht_hash_mix64's
+//		finalizer too
+////////////////////////////////////////////////////////////
+static
+uint64_t
+unxorshift
+(
+	uint64_t	x,
+	int		shift
+)
+{
+	uint64_t y = x;
+	for(int i = shift; i < 64; i += shift)
+	{
+		y = x ^ (y >> shift);
+	}
+	return y;
+}
+
+static
+uint64_t
+multiplicative_inverse
+(
+	uint64_t	m
+)
+{
+	uint64_t x = m;
+	for(int i = 0; i < 5; i++)
+	{
+		x *= 2 - m * x;
+	}
+	return x;
+}
+
+static
+uint64_t
+unmix64
+(
+	uint64_t	x
+)
+{
+	x = unxorshift(x,31);
+	x *= multiplicative_inverse(0x94d049bb133111ebULL);
+	x = unxorshift(x,27);
+	x *= multiplicative_inverse(0xbf58476d1ce4e5b9ULL);
+	return unxorshift(x,30);
+}
+
+////////////////////////////////////////////////////////////
+//	write count 16 byte keys, numbered from first, that
+//		ht_hash_mix64 hashes to the same words under the
+//		seeds a table of the case's hash size uses
+//	- a 16 byte key is words a and b, hashed as
+//		mix64(mix64(acc ^ a) ^ mix64(b + seed2)), so any
+//		a gets the b that lands on the target
+////////////////////////////////////////////////////////////
+static
+int
+make_collisions
+(
+	const bench_case_t	*c,
+	unsigned char		*keys,
+	size_t			 count,
+	uint64_t		 first
+)
+{
+	ht_seed_t seed;
+	uint64_t seed1;
+	uint64_t seed2;
+	uint64_t target = c->seed * 0x9e3779b97f4a7c15ULL;
+	uint64_t h1;
+	uint64_t h2;
+	uint64_t want1;
+	uint64_t want2;
+
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+	switch(c->hash_size)
+	{
+		case HT_HASH_SIZE_32:
+			seed1 = seed2 = seed.s32;
+			break;
+		case HT_HASH_SIZE_64:
+		case HT_HASH_SIZE_64_DIFFUSE_32:
+			seed1 = seed2 = seed.s64;
+			break;
+		default:
+			seed1 = seed.s128[0];
+			seed2 = seed.s128[1];
+			break;
+	}
+
+	uint64_t acc = seed1 ^ (16 * 0x9e3779b97f4a7c15ULL);
+	for(size_t i = 0; i < count; i++)
+	{
+		uint64_t a = first + i;
+		uint64_t b = unmix64(target ^ ht_generic_mix64(acc ^ a)) - seed2;
+		memcpy(keys + i * 16,&a,8);
+		memcpy(keys + i * 16 + 8,&b,8);
+	}
+
+	ht_hash_mix64.hash(keys,16,seed1,seed2,&want1,&want2);
+	for(size_t i = 0; i < count; i++)
+	{
+		ht_hash_mix64.hash(keys + i * 16,16,seed1,seed2,&h1,&h2);
+		if(h1 != want1 || h2 != want2)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+////////////////////////////////////////////////////////////
+//	replay a collision attack on a chained table
+//	- label undefended adds keys that all collide to a
+//		table without max_chain_length, reseed to one
+//		with it at 8, control adds the case's ordinary
+//		keys to a table without it
+//	- times inserting every key, then a hit on each in
+//		turn, a miss on as many colliding keys that are
+//		not in the table, and removing every key
+////////////////////////////////////////////////////////////
+static
+void
+run_collisions
+(
+	bench_run_t	*run
+)
+{
+	const bench_case_t *c = run->c;
+	size_t n = c->entries;
+	int attack = strcmp(c->label,"control") != 0;
+	ht_options_t o;
+	ht_seed_t seed;
+	ht_stats_t stats;
+	void *value;
+	size_t value_length;
+	ht_t *ht;
+
+	if(attack
+		&& (!make_collisions(c,run->keys,n,0)
+			|| !make_collisions(c,run->missing,run->num_of_missing,n)))
+	{
+		fprintf(stderr,"collisions: crafted keys do not collide\n");
+		_exit(2);
+	}
+
+	memset(&o,0,sizeof(o));
+	o.max_load_factor = 1;
+	o.min_load_factor = 0.25;
+	o.hash_function = c->hash_function;
+	o.max_chain_length = strcmp(c->label,"reseed") == 0 ? 8 : 0;
+	seed.s128[0] = c->seed;
+	seed.s128[1] = ~c->seed;
+
+	ht = ht_create_with_options(16,c->hash_size,seed,0,0,0,&o);
+	if(ht == 0)
+	{
+		return;
+	}
+
+	BENCH_LOOP(run,"insert",n,i,
+		ht_add(ht,&bench_value,sizeof(long),key_of(run,i),16));
+
+	ht_stats(ht,0,&stats);
+	run->table_bytes = stats.memory.total;
+	run->results[run->num_of_results - 1].table_bytes = run->table_bytes;
+
+	BENCH_LOOP(run,"get_hit",n,i,
+		ht_get(ht,key_of(run,run->picks[c->ops + i]),16,&value,&value_length));
+
+	BENCH_LOOP(run,"get_miss",run->num_of_missing,i,
+		ht_get(ht,run->missing + i * 16,16,&value,&value_length));
+
+	BENCH_LOOP(run,"remove",n,i,
+		ht_remove(ht,key_of(run,run->picks[c->ops + i]),16));
+
+	ht_destroy(ht);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	CASES
+////////////////////////////////////////////////////////////////////////////////
+static
+void
+print_header
+(
+	bench_t	*b
+)
+{
+	if(b->csv)
+	{
+		printf("suite,label,op,layout,hash_size,hash_function,key_length,size,entries,"
+			"distribution,prefix,threads,ops,ns_per_op,ops_per_s,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,"
+			"table_bytes,peak_rss_kb,chain_max,chain_mean,chain_variance\n");
+		return;
+	}
+	printf("{\n\t\"machine\": {\"l1_bytes\": %zu, \"l2_bytes\": %zu, \"llc_bytes\": %zu, "
+		"\"cpus\": %ld, \"sample\": %d},\n\t\"results\": [",
+		b->l1,b->l2,b->llc,sysconf(_SC_NPROCESSORS_ONLN),SAMPLE);
+}
+
+static
+void
+print_footer
+(
+	bench_t	*b
+)
+{
+	if(!b->csv)
+	{
+		printf("\n\t]\n}\n");
+	}
+}
+
+static
+void
+print_result
+(
+	bench_t			*b,
+	const bench_case_t	*c,
+	const bench_result_t	*r
+)
+{
+	const char *function = c->hash_function ? c->hash_function->name : "spookyhash";
+	const char *label = c->label ? c->label : "";
+	double ops_per_s = r->ns_per_op > 0 ? 1e9 / r->ns_per_op : 0;
+
+	if(b->csv)
+	{
+		printf("%s,%s,%s,%s,%d,%s,%zu,%s,%zu,%s,%d,%u,%llu,%.2f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f,%zu,%ld,"
+			"%zu,%.4f,%.4f\n",
+			c->suite,label,r->op,layout_names[c->layout],(int) c->hash_size,function,
+			c->key_length,c->size,c->entries,c->zipf ? "zipf" : "uniform",c->prefix,
+			c->threads,(unsigned long long) r->ops,r->ns_per_op,ops_per_s,r->p50,r->p90,
+			r->p99,r->p999,r->max,r->table_bytes,r->peak_rss_kb,r->chain_max,r->chain_mean,
+			r->chain_variance);
+	}
+	else
+	{
+		printf("%s\n\t\t{\"suite\": \"%s\", \"label\": \"%s\", \"op\": \"%s\", \"layout\": \"%s\", "
+			"\"hash_size\": %d, \"hash_function\": \"%s\", \"key_length\": %zu, \"size\": \"%s\", "
+			"\"entries\": %zu, \"distribution\": \"%s\", \"prefix\": %d, \"threads\": %u, "
+			"\"ops\": %llu, \"ns_per_op\": %.2f, \"ops_per_s\": %.0f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, "
+			"\"p99_ns\": %.1f, \"p999_ns\": %.1f, \"max_ns\": %.1f, \"table_bytes\": %zu, "
+			"\"peak_rss_kb\": %ld, \"chain_max\": %zu, \"chain_mean\": %.4f, "
+			"\"chain_variance\": %.4f}",
+			b->rows ? "," : "",c->suite,label,r->op,layout_names[c->layout],(int) c->hash_size,
+			function,c->key_length,c->size,c->entries,c->zipf ? "zipf" : "uniform",c->prefix,
+			c->threads,(unsigned long long) r->ops,r->ns_per_op,ops_per_s,r->p50,r->p90,r->p99,
+			r->p999,r->max,r->table_bytes,r->peak_rss_kb,r->chain_max,r->chain_mean,
+			r->chain_variance);
+	}
+	b->rows++;
+	fflush(stdout);
+}
+
+////////////////////////////////////////////////////////////
+//	run a case in a child process
+//	- keys, missing keys and picks are made before any
+//		timing, picks holds ops picks by the case's
+//		distribution then every key once, shuffled
+////////////////////////////////////////////////////////////
+static
+void
+run_case
+(
+	bench_t			*b,
+	const bench_case_t	*c,
+	void			(*body)
+				(
+					bench_run_t	*run
+				)
+)
+{
+	pid_t pid;
+	int status;
+
+	memset(b->shared,0,sizeof(bench_result_t) * (MAX_RESULTS + 1));
+	fflush(stdout);
+
+	pid = fork();
+	if(pid < 0)
+	{
+		perror("fork");
+		exit(1);
+	}
+
+	if(pid == 0)
+	{
+		bench_run_t run;
+		size_t n = c->entries;
+		uint64_t state = c->seed;
+
+		memset(&run,0,sizeof(run));
+		run.c = c;
+		run.results = b->shared;
+		run.clock_cost = clock_cost();
+		run.prefix_length = c->key_length / 2;
+		run.num_of_missing = n < 65536 ? n : 65536;
+		run.keys = malloc(n * c->key_length);
+		run.missing = malloc(run.num_of_missing * c->key_length);
+		run.picks = malloc((c->ops + n) * sizeof(uint32_t));
+		run.samples = malloc(((c->ops > n ? c->ops : n) / SAMPLE + 64) * sizeof(double));
+		if(!run.keys || !run.missing || !run.picks || !run.samples)
+		{
+			_exit(2);
+		}
+
+		for(size_t i = 0; i < n; i++)
+		{
+			make_key(run.keys + i * c->key_length,c->key_length,run.prefix_length,i,c->seed);
+		}
+		for(size_t i = 0; i < run.num_of_missing; i++)
+		{
+			make_key(run.missing + i * c->key_length,c->key_length,run.prefix_length,n + i,c->seed);
+		}
+		make_picks(run.picks,c->ops,n,c->zipf,c->seed);
+		for(size_t i = 0; i < n; i++)
+		{
+			run.picks[c->ops + i] = i;
+		}
+		for(size_t i = n; i > 1; i--)
+		{
+			size_t j = splitmix64(&state) % i;
+			uint32_t t = run.picks[c->ops + i - 1];
+			run.picks[c->ops + i - 1] = run.picks[c->ops + j];
+			run.picks[c->ops + j] = t;
+		}
+		if(c->prefix)
+		{
+			run.prefix = ht_create_prefix(run.keys,run.prefix_length);
+		}
+
+		body(&run);
+		b->shared[MAX_RESULTS].ops = run.num_of_results;
+		_exit(0);
+	}
+
+	waitpid(pid,&status,0);
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		fprintf(stderr,"%s %s %s %d key_length %zu %s: child failed\n",c->suite,c->label ? c->label : "",
+			layout_names[c->layout],(int) c->hash_size,c->key_length,c->size);
+		return;
+	}
+	for(uint64_t i = 0; i < b->shared[MAX_RESULTS].ops; i++)
+	{
+		print_result(b,c,&b->shared[i]);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	entries of key_length keys that fill bytes
+////////////////////////////////////////////////////////////
+static
+size_t
+entries_for
+(
+	size_t	bytes,
+	size_t	key_length
+)
+{
+	size_t n = bytes / (key_length + ENTRY_BYTES);
+	return n < 64 ? 64 : n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	SUITES
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	every operation over every combination of the lists
+//	- cuckoo layout cases only use HT_HASH_SIZE_128
+////////////////////////////////////////////////////////////
+static
+void
+suite_ops
+(
+	bench_t	*b
+)
+{
+	for(size_t l = 0; l < b->num_of_layouts; l++)
+	for(size_t h = 0; h < b->num_of_hash_sizes; h++)
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t z = 0; z < b->num_of_zipfs; z++)
+	for(size_t p = 0; p < b->num_of_prefixes; p++)
+	{
+		bench_case_t c =
+		{
+			.suite = "ops",
+			.layout = b->layouts[l],
+			.hash_size = b->hash_sizes[h],
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.zipf = b->zipfs[z],
+			.prefix = b->prefixes[p],
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		if(c.layout == HT_LAYOUT_CUCKOO && c.hash_size != HT_HASH_SIZE_128)
+		{
+			continue;
+		}
+		run_case(b,&c,run_ops);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	every layout on the same keys, sizes and distributions
+//	- --layouts and --hash-sizes are ignored, every case
+//		uses HT_HASH_SIZE_128 so cuckoo can take part
+////////////////////////////////////////////////////////////
+static
+void
+suite_layouts
+(
+	bench_t	*b
+)
+{
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t z = 0; z < b->num_of_zipfs; z++)
+	for(size_t l = 0; l < 3; l++)
+	{
+		bench_case_t c =
+		{
+			.suite = "layouts",
+			.layout = (ht_layout_t) l,
+			.hash_size = HT_HASH_SIZE_128,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.zipf = b->zipfs[z],
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_ops);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	insert latency while growing, by decade of entries
+//	- one case per key length, up to the largest of
+//		--sizes, raise --llc to grow further
+//	- chained layout, hash size and distribution lists
+//		are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_growth
+(
+	bench_t	*b
+)
+{
+	static const char *labels[] = { "incremental", "resize_table" };
+	size_t bytes = 0;
+	const char *size = 0;
+
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	{
+		if(b->sizes[s].bytes > bytes)
+		{
+			bytes = b->sizes[s].bytes;
+			size = b->sizes[s].name;
+		}
+	}
+
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t l = 0; l < 2; l++)
+	{
+		bench_case_t c =
+		{
+			.suite = "growth",
+			.label = labels[l],
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = size,
+			.entries = entries_for(bytes,b->key_lengths[k]),
+			.threads = 1,
+			.ops = 0,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_growth);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	read and write mixes from 1 to 64 threads
+//	- every key length, size and thread count, on a
+//		concurrent table and on one behind a mutex
+//	- chained layout, HT_HASH_SIZE_64, uniform picks,
+//		the other lists are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_concurrent
+(
+	bench_t	*b
+)
+{
+	static const char *labels[] = { "concurrent", "mutex" };
+
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t l = 0; l < 2; l++)
+	for(size_t t = 0; t < b->num_of_threads; t++)
+	{
+		bench_case_t c =
+		{
+			.suite = "concurrent",
+			.label = labels[l],
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.threads = b->threads[t],
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_concurrent);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	batch calls against single calls
+//	- every layout, key length, size and distribution,
+//		HT_HASH_SIZE_64 except for cuckoo, no prefix
+//	- the speedup should show once sizes pass llc
+////////////////////////////////////////////////////////////
+static
+void
+suite_batch
+(
+	bench_t	*b
+)
+{
+	for(size_t l = 0; l < b->num_of_layouts; l++)
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t z = 0; z < b->num_of_zipfs; z++)
+	{
+		bench_case_t c =
+		{
+			.suite = "batch",
+			.layout = b->layouts[l],
+			.hash_size = b->layouts[l] == HT_LAYOUT_CUCKOO ? HT_HASH_SIZE_128 : HT_HASH_SIZE_64,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.zipf = b->zipfs[z],
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_batch);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	bulk loading against adding one key at a time
+//	- every key length and size, heap and pooled tables,
+//		ht_bulk_load at every thread count, the ht_add
+//		loop on one thread
+//	- chained layout, HT_HASH_SIZE_64, no prefix, the
+//		other lists are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_bulk
+(
+	bench_t	*b
+)
+{
+	static const char *labels[] = { "add", "bulk_load", "add_pooled", "bulk_load_pooled" };
+
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t l = 0; l < 4; l++)
+	for(size_t t = 0; t < b->num_of_threads; t++)
+	{
+		bench_case_t c =
+		{
+			.suite = "bulk",
+			.label = labels[l],
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.threads = b->threads[t],
+			.ops = 0,
+			.seed = b->seed,
+		};
+
+		if(l % 2 == 0)
+		{
+			if(t > 0)
+			{
+				break;
+			}
+			c.threads = 1;
+		}
+		run_case(b,&c,run_bulk);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	batch hashing by key length
+//	- 8 to 176 byte keys are hashed by the SIMD kernels,
+//		256 byte keys are not and show what the batch
+//		calls gain without them
+//	- chained layout, HT_HASH_SIZE_64 and SpookyHash,
+//		tables sized to L1, uniform picks, no prefix,
+//		the lists and --hash-function are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_hashing
+(
+	bench_t	*b
+)
+{
+	static const size_t key_lengths[] = { 8, 16, 32, 64, 128, 176, 256 };
+
+	for(size_t k = 0; k < sizeof(key_lengths) / sizeof(key_lengths[0]); k++)
+	{
+		bench_case_t c =
+		{
+			.suite = "hashing",
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.key_length = key_lengths[k],
+			.size = "l1",
+			.entries = entries_for(b->l1,key_lengths[k]),
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_hashing);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	every built in hash function over every key length and
+//		size
+//	- chained layout, HT_HASH_SIZE_64, uniform picks, no
+//		prefix, the other lists and --hash-function are
+//		ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_hash_functions
+(
+	bench_t	*b
+)
+{
+	static const ht_hash_function_t *functions[] =
+	{
+		&ht_hash_spookyhash, &ht_hash_mix64, &ht_hash_wyhash,
+	};
+
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); f++)
+	{
+		bench_case_t c =
+		{
+			.suite = "hash-functions",
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = functions[f],
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_hash_functions);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	HT_GENERIC against ht_t on u64 and 16 byte keys
+//	- every size and distribution, ht_t in every layout
+//		with HT_HASH_SIZE_64, or 128 for cuckoo, no prefix
+//	- ht_t rows also time iterate and resize, which the
+//		generic rows leave out
+//	- --hash-function mix64 gives ht_t a hash close to
+//		the generic tables' own
+////////////////////////////////////////////////////////////
+static
+void
+suite_generic
+(
+	bench_t	*b
+)
+{
+	static const size_t key_lengths[] = { 8, 16 };
+
+	for(size_t k = 0; k < 2; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t z = 0; z < b->num_of_zipfs; z++)
+	for(size_t l = 0; l <= b->num_of_layouts; l++)
+	{
+		int generic = l == b->num_of_layouts;
+		bench_case_t c =
+		{
+			.suite = "generic",
+			.label = generic ? "generic" : "ht_t",
+			.layout = generic ? HT_LAYOUT_OPEN : b->layouts[l],
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = generic ? &bench_generic_hash : b->hash_function,
+			.key_length = key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,key_lengths[k]),
+			.zipf = b->zipfs[z],
+			.threads = 1,
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		if(c.layout == HT_LAYOUT_CUCKOO)
+		{
+			c.hash_size = HT_HASH_SIZE_128;
+		}
+		run_case(b,&c,generic ? k == 0 ? run_bench_u64 : run_bench_u128 : run_ops);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	collision attack replays
+//	- 1024, 4096 and 16384 keys of 16 bytes under every
+//		hash size, hashed with ht_hash_mix64 since the
+//		attack has to invert the hash
+//	- the other lists and --hash-function are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_collisions
+(
+	bench_t	*b
+)
+{
+	static const char *labels[] = { "undefended", "reseed", "control" };
+	static const struct
+	{
+		const char	*name;
+		size_t		 entries;
+	} counts[] = { { "1k", 1024 }, { "4k", 4096 }, { "16k", 16384 } };
+
+	for(size_t h = 0; h < b->num_of_hash_sizes; h++)
+	for(size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++)
+	for(size_t l = 0; l < 3; l++)
+	{
+		bench_case_t c =
+		{
+			.suite = "collisions",
+			.label = labels[l],
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = b->hash_sizes[h],
+			.hash_function = &ht_hash_mix64,
+			.key_length = 16,
+			.size = counts[n].name,
+			.entries = counts[n].entries,
+			.threads = 1,
+			.ops = counts[n].entries,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_collisions);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	the concurrent suite's mixes on a sharded table
+//	- every key length, size and thread count, on an
+//		ht_sharded_t of SHARDS shards and on one ht_t
+//		behind a mutex
+//	- chained layout, HT_HASH_SIZE_64, uniform picks,
+//		the other lists are ignored
+////////////////////////////////////////////////////////////
+static
+void
+suite_sharded
+(
+	bench_t	*b
+)
+{
+	static const char *labels[] = { "sharded", "mutex" };
+
+	for(size_t k = 0; k < b->num_of_key_lengths; k++)
+	for(size_t s = 0; s < b->num_of_sizes; s++)
+	for(size_t l = 0; l < 2; l++)
+	for(size_t t = 0; t < b->num_of_threads; t++)
+	{
+		bench_case_t c =
+		{
+			.suite = "sharded",
+			.label = labels[l],
+			.layout = HT_LAYOUT_CHAINED,
+			.hash_size = HT_HASH_SIZE_64,
+			.hash_function = b->hash_function,
+			.key_length = b->key_lengths[k],
+			.size = b->sizes[s].name,
+			.entries = entries_for(b->sizes[s].bytes,b->key_lengths[k]),
+			.threads = b->threads[t],
+			.ops = b->ops,
+			.seed = b->seed,
+		};
+
+		run_case(b,&c,run_concurrent);
+	}
+}
+
+static const struct
+{
+	const char	*name;
+	void		(*run)(bench_t *b);
+} suites[] =
+{
+	{ "ops",	suite_ops },
+	{ "layouts",	suite_layouts },
+	{ "growth",	suite_growth },
+	{ "concurrent",	suite_concurrent },
+	{ "sharded",	suite_sharded },
+	{ "batch",	suite_batch },
+	{ "bulk",	suite_bulk },
+	{ "hashing",	suite_hashing },
+	{ "hash-functions",	suite_hash_functions },
+	{ "generic",	suite_generic },
+	{ "collisions",	suite_collisions },
+};
+#define NUM_OF_SUITES	(sizeof(suites) / sizeof(suites[0]))
+
+////////////////////////////////////////////////////////////////////////////////
+//	MAIN
+////////////////////////////////////////////////////////////////////////////////
+static
+size_t
+cache_size
+(
+	int	level
+)
+{
+	static const int names[] = { _SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE };
+	static const size_t fallback[] = { 32 << 10, 1 << 20, 32 << 20 };
+	long size = sysconf(names[level]);
+	return size > 0 ? (size_t) size : fallback[level];
+}
+
+static
+size_t
+parse_list
+(
+	const char	*list,
+	char		 items[MAX_LIST][32]
+)
+{
+	size_t n = 0;
+	while(*list && n < MAX_LIST)
+	{
+		size_t len = strcspn(list,",");
+		snprintf(items[n++],32,"%.*s",(int) len,list);
+		list += len + (list[len] == ',');
+	}
+	return n;
+}
+
+static
+void
+usage
+(
+	void
+)
+{
+	fprintf(stderr,
+		"usage: ht_bench [--format json|csv] [--quick] [--suite name]...\n"
+		"\t[--hash-sizes list] [--key-lengths list] [--sizes l1,l2,llc,10llc]\n"
+		"\t[--distributions uniform,zipf] [--prefixes 0,1] [--layouts chained,open,cuckoo]\n"
+		"\t[--threads list] [--hash-function name] [--ops count] [--llc bytes] [--seed n]\n"
+		"suites:");
+	for(size_t s = 0; s < NUM_OF_SUITES; s++)
+	{
+		fprintf(stderr," %s",suites[s].name);
+	}
+	fprintf(stderr,"\n");
+	exit(1);
+}
+
+int
+main
+(
+	int	 argc,
+	char	**argv
+)
+{
+	static bench_t b;
+	const char *chosen[NUM_OF_SUITES];
+	size_t num_of_chosen = 0;
+	char items[MAX_LIST][32];
+	size_t n;
+
+	b.ops = 1 << 20;
+	b.seed = 1;
+	b.l1 = cache_size(0);
+	b.l2 = cache_size(1);
+	b.llc = cache_size(2);
+
+	static const ht_hash_size_t hash_sizes[] =
+	{
+		HT_HASH_SIZE_32, HT_HASH_SIZE_64, HT_HASH_SIZE_64_DIFFUSE_32,
+		HT_HASH_SIZE_128, HT_HASH_SIZE_128_DIFFUSE_64, HT_HASH_SIZE_128_DIFFUSE_32,
+	};
+	memcpy(b.hash_sizes,hash_sizes,sizeof(hash_sizes));
+	b.num_of_hash_sizes = 6;
+	static const size_t key_lengths[] = { 8, 16, 64, 256, 1024 };
+	memcpy(b.key_lengths,key_lengths,sizeof(key_lengths));
+	b.num_of_key_lengths = 5;
+	b.num_of_sizes = 4;
+	b.zipfs[1] = 1;
+	b.num_of_zipfs = 2;
+	b.prefixes[1] = 1;
+	b.num_of_prefixes = 2;
+	b.num_of_layouts = 1;
+	static const unsigned int threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+	memcpy(b.threads,threads,sizeof(threads));
+	b.num_of_threads = 7;
+
+	for(int a = 1; a < argc; a++)
+	{
+		const char *arg = argv[a];
+		const char *value = a + 1 < argc ? argv[a + 1] : 0;
+
+		if(strcmp(arg,"--quick") == 0)
+		{
+			b.ops = 1 << 17;
+			b.hash_sizes[0] = HT_HASH_SIZE_64;
+			b.hash_sizes[1] = HT_HASH_SIZE_128;
+			b.num_of_hash_sizes = 2;
+			b.key_lengths[0] = 8;
+			b.key_lengths[1] = 64;
+			b.num_of_key_lengths = 2;
+			b.num_of_sizes = 3;
+			b.num_of_zipfs = 1;
+			b.num_of_prefixes = 1;
+			b.threads[1] = 4;
+			b.threads[2] = 16;
+			b.num_of_threads = 3;
+			continue;
+		}
+		if(value == 0)
+		{
+			usage();
+		}
+		a++;
+
+		if(strcmp(arg,"--format") == 0)
+		{
+			b.csv = strcmp(value,"csv") == 0;
+		}
+		else if(strcmp(arg,"--suite") == 0 && num_of_chosen < NUM_OF_SUITES)
+		{
+			size_t s = 0;
+			while(s < NUM_OF_SUITES && strcmp(value,suites[s].name) != 0)
+			{
+				s++;
+			}
+			if(s == NUM_OF_SUITES)
+			{
+				usage();
+			}
+			chosen[num_of_chosen++] = value;
+		}
+		else if(strcmp(arg,"--hash-sizes") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.hash_sizes[i] = atoi(items[i]);
+			}
+			b.num_of_hash_sizes = n;
+		}
+		else if(strcmp(arg,"--key-lengths") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.key_lengths[i] = strtoul(items[i],0,10);
+				if(b.key_lengths[i] < 8)
+				{
+					usage();
+				}
+			}
+			b.num_of_key_lengths = n;
+		}
+		else if(strcmp(arg,"--sizes") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.sizes[i].name = strdup(items[i]);
+			}
+			b.num_of_sizes = n;
+		}
+		else if(strcmp(arg,"--distributions") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.zipfs[i] = strcmp(items[i],"zipf") == 0;
+			}
+			b.num_of_zipfs = n;
+		}
+		else if(strcmp(arg,"--prefixes") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.prefixes[i] = atoi(items[i]);
+			}
+			b.num_of_prefixes = n;
+		}
+		else if(strcmp(arg,"--layouts") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.layouts[i] = strcmp(items[i],"open") == 0 ? HT_LAYOUT_OPEN
+					: strcmp(items[i],"cuckoo") == 0 ? HT_LAYOUT_CUCKOO : HT_LAYOUT_CHAINED;
+			}
+			b.num_of_layouts = n;
+		}
+		else if(strcmp(arg,"--threads") == 0)
+		{
+			n = parse_list(value,items);
+			for(size_t i = 0; i < n; i++)
+			{
+				b.threads[i] = strtoul(items[i],0,10);
+				if(b.threads[i] == 0)
+				{
+					usage();
+				}
+			}
+			b.num_of_threads = n;
+		}
+		else if(strcmp(arg,"--hash-function") == 0)
+		{
+			b.hash_function = ht_find_hash_function(value);
+			if(b.hash_function == 0)
+			{
+				usage();
+			}
+		}
+		else if(strcmp(arg,"--ops") == 0)
+		{
+			b.ops = strtoull(value,0,10);
+		}
+		else if(strcmp(arg,"--llc") == 0)
+		{
+			b.llc = strtoull(value,0,10);
+		}
+		else if(strcmp(arg,"--seed") == 0)
+		{
+			b.seed = strtoull(value,0,10);
+		}
+		else
+		{
+			usage();
+		}
+	}
+
+	////////////////////////////////////////
+	//	sizes are named until the caches are
+	//		known
+	static const char *size_names[] = { "l1", "l2", "llc", "10llc" };
+	for(size_t i = 0; i < b.num_of_sizes; i++)
+	{
+		const char *name = b.sizes[i].name ? b.sizes[i].name : size_names[i];
+		size_t bytes = strcmp(name,"l1") == 0 ? b.l1
+			: strcmp(name,"l2") == 0 ? b.l2
+			: strcmp(name,"llc") == 0 ? b.llc
+			: strcmp(name,"10llc") == 0 ? 10 * b.llc : 0;
+		if(bytes == 0)
+		{
+			usage();
+		}
+		b.sizes[i].name = name;
+		b.sizes[i].bytes = bytes;
+	}
+
+	b.shared = mmap(0,sizeof(bench_result_t) * (MAX_RESULTS + 1),PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS,-1,0);
+	if(b.shared == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+
+	print_header(&b);
+	for(size_t s = 0; s < NUM_OF_SUITES; s++)
+	{
+		int wanted = num_of_chosen == 0 && s == 0;
+		for(size_t i = 0; i < num_of_chosen; i++)
+		{
+			wanted |= strcmp(chosen[i],suites[s].name) == 0;
+		}
+		if(wanted)
+		{
+			suites[s].run(&b);
+		}
+	}
+	print_footer(&b);
+
+	return 0;
+}
@@ -5,6 +5,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct ht_t ht_t;
 typedef int ht_status_t;
 
@@ -32,8 +36,27 @@ enum
 	HT_KEY_NOT_IN_USE,
 	HT_CANNOT_SCALE_FIXED_LENGTH_TABLE,
 	HT_NONPOSITIVE_LENGTH,
+	HT_READ_ONLY_TABLE,
+	HT_IO_ERROR,
+	HT_NO_NAMESPACES,
+	HT_BUFFER_TOO_SMALL,
+	HT_NOT_INSTRUMENTED,
 };
 
+typedef enum
+{
+	HT_LAYOUT_CHAINED = 0,
+	HT_LAYOUT_OPEN,
+	HT_LAYOUT_CUCKOO,
+} ht_layout_t;
+
+typedef enum
+{
+	HT_INDEX_MODULO = 0,
+	HT_INDEX_MASK,
+	HT_INDEX_FASTRANGE,
+} ht_index_mode_t;
+
 typedef union
 {
 	uint32_t	s32;
@@ -41,6 +64,241 @@ typedef union
 	uint64_t	s128[2];
 } ht_seed_t;
 
+////////////////////////////////////////////////////////////
+//	hash function
+//	- hash is the one shot function, seeded with two
+//		words and returning two words
+//		- the 32 and 64 bit hash sizes seed both words
+//			with s32 or s64 and use the first word
+//		- the 128 bit sizes seed with s128 and use
+//			both words
+//	- init, update and final hash a key given in
+//		pieces, used to pick up a prefixed key where
+//		its prefix left off
+//		- the same key must hash the same whether
+//			given in one piece or several
+//		- state_size bytes are handed to init, aligned
+//			for any type
+//		- may all be NULL, prefixed keys are then
+//			joined to their prefix and hashed in
+//			one shot
+//	- name identifies the function, and should be
+//		unique
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	const char	*name;
+	void		(*hash)
+			(
+				const void	*key,
+				size_t		 key_length,
+				uint64_t	 seed1,
+				uint64_t	 seed2,
+				uint64_t	*hash1,
+				uint64_t	*hash2
+			);
+	size_t		state_size;
+	void		(*init)
+			(
+				void		*state,
+				uint64_t	 seed1,
+				uint64_t	 seed2
+			);
+	void		(*update)
+			(
+				void		*state,
+				const void	*key,
+				size_t		 key_length
+			);
+	void		(*final)
+			(
+				void		*state,
+				uint64_t	*hash1,
+				uint64_t	*hash2
+			);
+} ht_hash_function_t;
+
+////////////////////////////////////////////////////////////
+//	built in hash functions
+//	- ht_hash_spookyhash: SpookyHash V2, the default
+//	- ht_hash_mix64: a few multiplies and shifts over
+//		the key's words, for keys of up to 16 bytes
+//		such as integers and UUIDs
+//		- longer keys are folded 16 bytes at a time
+//			and hash poorly compared to the others
+//	- ht_hash_wyhash: wyhash, faster than SpookyHash on
+//		keys longer than a few dozen bytes
+//	- only ht_hash_spookyhash streams
+////////////////////////////////////////////////////////////
+extern const ht_hash_function_t ht_hash_spookyhash;
+extern const ht_hash_function_t ht_hash_mix64;
+extern const ht_hash_function_t ht_hash_wyhash;
+
+////////////////////////////////////////////////////////////
+//	find a built in hash function by name
+//	- returns NULL if there is none
+////////////////////////////////////////////////////////////
+const ht_hash_function_t *
+ht_find_hash_function
+(
+	const char	*name
+);
+
+////////////////////////////////////////////////////////////
+//	creation options
+//	- zero initialized options give the same table
+//		as ht_create_full
+//	- layout
+//		- HT_LAYOUT_CHAINED: array of buckets, each
+//			a linked list of entries
+//		- HT_LAYOUT_OPEN: flat open addressed array
+//			with one control byte per slot, probed
+//			a group of slots at a time
+//			- table_length is rounded up to a power
+//				of two and the table grows on its own
+//		- HT_LAYOUT_CUCKOO: buckets of four slots, a
+//			key in one of two buckets picked by the
+//			two words of its HT_HASH_SIZE_128 hash,
+//			or in a small stash
+//			- lookups look at two buckets and the
+//				stash while it is in use, however
+//				full the table
+//			- the stash only grows for keys whose
+//				buckets collide too often, as
+//				with a weak hash_function
+//			- adds move entries to their other
+//				bucket to make room, then use the
+//				stash, then grow the table
+//			- table_length is rounded up to a power
+//				of two slots, the table grows on
+//				its own
+//			- other hash sizes return NULL
+//	- max_load_factor, min_load_factor
+//		- chained tables double their bucket count
+//			when entries per bucket would exceed
+//			max_load_factor, and halve it when they
+//			fall below min_load_factor
+//		- never shrinks below table_length
+//		- 0 disables either direction
+//		- when both are set min_load_factor must be
+//			under half of max_load_factor, else
+//			NULL is returned
+//		- buckets are moved a few at a time by later
+//			adds, updates and removes, so no single
+//			call pays for the whole rehash
+//	- index_mode
+//		- how a chained table turns a hash into a
+//			bucket
+//		- HT_INDEX_MODULO: hash % table_length
+//		- HT_INDEX_MASK: table_length is rounded up
+//			to a power of two and the low bits of
+//			the hash are used
+//		- HT_INDEX_FASTRANGE: the hash is scaled
+//			into table_length with a multiply and
+//			shift, any length
+//	- inline_key_length
+//		- if not 0, chained table entries are carved
+//			out of slabs owned by the table
+//		- keys (prefix included) of up to
+//			inline_key_length bytes are stored in
+//			the entry, longer keys in a bump
+//			allocated key arena
+//		- removed entries are reused, arena space of
+//			removed keys is only given back by
+//			ht_clear_table and ht_destroy, which
+//			release whole slabs
+//	- concurrent
+//		- if not 0, the table may be used from many
+//			threads at once
+//		- chained layout only, inline_key_length is
+//			ignored
+//		- ht_get, ht_get_copy and ht_iterate take no
+//			locks, writers lock a stripe of buckets
+//		- removed and replaced entries are freed, and
+//			their values destroyed, only once no
+//			reader can still be looking at them, by
+//			whichever thread writes next
+//		- the value ht_get points to is one of these,
+//			it may be destroyed as soon as ht_get
+//			returns if another thread removes or
+//			updates the key, so the pointer must not
+//			be used once that can happen
+//			- ht_get_into and ht_get_copy copy the
+//				value while it is still safe to read
+//		- ht_update replaces the entry instead of
+//			changing its value in place
+//		- growing, shrinking, ht_resize_table and
+//			ht_clear_table hold every stripe, so
+//			they wait for writers but not readers
+//		- a resize relinks entries in place, so a
+//			lookup that misses while one runs
+//			cannot trust the miss and spins until
+//			the resize is done, lookups that hit
+//			return at once
+//		- ht_iterate is not a snapshot, entries added
+//			or removed while it runs may or may not
+//			be seen, and a resize under it may show
+//			an entry twice or skip it
+//		- ht_destroy must not race with anything
+//	- hash_function
+//		- hashes keys, NULL for ht_hash_spookyhash
+//		- must stay valid for the table's lifetime
+//	- namespaces
+//		- if not 0, entries added through a prefix are
+//			also listed under the prefix, see
+//			NAMESPACES
+//		- chained layout only, not concurrent
+//		- costs three pointers per entry
+//	- own_values
+//		- if not 0, adds and updates copy value_length
+//			bytes of the value into the table, and
+//			ht_get returns a pointer to the copy
+//		- values of up to inline_value_length bytes
+//			are stored in the entry, 8 byte aligned,
+//			longer ones in a block of their own
+//		- the table frees its copies, destroy_value
+//			is not called for them
+//		- a pointer from ht_get stays valid until
+//			its entry is updated or removed
+//		- chained layout only, not concurrent
+//	- max_chain_length
+//		- if not 0, adding an entry to a chain longer
+//			than this rehashes the table under a new
+//			random seed, to spread out keys chosen
+//			to collide under the old one
+//		- after one reseed the next waits until the
+//			table has twice as many entries, so
+//			chains that are long for other reasons
+//			cost little
+//		- should be well above max_load_factor
+//		- chains stay short only while collisions
+//			depend on the seed, keys that collide
+//			under every seed stay in one chain
+//			however often the table reseeds
+//			- e.g. keys under a hash_function that
+//				ignores its seeds, or whose collisions
+//				can be found without knowing them
+//			- chains are never turned into trees,
+//				lookups in them stay linear
+//		- ht_save keeps the seed in use, and
+//			ht_stats counts the reseeds
+//		- chained layout only, not concurrent
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	ht_layout_t	layout;
+	float		max_load_factor;
+	float		min_load_factor;
+	ht_index_mode_t	index_mode;
+	size_t		inline_key_length;
+	int		concurrent;
+	const ht_hash_function_t	*hash_function;
+	int		namespaces;
+	int		own_values;
+	size_t		inline_value_length;
+	size_t		max_chain_length;
+} ht_options_t;
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //	CREATION AND DESTRUCTION
@@ -81,6 +339,31 @@ ht_create_full
 			)
 );
 
+////////////////////////////////////////////////////////////
+//	create a hash table
+//	- same as ht_create_full
+//	- options may be 0, in which case the defaults
+//		are used
+////////////////////////////////////////////////////////////
+ht_t *
+ht_create_with_options
+(
+	size_t			 table_length,
+	ht_hash_size_t		 hash_size,
+	ht_seed_t		 seed,
+	void			*extra,
+	void			(*destroy_value)
+				(
+					void	*data,
+					void	*extra
+				),
+	void			(*destroy_extra)
+				(
+					void	*extra
+				),
+	const ht_options_t	*options
+);
+
 ////////////////////////////////////////////////////////////
 //	free a hash table
 //	- key will be copied, value will not be
@@ -93,6 +376,17 @@ ht_destroy
 	ht_t	*table
 );
 
+////////////////////////////////////////////////////////////
+//	ht_destroy with the entries freed by threads threads
+//	- see ht_parallel_clear_table
+////////////////////////////////////////////////////////////
+void
+ht_parallel_destroy
+(
+	ht_t		*table,
+	unsigned int	 threads
+);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //	MODIFICATION
@@ -148,11 +442,79 @@ ht_update_strict_with_prefix
 #define ht_update_strict(ht,value,value_length,key,key_length) \
 	ht_update_strict_with_prefix(ht,value,value_length,key,key_length,0)
 
+////////////////////////////////////////////////////////////
+//	get the value referenced by key, adding value if
+//		the key is not in use
+//	- one lookup, the key is copied and an entry
+//		allocated only if it is added
+//	- the stored value is put in destination, which
+//		can be NULL
+//		- with own_values this is the table's copy,
+//			which can be written in place
+//	- inserted, if not NULL, is set to 1 if the key
+//		was added, 0 if it was in use
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_get_or_insert_with_prefix
+(
+	ht_t		 *ht,
+	void		 *value,
+	size_t		  value_length,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *destination_length,
+	int		 *inserted,
+	ht_prefix	 *prefix
+);
+#define ht_get_or_insert(ht,value,value_length,key,key_length,destination,destination_length,inserted) \
+	ht_get_or_insert_with_prefix(ht,value,value_length,key,key_length,destination,destination_length,inserted,0)
+
+////////////////////////////////////////////////////////////
+//	add value if key is not in use, otherwise merge
+//		into the stored value
+//	- one lookup, like ht_get_or_insert
+//	- merge is passed the stored value and its length,
+//		and can change the bytes in place or point
+//		them at another value
+//		- with own_values a new pointer or length is
+//			copied into the table, as in ht_update
+//		- concurrent tables run merge on a new entry
+//			under the bucket's lock, so it must
+//			point at another value rather than
+//			write to one readers may be reading
+//	- merge must not modify the table
+//	- inserted can be NULL
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_upsert_with_prefix
+(
+	ht_t		*ht,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	void		(*merge)
+			(
+				void	**value,
+				size_t	 *value_length,
+				void	 *context
+			),
+	void		*context,
+	int		*inserted,
+	ht_prefix	*prefix
+);
+#define ht_upsert(ht,value,value_length,key,key_length,merge,context,inserted) \
+	ht_upsert_with_prefix(ht,value,value_length,key,key_length,merge,context,inserted,0)
+
 ////////////////////////////////////////////////////////////
 //	get value from key
 //	- stored in destination
 //	- destination can be NULL
 //		- return value indicates key is in use
+//	- on concurrent tables the value can be destroyed
+//		by a concurrent remove or update of the key,
+//		use ht_get_into to copy it instead
 ////////////////////////////////////////////////////////////
 ht_status_t
 ht_get_with_prefix
@@ -173,6 +535,7 @@ ht_get_with_prefix
 //	- destination can be NULL
 //		- return value indicates key is in use
 //	- must be freed by the user
+//	- ht_get_into copies without allocating
 ////////////////////////////////////////////////////////////
 ht_status_t
 ht_get_copy_with_prefix
@@ -187,6 +550,28 @@ ht_get_copy_with_prefix
 #define ht_get_copy(ht,key,key_length,destination,value_length) \
 	ht_get_copy_with_prefix(ht,key,key_length,destination,value_length,0)
 
+////////////////////////////////////////////////////////////
+//	copy value from key into buffer
+//	- the value's length is stored in value_length,
+//		which can be NULL
+//	- returns HT_BUFFER_TOO_SMALL, copying nothing, if
+//		the value is longer than buffer_length
+//	- buffer can be NULL to only get the length
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_get_into_with_prefix
+(
+	ht_t		*ht,
+	const void	*key,
+	size_t		 key_length,
+	void		*buffer,
+	size_t		 buffer_length,
+	size_t		*value_length,
+	ht_prefix	*prefix
+);
+#define ht_get_into(ht,key,key_length,buffer,buffer_length,value_length) \
+	ht_get_into_with_prefix(ht,key,key_length,buffer,buffer_length,value_length,0)
+
 ////////////////////////////////////////////////////////////
 //	remove an element from the table using a key
 ////////////////////////////////////////////////////////////
@@ -210,8 +595,30 @@ ht_clear_table
 	ht_t	*ht
 );
 
+////////////////////////////////////////////////////////////
+//	ht_clear_table with the entries freed by threads
+//		threads, each taking ranges of buckets
+//	- destroy_value is called from several threads at
+//		once and must be safe to
+//	- threads are started for the call and joined
+//		before it returns, 0 or 1 clears on the
+//		calling thread
+//	- concurrent tables are cleared on the calling
+//		thread
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_parallel_clear_table
+(
+	ht_t		*ht,
+	unsigned int	 threads
+);
+
 ////////////////////////////////////////////////////////////
 //	resize the table
+//	- entries are moved into the new buckets, keys are
+//		neither rehashed nor copied
+//	- open and cuckoo layout tables are rounded up to a
+//		power of two large enough to hold every entry
 ////////////////////////////////////////////////////////////
 ht_status_t
 ht_resize_table
@@ -238,12 +645,747 @@ ht_iterate
 		)
 );
 
+////////////////////////////////////////////////////////////
+//	ht_iterate with context passed to every call
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_iterate_with_context
+(
+	ht_t	*ht,
+	void	(*function)
+		(
+			void	*value,
+			size_t	 value_length,
+			void	*key,
+			size_t	 key_length,
+			size_t	 index,
+			void	*context
+		),
+	void	*context
+);
+
+////////////////////////////////////////////////////////////
+//	ht_iterate_with_context split over threads threads
+//	- threads take ranges of buckets until none are
+//		left, thread i passes contexts[i] to
+//		function, so per thread results can be
+//		kept without locks
+//	- contexts can be NULL, every call then gets NULL
+//	- entries are visited in no particular order, the
+//		table must not be modified until it returns,
+//		except concurrent tables
+//	- threads are started for the call and joined
+//		before it returns
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_parallel_iterate
+(
+	ht_t		 *ht,
+	unsigned int	  threads,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		**contexts
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	CURSORS
+//	- a cursor walks the table a few entries per call, with
+//		the table free to change between calls
+//	- every entry in the table for the whole walk is
+//		visited at least once, entries added or removed
+//		meanwhile may or may not be, and entries can be
+//		visited more than once
+//	- HT_INDEX_MASK and HT_INDEX_FASTRANGE tables walk
+//		buckets in hash order and carry on through
+//		resizes, others start over when a resize or
+//		rehash moved entries since the last call, and
+//		may not finish while they keep happening
+//		- a cuckoo layout add that moves entries to
+//			make room counts as a rehash
+//	- every table starts over after a reseed, see
+//		max_chain_length
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	uint64_t	position;
+	uint64_t	moves;
+	int		finished;
+} ht_cursor_t;
+
+////////////////////////////////////////////////////////////
+//	pass entries from the cursor onwards through a
+//		function until count entries have been passed
+//		or the walk is finished
+//	- cursor must start zeroed, finished is set when
+//		every bucket has been visited
+//	- buckets are not split, so a call can pass more
+//		than count entries
+//	- the table must not be modified during a call,
+//		except concurrent tables
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_cursor_next
+(
+	ht_t		*ht,
+	ht_cursor_t	*cursor,
+	size_t		 count,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		*context
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	BATCHES
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	get the values of count keys
+//	- same as ht_get_with_prefix on each key, with
+//		the status of key i in statuses[i]
+//	- keys are hashed and their buckets prefetched a
+//		batch at a time, so the cache misses of
+//		different keys overlap
+//	- keys shorter than 192 bytes with no prefix are
+//		hashed several at a time with AVX2 or
+//		AVX-512 when the CPU has them, grouped by
+//		length; hashes equal ht_get_with_prefix's
+//	- destinations and value_lengths can be NULL
+//		together, statuses can be NULL
+//	- return value is HT_SUCCESS if every key was
+//		found, otherwise the first failing status
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_get_many_with_prefix
+(
+	ht_t		 *ht,
+	size_t		  count,
+	const void	**keys,
+	const size_t	 *key_lengths,
+	void		**destinations,
+	size_t		 *value_lengths,
+	ht_status_t	 *statuses,
+	ht_prefix	 *prefix
+);
+#define ht_get_many(ht,count,keys,key_lengths,destinations,value_lengths,statuses) \
+	ht_get_many_with_prefix(ht,count,keys,key_lengths,destinations,value_lengths,statuses,0)
+
+////////////////////////////////////////////////////////////
+//	add count value,key pairs to the hash table
+//	- same as ht_add_with_prefix on each pair, with
+//		the status of pair i in statuses[i]
+//	- keys are hashed as in ht_get_many_with_prefix
+//	- statuses can be NULL
+//	- return value is HT_SUCCESS if every pair was
+//		added, otherwise the first failing status
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_add_many_with_prefix
+(
+	ht_t		 *ht,
+	size_t		  count,
+	void		**values,
+	const size_t	 *value_lengths,
+	const void	**keys,
+	const size_t	 *key_lengths,
+	ht_status_t	 *statuses,
+	ht_prefix	 *prefix
+);
+#define ht_add_many(ht,count,values,value_lengths,keys,key_lengths,statuses) \
+	ht_add_many_with_prefix(ht,count,values,value_lengths,keys,key_lengths,statuses,0)
+
+////////////////////////////////////////////////////////////////////////////////
+//	BULK LOADING
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	const void	*key;
+	size_t		 key_length;
+	void		*value;
+	size_t		 value_length;
+} ht_record_t;
+
+////////////////////////////////////////////////////////////
+//	what to do with a key given more than once, or
+//		already in the table
+//	- HT_DUPLICATES_REJECT: keep the first, report the
+//		others as HT_KEY_ALREADY_IN_USE
+//	- HT_DUPLICATES_KEEP_FIRST: keep the first quietly
+//	- HT_DUPLICATES_KEEP_LAST: the last value wins, as
+//		with ht_update
+//	- first and last are in record order, a key already
+//		in the table comes before every record
+////////////////////////////////////////////////////////////
+typedef enum
+{
+	HT_DUPLICATES_REJECT = 0,
+	HT_DUPLICATES_KEEP_FIRST,
+	HT_DUPLICATES_KEEP_LAST,
+} ht_duplicates_t;
+
+////////////////////////////////////////////////////////////
+//	add count records to the hash table at once
+//	- same result as adding them one by one, with
+//		duplicates handled as given
+//	- chained tables that grow are first resized to
+//		hold every record under max_load_factor,
+//		fixed length tables keep their length
+//	- records are hashed, then sorted by bucket with a
+//		radix pass, then each range of buckets has its
+//		chains built in one sweep, so no chain is
+//		walked more than its own records need
+//	- threads
+//		- number of threads to use, counting the
+//			caller, 0 or 1 runs everything on the
+//			caller's thread
+//	- pooled tables carve the entries from slabs, other
+//		tables allocate each entry and key copy
+//	- open and concurrent tables add the records one by
+//		one
+//	- statuses can be NULL, otherwise statuses[i] is
+//		the status of record i
+//	- return value is HT_SUCCESS if every record was
+//		loaded, otherwise the first failing status
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_bulk_load_with_prefix
+(
+	ht_t			*ht,
+	const ht_record_t	*records,
+	size_t			 count,
+	ht_duplicates_t		 duplicates,
+	unsigned int		 threads,
+	ht_status_t		*statuses,
+	ht_prefix		*prefix
+);
+#define ht_bulk_load(ht,records,count,duplicates,threads,statuses) \
+	ht_bulk_load_with_prefix(ht,records,count,duplicates,threads,statuses,0)
+
+////////////////////////////////////////////////////////////
+//	ht_bulk_load_with_prefix on the records next
+//		returns
+//	- next fills in record and returns non zero, or
+//		returns 0 once there are no more records
+//	- records are gathered before loading, so keys and
+//		values must stay valid until the call returns
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_bulk_load_from_with_prefix
+(
+	ht_t			*ht,
+	int			(*next)
+				(
+					ht_record_t	*record,
+					void		*context
+				),
+	void			*context,
+	ht_duplicates_t		 duplicates,
+	unsigned int		 threads,
+	ht_prefix		*prefix
+);
+#define ht_bulk_load_from(ht,next,context,duplicates,threads) \
+	ht_bulk_load_from_with_prefix(ht,next,context,duplicates,threads,0)
+
+////////////////////////////////////////////////////////////////////////////////
+//	SNAPSHOTS
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	save the table to a file ht_map can map
+//	- writes every key and value_length bytes of every
+//		value, with the seed, hash size and hash
+//		function name, so the mapped table finds the
+//		same keys
+//	- the file is written next to path and renamed
+//		over it once complete
+//	- a concurrent table may be saved while in use,
+//		entries changed meanwhile may or may not be in
+//		the file
+//	- returns HT_IO_ERROR if the file cannot be
+//		written
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_save
+(
+	ht_t		*ht,
+	const char	*path
+);
+
+////////////////////////////////////////////////////////////
+//	map a file written by ht_save as a read only table
+//	- nothing is read up front, pages of the file are
+//		read in as lookups touch them, and processes
+//		mapping the same file share its pages
+//	- ht_get, ht_get_copy, ht_iterate and the batch gets
+//		work as usual, values returned by ht_get point
+//		into the mapping and must not be written
+//	- adds, updates, removes, ht_clear_table and
+//		ht_resize_table return HT_READ_ONLY_TABLE
+//	- safe to read from many threads at once
+//	- hash_function
+//		- the function the table was saved with, NULL
+//			to look it up by name among the built in
+//			ones
+//	- ht_destroy unmaps the file, values are not
+//		destroyed
+//	- returns NULL if the file cannot be mapped, is not
+//		a snapshot, was saved on a machine of another
+//		byte order or names another hash function
+//	- the file is trusted, records are not checked
+////////////////////////////////////////////////////////////
+ht_t *
+ht_map
+(
+	const char			*path,
+	const ht_hash_function_t	*hash_function
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	NAMESPACES
+//	- tables created with the namespaces option list the
+//		entries added through a prefix under the prefix's
+//		bytes, so one prefix's entries can be visited or
+//		removed without walking the whole table
+//	- prefixes with the same bytes share a namespace, keys
+//		added without a prefix are in none, even if they
+//		start with a prefix's bytes
+//	- the functions return HT_NO_NAMESPACES for tables
+//		without the option
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	for each entry added through prefix, pass it
+//		through a function
+//	- index counts the entries of the namespace
+//	- the table must not be modified until it returns
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_iterate_namespace
+(
+	ht_t		*ht,
+	ht_prefix	*prefix,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		*context
+);
+
+////////////////////////////////////////////////////////////
+//	remove every entry added through prefix
+//	- same as ht_remove_with_prefix on each of them, the
+//		table may shrink once afterwards
+//	- the number removed is stored in removed, which can
+//		be NULL
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_remove_namespace
+(
+	ht_t		*ht,
+	ht_prefix	*prefix,
+	size_t		*removed
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	STATISTICS
+//	- ht_stats reports how a table's entries are spread
+//		and how much memory it holds
+//	- for the open layout the buckets are slots and a
+//		chain is the groups probed to reach an entry
+//	- for the cuckoo layout the buckets are slots and a
+//		chain is 1 for an entry in its first bucket,
+//		2 in its second and 3 in the stash
+////////////////////////////////////////////////////////////////////////////////
+#define HT_STATS_HISTOGRAM	16
+
+////////////////////////////////////////////////////////////
+//	bytes held by a table, as requested from malloc
+//	- table: the ht_t and any concurrency state
+//	- buckets: bucket arrays, or control bytes and
+//		slots
+//	- entries: chain entries, or the slabs they are
+//		carved from
+//	- keys: key copies not stored in an entry
+//	- values: owned values not stored in an entry
+//	- namespaces: the namespace table and namespaces
+//	- mapped: the file of a table from ht_map, which
+//		is not heap memory and is not in total
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	size_t	table;
+	size_t	buckets;
+	size_t	entries;
+	size_t	keys;
+	size_t	values;
+	size_t	namespaces;
+	size_t	mapped;
+	size_t	total;
+} ht_memory_t;
+
+////////////////////////////////////////////////////////////
+//	- chain_lengths[i] is the number of buckets with
+//		chains of i entries, the last counting every
+//		longer chain too
+//		- for the open and cuckoo layouts, the number
+//			of entries found in the ith group or
+//			bucket probed, from 1
+//	- probe lengths are the mean number of entries
+//		compared, or groups or buckets probed, to
+//		find an entry
+//		- expected is what a uniform hash gives at
+//			this load factor, 1 for the open and
+//			cuckoo layouts
+//	- when sampled_buckets is less than num_of_buckets,
+//		counts gathered from the buckets are scaled up
+//		from the sample
+//	- reseeds counts the times max_chain_length made
+//		the table pick a new seed
+////////////////////////////////////////////////////////////
+typedef struct
+{
+	size_t		num_of_entries;
+	size_t		num_of_buckets;
+	size_t		sampled_buckets;
+	double		load_factor;
+	size_t		empty_buckets;
+	double		empty_bucket_ratio;
+	size_t		chain_lengths[HT_STATS_HISTOGRAM];
+	size_t		max_chain_length;
+	double		expected_probe_length;
+	double		observed_probe_length;
+	size_t		reseeds;
+	ht_memory_t	memory;
+} ht_stats_t;
+
+////////////////////////////////////////////////////////////
+//	gather statistics on a table into stats
+//	- sample
+//		- 0 visits every bucket and every entry
+//		- otherwise visits about sample buckets, spread
+//			evenly over the table, so the cost does
+//			not grow with the table
+//		- max_chain_length is then the longest chain
+//			sampled
+//	- concurrent tables can be modified during the call,
+//		other tables must not be
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_stats
+(
+	ht_t		*ht,
+	size_t		 sample,
+	ht_stats_t	*stats
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	INSTRUMENTATION
+//	- compiled in by building ht_spookyhash.c with HT_INSTRUMENT
+//		defined, otherwise the functions return
+//		HT_NOT_INSTRUMENTED and operations carry no hooks
+//	- one in HT_INSTRUMENT_SAMPLE operations on each thread
+//		is sampled, 100 unless defined at build time, its
+//		probes counted
+//	- one in HT_INSTRUMENT_TIME_SAMPLE sampled operations on
+//		each thread is also timed, 100 unless defined at
+//		build time, so one in 10000 by default, and every
+//		resize is
+//		- a chained table growing or shrinking on its
+//			own is timed only for its new bucket
+//			array, the moves are part of later
+//			operations
+//	- where <sys/sdt.h> is found, USDT probes are placed in
+//		provider ht
+//		- op__entry(op,key,key_length)
+//		- op__hashed(op,hash)
+//		- op__exit(op,status,probes)
+//		- alloc(node_size,key_length)
+//		- resize__entry(old_length,new_length)
+//		- resize__exit(new_length)
+////////////////////////////////////////////////////////////////////////////////
+typedef enum
+{
+	HT_OP_ADD = 0,
+	HT_OP_GET,
+	HT_OP_UPDATE,
+	HT_OP_REMOVE,
+	HT_OP_RESIZE,
+	HT_NUM_OF_OPS,
+} ht_op_t;
+
+////////////////////////////////////////////////////////////
+//	latencies are counted in nanoseconds, in buckets
+//		0 to 3 one nanosecond wide, then four to each
+//		power of two
+//	- the last bucket also counts every longer latency
+//	- a probe is an entry, open layout group or cuckoo
+//		bucket looked at while searching for a key
+//	- sampled operations are counted in probes and
+//		probe_counts, timed ones in latency
+////////////////////////////////////////////////////////////
+#define HT_LATENCY_BUCKETS	160
+#define HT_PROBE_BUCKETS	32
+
+typedef struct
+{
+	uint64_t	sampled;
+	uint64_t	timed;
+	uint64_t	probes;
+	uint64_t	latency[HT_LATENCY_BUCKETS];
+	uint64_t	probe_counts[HT_PROBE_BUCKETS];
+} ht_op_stats_t;
+
+////////////////////////////////////////////////////////////
+//	copy the counts gathered so far, for every table,
+//		into stats, indexed by ht_op_t
+//	- gets are ht_get, ht_get_copy and ht_get_into,
+//		updates include ht_update_strict, ht_upsert
+//		and ht_get_or_insert
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_instrument_read
+(
+	ht_op_stats_t	stats[HT_NUM_OF_OPS]
+);
+
+////////////////////////////////////////////////////////////
+//	zero the counts
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_instrument_reset
+(
+	void
+);
+
+////////////////////////////////////////////////////////////
+//	the shortest latency in nanoseconds counted in
+//		latency bucket
+////////////////////////////////////////////////////////////
+uint64_t
+ht_latency_bucket_floor
+(
+	size_t	bucket
+);
+
+////////////////////////////////////////////////////////////////////////////////
+//	SHARDED TABLES
+//	- an ht_sharded_t is num_of_shards tables, each behind a lock of
+//		its own, for many threads writing at once
+//	- a key is hashed once and its shard picked from hash bits the
+//		shards' buckets do not use, so shards fill evenly and
+//		keep their spread
+//	- a shard grows and shrinks on its own, holding only its own
+//		lock, so the other shards carry on
+////////////////////////////////////////////////////////////////////////////////
+typedef struct ht_sharded_t ht_sharded_t;
+
+#define HT_MAX_SHARDS	256
+
+////////////////////////////////////////////////////////////
+//	create a sharded table
+//	- num_of_shards is rounded up to a power of two, at
+//		most HT_MAX_SHARDS
+//	- table_length is split between the shards
+//	- every shard is created with hash_size, seed and
+//		options, as ht_create_with_options
+//	- destroy_value is called for each shard's values,
+//		destroy_extra once, by ht_sharded_destroy
+//	- concurrent, namespaces and max_chain_length
+//		options return NULL
+////////////////////////////////////////////////////////////
+ht_sharded_t *
+ht_sharded_create
+(
+	size_t			 num_of_shards,
+	size_t			 table_length,
+	ht_hash_size_t		 hash_size,
+	ht_seed_t		 seed,
+	void			*extra,
+	void			(*destroy_value)
+				(
+					void	*data,
+					void	*extra
+				),
+	void			(*destroy_extra)
+				(
+					void	*extra
+				),
+	const ht_options_t	*options
+);
+
+////////////////////////////////////////////////////////////
+//	free a sharded table and every shard
+//	- must not race with anything
+////////////////////////////////////////////////////////////
+void
+ht_sharded_destroy
+(
+	ht_sharded_t	*table
+);
+
+////////////////////////////////////////////////////////////
+//	same as ht_add_with_prefix, ht_update_with_prefix,
+//		ht_get_copy_with_prefix, ht_get_into_with_prefix
+//		and ht_remove_with_prefix, holding the lock of
+//		the key's shard
+//	- values are only copied out under the lock, a
+//		pointer into a shard could be freed by another
+//		thread as soon as it is released
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_sharded_add_with_prefix
+(
+	ht_sharded_t	*table,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+);
+#define ht_sharded_add(table,value,value_length,key,key_length) \
+	ht_sharded_add_with_prefix(table,value,value_length,key,key_length,0)
+
+ht_status_t
+ht_sharded_update_with_prefix
+(
+	ht_sharded_t	*table,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+);
+#define ht_sharded_update(table,value,value_length,key,key_length) \
+	ht_sharded_update_with_prefix(table,value,value_length,key,key_length,0)
+
+ht_status_t
+ht_sharded_get_copy_with_prefix
+(
+	ht_sharded_t	 *table,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *value_length,
+	ht_prefix	 *prefix
+);
+#define ht_sharded_get_copy(table,key,key_length,destination,value_length) \
+	ht_sharded_get_copy_with_prefix(table,key,key_length,destination,value_length,0)
+
+ht_status_t
+ht_sharded_get_into_with_prefix
+(
+	ht_sharded_t	*table,
+	const void	*key,
+	size_t		 key_length,
+	void		*buffer,
+	size_t		 buffer_length,
+	size_t		*value_length,
+	ht_prefix	*prefix
+);
+#define ht_sharded_get_into(table,key,key_length,buffer,buffer_length,value_length) \
+	ht_sharded_get_into_with_prefix(table,key,key_length,buffer,buffer_length,value_length,0)
+
+ht_status_t
+ht_sharded_remove_with_prefix
+(
+	ht_sharded_t	*table,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+);
+#define ht_sharded_remove(table,key,key_length) \
+	ht_sharded_remove_with_prefix(table,key,key_length,0)
+
+////////////////////////////////////////////////////////////
+//	ht_clear_table on each shard in turn, holding one
+//		shard's lock at a time
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_sharded_clear_table
+(
+	ht_sharded_t	*table
+);
+
+////////////////////////////////////////////////////////////
+//	ht_resize_table each shard in turn to its share of
+//		num_of_entries, holding one shard's lock at
+//		a time
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_sharded_resize_table
+(
+	ht_sharded_t	*table,
+	size_t		 num_of_entries
+);
+
+////////////////////////////////////////////////////////////
+//	ht_stats over every shard, summed into stats
+//	- each shard is locked while it is gathered, so
+//		the sum is not a snapshot
+//	- sample is split between the shards
+//	- max_chain_length is the longest in any shard,
+//		probe lengths are averaged over the entries
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_sharded_stats
+(
+	ht_sharded_t	*table,
+	size_t		 sample,
+	ht_stats_t	*stats
+);
+
+////////////////////////////////////////////////////////////
+//	ht_parallel_iterate over the shards
+//	- threads take whole shards until none are left,
+//		locking each while it is iterated, so
+//		writers only wait for the shard being read
+//	- thread i passes contexts[i] to function,
+//		contexts can be NULL
+//	- index is the entry's bucket in its shard
+//	- function must not call into the sharded table
+////////////////////////////////////////////////////////////
+ht_status_t
+ht_sharded_parallel_iterate
+(
+	ht_sharded_t	 *table,
+	unsigned int	  threads,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		**contexts
+);
+
 ////////////////////////////////////////////////////////////////////////////////
 //	PREFIX
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 //	create a prefix
 //	- key_prefix is the initial portion of a key value
+//	- a key used with a prefix hashes exactly as the
+//		prefix and key joined, with the table's seed,
+//		so it can be found with or without the prefix
+//	- can be shared between tables and threads
 ////////////////////////////////////////////////////////////
 ht_prefix *
 ht_create_prefix
@@ -296,4 +1438,8 @@ ht_prefix_key
 	size_t		 *key_prefix_length
 );
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __HT */
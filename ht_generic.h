@@ -0,0 +1,594 @@
+#ifndef __HT_GENERIC
+#define __HT_GENERIC
+
+#include "ht.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//	SPECIALIZED TABLES
+//	- HT_GENERIC(name,key_type,value_type,hash,equal) expands to a hash table
+//		for one key type and one value type, with the key and value stored
+//		in the table's own slot array
+//	- no entry is allocated on its own, and hash and equal are called
+//		directly, so they inline
+//	- keys and values are copied by assignment and dropped without any
+//		destructor, so they should be plain data
+//	- the table is open addressed with one control byte per slot
+//		- empty slots hold HT_GENERIC_EMPTY, removed slots
+//			HT_GENERIC_DELETED, full slots the top 7 bits of the hash
+//		- the low bits of the hash pick the first slot, collisions step
+//			to the next slot
+//		- the table doubles once 7/8 of its slots are full or removed
+////////////////////////////////////////////////////////////////////////////////
+#define HT_GENERIC_EMPTY	0x80
+#define HT_GENERIC_DELETED	0xfe
+
+////////////////////////////////////////////////////////////
+//	hash and equal functions
+//	- hash is called as hash(const key_type *key,uint64_t
+//		seed) and returns a uint64_t whose high and low
+//		bits are both well mixed
+//	- equal is called as equal(const key_type *a,const
+//		key_type *b) and returns non zero if equal
+//	- ht_generic_hash_u64, ht_generic_equal_u64: 8 byte
+//		keys such as uint64_t
+//	- ht_generic_hash_u128, ht_generic_equal_u128: 16
+//		byte keys such as UUIDs
+//	- ht_generic_hash_bytes: any length, for wrapping
+//		other key types
+////////////////////////////////////////////////////////////
+static
+inline
+uint64_t
+ht_generic_mix64
+(
+	uint64_t	x
+)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static
+inline
+uint64_t
+ht_generic_hash_bytes
+(
+	const void	*key,
+	size_t		 key_length,
+	uint64_t	 seed
+)
+{
+	const uint8_t *p = (const uint8_t *) key;
+	uint64_t h = seed ^ (key_length * 0x9e3779b97f4a7c15ULL);
+
+	for(; key_length >= 8; key_length -= 8, p += 8)
+	{
+		uint64_t w;
+		memcpy(&w,p,sizeof(w));
+		h = ht_generic_mix64(h ^ w);
+	}
+
+	if(key_length > 0)
+	{
+		uint64_t w = 0;
+		memcpy(&w,p,key_length);
+		h = ht_generic_mix64(h ^ w);
+	}
+
+	return h;
+}
+
+static
+inline
+uint64_t
+ht_generic_hash_u64
+(
+	const void	*key,
+	uint64_t	 seed
+)
+{
+	uint64_t w;
+	memcpy(&w,key,sizeof(w));
+	return ht_generic_mix64(w ^ seed);
+}
+
+static
+inline
+int
+ht_generic_equal_u64
+(
+	const void	*a,
+	const void	*b
+)
+{
+	return memcmp(a,b,8) == 0;
+}
+
+static
+inline
+uint64_t
+ht_generic_hash_u128
+(
+	const void	*key,
+	uint64_t	 seed
+)
+{
+	uint64_t w[2];
+	memcpy(w,key,sizeof(w));
+	return ht_generic_mix64(ht_generic_mix64(w[0] ^ seed) + w[1]);
+}
+
+static
+inline
+int
+ht_generic_equal_u128
+(
+	const void	*a,
+	const void	*b
+)
+{
+	return memcmp(a,b,16) == 0;
+}
+
+////////////////////////////////////////////////////////////
+//	generated types
+//	- name##_slot_t: one key and its value
+//	- name##_t: the table
+////////////////////////////////////////////////////////////
+#define HT_GENERIC_TYPES(name,key_type,value_type) \
+	typedef struct \
+	{ \
+		key_type	key; \
+		value_type	value; \
+	} name##_slot_t; \
+	\
+	typedef struct \
+	{ \
+		uint8_t		*control; \
+		name##_slot_t	*slots; \
+		size_t		 capacity; \
+		size_t		 num_of_entries; \
+		size_t		 growth_left; \
+		uint64_t	 seed; \
+	} name##_t;
+
+////////////////////////////////////////////////////////////
+//	generated functions
+//	- storage is put in front of each function, static
+//		inline at file scope, static inside a C++ class
+//	- name##_create(table_length,seed)
+//		- room for table_length entries before the
+//			first growth
+//		- returns NULL if out of memory
+//	- name##_destroy(table)
+//	- name##_add(table,key,value)
+//		- HT_KEY_ALREADY_IN_USE if key is present
+//	- name##_update(table,key,value)
+//		- adds, or replaces the value of a present key
+//	- name##_update_strict(table,key,value)
+//		- HT_KEY_NOT_IN_USE if key is absent
+//	- name##_get(table,key,destination)
+//		- copies the value, destination can be NULL
+//	- name##_find(table,key)
+//		- pointer to the value in the table, NULL if key
+//			is absent
+//		- valid until the next add, update or clear
+//	- name##_remove(table,key)
+//	- name##_clear(table)
+//	- name##_iterate(table,function,context)
+//		- calls function(key,value,context) on every
+//			entry, function must not add or remove
+//	- name##_size(table)
+//	- add and update return HT_NONPOSITIVE_LENGTH if the
+//		table cannot grow
+////////////////////////////////////////////////////////////
+#define HT_GENERIC_FUNCTIONS(storage,name,key_type,value_type,hash,equal) \
+	storage \
+	size_t \
+	name##_capacity_for \
+	( \
+		size_t	table_length \
+	) \
+	{ \
+		size_t c = 8; \
+		while(c - c / 8 < table_length) \
+		{ \
+			c <<= 1; \
+		} \
+		return c; \
+	} \
+	\
+	storage \
+	int \
+	name##_allocate \
+	( \
+		name##_t	*t, \
+		size_t		 capacity \
+	) \
+	{ \
+		uint8_t *control = (uint8_t *) malloc(capacity); \
+		name##_slot_t *slots = (name##_slot_t *) malloc(capacity * sizeof(name##_slot_t)); \
+		\
+		if(control == 0 || slots == 0) \
+		{ \
+			free(control); \
+			free(slots); \
+			return 0; \
+		} \
+		\
+		memset(control,HT_GENERIC_EMPTY,capacity); \
+		\
+		t->control = control; \
+		t->slots = slots; \
+		t->capacity = capacity; \
+		t->growth_left = capacity - capacity / 8; \
+		\
+		return 1; \
+	} \
+	\
+	storage \
+	name##_t * \
+	name##_create \
+	( \
+		size_t		table_length, \
+		uint64_t	seed \
+	) \
+	{ \
+		name##_t *t = (name##_t *) malloc(sizeof(name##_t)); \
+		if(t == 0) \
+		{ \
+			return 0; \
+		} \
+		\
+		t->num_of_entries = 0; \
+		t->seed = seed; \
+		\
+		if(!name##_allocate(t,name##_capacity_for(table_length))) \
+		{ \
+			free(t); \
+			return 0; \
+		} \
+		\
+		return t; \
+	} \
+	\
+	storage \
+	void \
+	name##_destroy \
+	( \
+		name##_t	*t \
+	) \
+	{ \
+		if(t == 0) \
+		{ \
+			return; \
+		} \
+		\
+		free(t->control); \
+		free(t->slots); \
+		free(t); \
+	} \
+	\
+	storage \
+	size_t \
+	name##_probe \
+	( \
+		name##_t	 *t, \
+		const key_type	 *key, \
+		uint64_t	  h \
+	) \
+	{ \
+		size_t mask = t->capacity - 1; \
+		uint8_t h2 = (uint8_t) (h >> 57); \
+		\
+		for(size_t i = h & mask;; i = (i + 1) & mask) \
+		{ \
+			uint8_t c = t->control[i]; \
+			if(c == HT_GENERIC_EMPTY) \
+			{ \
+				return t->capacity; \
+			} \
+			if(c == h2 && equal(&t->slots[i].key,key)) \
+			{ \
+				return i; \
+			} \
+		} \
+	} \
+	\
+	storage \
+	size_t \
+	name##_probe_free \
+	( \
+		name##_t	*t, \
+		uint64_t	 h \
+	) \
+	{ \
+		size_t mask = t->capacity - 1; \
+		size_t i = h & mask; \
+		\
+		while(!(t->control[i] & HT_GENERIC_EMPTY)) \
+		{ \
+			i = (i + 1) & mask; \
+		} \
+		\
+		return i; \
+	} \
+	\
+	storage \
+	int \
+	name##_rehash \
+	( \
+		name##_t	*t, \
+		size_t		 capacity \
+	) \
+	{ \
+		uint8_t *control = t->control; \
+		name##_slot_t *slots = t->slots; \
+		size_t old_capacity = t->capacity; \
+		\
+		if(!name##_allocate(t,capacity)) \
+		{ \
+			return 0; \
+		} \
+		\
+		for(size_t i = 0; i < old_capacity; i++) \
+		{ \
+			if(control[i] & HT_GENERIC_EMPTY) \
+			{ \
+				continue; \
+			} \
+			\
+			uint64_t h = hash(&slots[i].key,t->seed); \
+			size_t j = name##_probe_free(t,h); \
+			\
+			t->control[j] = (uint8_t) (h >> 57); \
+			t->slots[j] = slots[i]; \
+		} \
+		\
+		t->growth_left -= t->num_of_entries; \
+		\
+		free(control); \
+		free(slots); \
+		\
+		return 1; \
+	} \
+	\
+	storage \
+	size_t \
+	name##_insert_slot \
+	( \
+		name##_t	*t, \
+		uint64_t	 h \
+	) \
+	{ \
+		size_t i = name##_probe_free(t,h); \
+		\
+		if(t->control[i] == HT_GENERIC_EMPTY && t->growth_left == 0) \
+		{ \
+			size_t capacity = t->capacity; \
+			if(t->num_of_entries + 1 > (capacity - capacity / 8) / 2) \
+			{ \
+				capacity *= 2; \
+			} \
+			if(!name##_rehash(t,capacity)) \
+			{ \
+				return t->capacity; \
+			} \
+			i = name##_probe_free(t,h); \
+		} \
+		\
+		if(t->control[i] == HT_GENERIC_EMPTY) \
+		{ \
+			t->growth_left--; \
+		} \
+		t->control[i] = (uint8_t) (h >> 57); \
+		t->num_of_entries++; \
+		\
+		return i; \
+	} \
+	\
+	storage \
+	ht_status_t \
+	name##_add \
+	( \
+		name##_t	*t, \
+		key_type	 key, \
+		value_type	 value \
+	) \
+	{ \
+		uint64_t h = hash(&key,t->seed); \
+		\
+		if(name##_probe(t,&key,h) != t->capacity) \
+		{ \
+			return HT_KEY_ALREADY_IN_USE; \
+		} \
+		\
+		size_t i = name##_insert_slot(t,h); \
+		if(i == t->capacity) \
+		{ \
+			return HT_NONPOSITIVE_LENGTH; \
+		} \
+		\
+		t->slots[i].key = key; \
+		t->slots[i].value = value; \
+		\
+		return HT_SUCCESS; \
+	} \
+	\
+	storage \
+	ht_status_t \
+	name##_update \
+	( \
+		name##_t	*t, \
+		key_type	 key, \
+		value_type	 value \
+	) \
+	{ \
+		uint64_t h = hash(&key,t->seed); \
+		size_t i = name##_probe(t,&key,h); \
+		\
+		if(i == t->capacity) \
+		{ \
+			i = name##_insert_slot(t,h); \
+			if(i == t->capacity) \
+			{ \
+				return HT_NONPOSITIVE_LENGTH; \
+			} \
+			t->slots[i].key = key; \
+		} \
+		\
+		t->slots[i].value = value; \
+		\
+		return HT_SUCCESS; \
+	} \
+	\
+	storage \
+	ht_status_t \
+	name##_update_strict \
+	( \
+		name##_t	*t, \
+		key_type	 key, \
+		value_type	 value \
+	) \
+	{ \
+		size_t i = name##_probe(t,&key,hash(&key,t->seed)); \
+		\
+		if(i == t->capacity) \
+		{ \
+			return HT_KEY_NOT_IN_USE; \
+		} \
+		\
+		t->slots[i].value = value; \
+		\
+		return HT_SUCCESS; \
+	} \
+	\
+	storage \
+	value_type * \
+	name##_find \
+	( \
+		name##_t	*t, \
+		key_type	 key \
+	) \
+	{ \
+		size_t i = name##_probe(t,&key,hash(&key,t->seed)); \
+		\
+		return i == t->capacity ? 0 : &t->slots[i].value; \
+	} \
+	\
+	storage \
+	ht_status_t \
+	name##_get \
+	( \
+		name##_t	*t, \
+		key_type	 key, \
+		value_type	*destination \
+	) \
+	{ \
+		value_type *v = name##_find(t,key); \
+		\
+		if(v == 0) \
+		{ \
+			return HT_KEY_NOT_IN_USE; \
+		} \
+		\
+		if(destination != 0) \
+		{ \
+			*destination = *v; \
+		} \
+		\
+		return HT_SUCCESS; \
+	} \
+	\
+	storage \
+	ht_status_t \
+	name##_remove \
+	( \
+		name##_t	*t, \
+		key_type	 key \
+	) \
+	{ \
+		size_t i = name##_probe(t,&key,hash(&key,t->seed)); \
+		\
+		if(i == t->capacity) \
+		{ \
+			return HT_KEY_NOT_IN_USE; \
+		} \
+		\
+		if(t->control[(i + 1) & (t->capacity - 1)] == HT_GENERIC_EMPTY) \
+		{ \
+			t->control[i] = HT_GENERIC_EMPTY; \
+			t->growth_left++; \
+		} \
+		else \
+		{ \
+			t->control[i] = HT_GENERIC_DELETED; \
+		} \
+		t->num_of_entries--; \
+		\
+		return HT_SUCCESS; \
+	} \
+	\
+	storage \
+	void \
+	name##_clear \
+	( \
+		name##_t	*t \
+	) \
+	{ \
+		memset(t->control,HT_GENERIC_EMPTY,t->capacity); \
+		t->num_of_entries = 0; \
+		t->growth_left = t->capacity - t->capacity / 8; \
+	} \
+	\
+	storage \
+	void \
+	name##_iterate \
+	( \
+		name##_t	*t, \
+		void		(*function) \
+				( \
+					key_type	*key, \
+					value_type	*value, \
+					void		*context \
+				), \
+		void		*context \
+	) \
+	{ \
+		for(size_t i = 0; i < t->capacity; i++) \
+		{ \
+			if(!(t->control[i] & HT_GENERIC_EMPTY)) \
+			{ \
+				function(&t->slots[i].key,&t->slots[i].value,context); \
+			} \
+		} \
+	} \
+	\
+	storage \
+	size_t \
+	name##_size \
+	( \
+		name##_t	*t \
+	) \
+	{ \
+		return t->num_of_entries; \
+	}
+
+////////////////////////////////////////////////////////////
+//	declare a specialized table at file scope
+//	- e.g. HT_GENERIC(u64_table,uint64_t,void *,
+//		ht_generic_hash_u64,ht_generic_equal_u64)
+////////////////////////////////////////////////////////////
+#define HT_GENERIC(name,key_type,value_type,hash,equal) \
+	HT_GENERIC_TYPES(name,key_type,value_type) \
+	HT_GENERIC_FUNCTIONS(static inline,name,key_type,value_type,hash,equal)
+
+#endif /* __HT_GENERIC */
@@ -0,0 +1,242 @@
+#ifndef __HT_GENERIC_HPP
+#define __HT_GENERIC_HPP
+
+#include "ht_generic.h"
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ht
+{
+
+////////////////////////////////////////////////////////////////////////////////
+//	SPECIALIZED TABLES
+//	- ht::table<K,V,Hash,Equal> is the table HT_GENERIC generates, with
+//		the same functions as members
+//	- K and V must be trivially copyable
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	default hash
+//	- 8 and 16 byte keys use ht_generic_hash_u64 and
+//		ht_generic_hash_u128, other sizes
+//		ht_generic_hash_bytes, over the bytes of the key
+//	- keys with padding bytes need their own hash
+////////////////////////////////////////////////////////////
+template<typename K>
+struct mix_hash
+{
+	uint64_t
+	operator()
+	(
+		const K		&key,
+		uint64_t	 seed
+	) const
+	{
+		if(sizeof(K) == 8)
+		{
+			return ht_generic_hash_u64(&key,seed);
+		}
+		if(sizeof(K) == 16)
+		{
+			return ht_generic_hash_u128(&key,seed);
+		}
+		return ht_generic_hash_bytes(&key,sizeof(K),seed);
+	}
+};
+
+////////////////////////////////////////////////////////////
+//	compare keys byte for byte, for key types without ==
+////////////////////////////////////////////////////////////
+template<typename K>
+struct bytes_equal
+{
+	bool
+	operator()
+	(
+		const K	&a,
+		const K	&b
+	) const
+	{
+		return memcmp(&a,&b,sizeof(K)) == 0;
+	}
+};
+
+template<
+	typename K,
+	typename V,
+	typename Hash = mix_hash<K>,
+	typename Equal = std::equal_to<K>
+>
+class table
+{
+	static_assert(std::is_trivially_copyable<K>::value,"keys are copied bytewise");
+	static_assert(std::is_trivially_copyable<V>::value,"values are copied bytewise");
+
+	struct impl
+	{
+		static
+		uint64_t
+		hash
+		(
+			const K		*key,
+			uint64_t	 seed
+		)
+		{
+			return Hash()(*key,seed);
+		}
+
+		static
+		int
+		equal
+		(
+			const K	*a,
+			const K	*b
+		)
+		{
+			return Equal()(*a,*b);
+		}
+
+		HT_GENERIC_TYPES(t,K,V)
+		HT_GENERIC_FUNCTIONS(static,t,K,V,hash,equal)
+	};
+
+	typename impl::t_t	*t;
+
+public:
+	explicit
+	table
+	(
+		size_t		table_length = 0,
+		uint64_t	seed = 0
+	)
+		: t(impl::t_create(table_length,seed))
+	{
+		if(t == 0)
+		{
+			throw std::bad_alloc();
+		}
+	}
+
+	table
+	(
+		table	&&other
+	) noexcept
+		: t(other.t)
+	{
+		other.t = 0;
+	}
+
+	table &
+	operator=
+	(
+		table	&&other
+	) noexcept
+	{
+		std::swap(t,other.t);
+		return *this;
+	}
+
+	table(const table &) = delete;
+	table &operator=(const table &) = delete;
+
+	~table()
+	{
+		impl::t_destroy(t);
+	}
+
+	ht_status_t
+	add
+	(
+		const K	&key,
+		const V	&value
+	)
+	{
+		return impl::t_add(t,key,value);
+	}
+
+	ht_status_t
+	update
+	(
+		const K	&key,
+		const V	&value
+	)
+	{
+		return impl::t_update(t,key,value);
+	}
+
+	ht_status_t
+	update_strict
+	(
+		const K	&key,
+		const V	&value
+	)
+	{
+		return impl::t_update_strict(t,key,value);
+	}
+
+	V *
+	find
+	(
+		const K	&key
+	)
+	{
+		return impl::t_find(t,key);
+	}
+
+	ht_status_t
+	get
+	(
+		const K	&key,
+		V	&destination
+	)
+	{
+		return impl::t_get(t,key,&destination);
+	}
+
+	ht_status_t
+	remove
+	(
+		const K	&key
+	)
+	{
+		return impl::t_remove(t,key);
+	}
+
+	void
+	clear()
+	{
+		impl::t_clear(t);
+	}
+
+	size_t
+	size() const
+	{
+		return impl::t_size(t);
+	}
+
+	////////////////////////////////////////////////////////////
+	//	call function(key,value) on every entry
+	////////////////////////////////////////////////////////////
+	template<typename F>
+	void
+	iterate
+	(
+		F	function
+	)
+	{
+		impl::t_iterate(
+			t,
+			[](K *key,V *value,void *context)
+			{
+				(*static_cast<F *>(context))(*key,*value);
+			},
+			&function
+		);
+	}
+};
+
+} // namespace ht
+
+#endif /* __HT_GENERIC_HPP */
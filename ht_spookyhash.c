@@ -1,10 +1,36 @@
 #include "ht.h"
+#if defined(__has_include)
+#if __has_include("spookyhash.h")
+#include "spookyhash.h"
+#else
 #include "../hash/spookyhash/spookyhash.h"
+#endif
+#else
+#include "../hash/spookyhash/spookyhash.h"
+#endif
 
 #include <stdio.h>
 
 #include <limits.h>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HT_GROUP_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HT_GROUP_WIDTH 16
+#else
+#define HT_GROUP_WIDTH 8
+#endif
+
 #define TEST_NULL_TABLE(t_x) \
 	if(t_x == 0) \
 	{ \
@@ -36,527 +62,8984 @@
 	}
 
 ////////////////////////////////////////
-//	HASH DIFFUSE
+//	INSTRUMENTATION
+//	- without HT_INSTRUMENT every hook
+//		expands to nothing
+//	- probes are counted in a local as a
+//		key is searched for, then added
+//		to a per thread count, from 0 as
+//		each sampled operation begins, or
+//		each operation with USDT probes
+//	- a per thread countdown samples one
+//		operation in HT_INSTRUMENT_SAMPLE,
+//		another times one sampled
+//		operation in
+//		HT_INSTRUMENT_TIME_SAMPLE
+//	- sampled operations add to counts
+//		shared by every table, with
+//		relaxed atomics
+//		- sampled and timed are not kept,
+//			ht_instrument_read sums them
+//			from the histograms
+////////////////////////////////////////
+#ifdef HT_INSTRUMENT
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HT_USDT
+#endif
+#endif
+
+#ifdef HT_USDT
+#define HT_TRACE1(name,a)	DTRACE_PROBE1(ht,name,a)
+#define HT_TRACE2(name,a,b)	DTRACE_PROBE2(ht,name,a,b)
+#define HT_TRACE3(name,a,b,c)	DTRACE_PROBE3(ht,name,a,b,c)
+#else
+#define HT_TRACE1(name,a)	do {} while(0)
+#define HT_TRACE2(name,a,b)	do {} while(0)
+#define HT_TRACE3(name,a,b,c)	do {} while(0)
+#endif
+
+#ifndef HT_INSTRUMENT_SAMPLE
+#define HT_INSTRUMENT_SAMPLE	100
+#endif
+
+#ifndef HT_INSTRUMENT_TIME_SAMPLE
+#define HT_INSTRUMENT_TIME_SAMPLE	100
+#endif
+
+////////////////////////////////////////
+//	start of a sampled operation that is
+//		not timed, never a clock reading
 ////////////////////////////////////////
+#define HT_OP_UNTIMED	1
+
+static ht_op_stats_t ht_op_stats[HT_NUM_OF_OPS];
+static __thread size_t ht_op_probes;
+static __thread unsigned int ht_op_countdown;
+static __thread unsigned int ht_op_time_countdown;
+
 static
 inline
-uint32_t
-diffuse64_32
+uint64_t
+ht_now
 (
-	uint64_t	h
+	void
 )
 {
-	uint32_t *m;
-	m = (uint32_t *) &h;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
 
-	return m[0] ^ m[1];
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
 static
 inline
-uint64_t
-diffuse128_64
+size_t
+ht_latency_bucket
 (
-	uint64_t	h1,
-	uint64_t	h2
+	uint64_t	ns
 )
 {
-	return h1 ^ h2;
+	if(ns < 4)
+	{
+		return ns;
+	}
+
+	unsigned int e = 63 - __builtin_clzll(ns);
+	size_t b = (e - 1) * 4 + ((ns >> (e - 2)) & 3);
+
+	return b < HT_LATENCY_BUCKETS ? b : HT_LATENCY_BUCKETS - 1;
 }
 
 static
-inline
-uint32_t
-diffuse128_32
+void
+ht_op_record
 (
-	uint64_t	h1,
-	uint64_t	h2
+	ht_op_t		op,
+	size_t		probes
 )
 {
-	uint32_t m1 = diffuse64_32(h1);
-	uint32_t m2 = diffuse64_32(h2);
-	return m1 ^ m2;
+	ht_op_stats_t *s = &ht_op_stats[op];
+
+	__atomic_add_fetch(&s->probes,probes,__ATOMIC_RELAXED);
+	__atomic_add_fetch(
+		&s->probe_counts[probes < HT_PROBE_BUCKETS ? probes : HT_PROBE_BUCKETS - 1],
+		1,
+		__ATOMIC_RELAXED
+	);
 }
 
-struct ht_prefix
-{
-	void			*prefix;
-	size_t			 prefix_length;
-	spookyhash_state_t	*state;
-};
-
-////////////////////////////////////////
-//	HASH TABLE STRUCTS
-////////////////////////////////////////
-typedef struct ht_entry_t ht_entry_t;
-struct ht_entry_t
+static
+void
+ht_op_record_latency
+(
+	ht_op_t		op,
+	uint64_t	ns
+)
 {
-	uint8_t		 *key;
-	size_t		  key_length;
-	void		 *value;
-	size_t		  value_length;
-	ht_entry_t		 *next;
-};
+	ht_op_stats_t *s = &ht_op_stats[op];
 
-struct ht_t
-{
-	ht_entry_t		**table;
-	size_t		  table_length;
-	ht_hash_size_t	  hash_size;
-	size_t		  num_of_entries;
-	ht_seed_t	  seed;
-	void		 *extra;
-	void		(*destroy_value)
-			(
-				void	*data,
-				void	*extra
-			);
-	void		(*destroy_extra)
-			(
-				void	*extra
-			);
-};
+	__atomic_add_fetch(&s->latency[ht_latency_bucket(ns)],1,__ATOMIC_RELAXED);
+}
 
 ////////////////////////////////////////
-//	HASHES
+//	the sampled side of ht_op_begin and
+//		ht_op_end, kept out of line so an
+//		operation that is not sampled only
+//		pays for the countdown
+//	- probes are only zeroed here, the
+//		count other operations leave
+//		behind is never read
+//	- reading the clock twice costs more
+//		than the rest of the sampling put
+//		together, so only one sampled
+//		operation in
+//		HT_INSTRUMENT_TIME_SAMPLE is timed
 ////////////////////////////////////////
-typedef union
-{
-	uint32_t	h32;
-	uint64_t	h64;
-	uint64_t	h128[2];
-} ht_hash_t;
-
 static
-inline
-ht_hash_t
-ht_hash
+__attribute__((noinline,cold))
+uint64_t
+ht_op_sample_begin
 (
-	ht_t		*ht,
-	uint8_t		*key,
-	size_t		 key_length,
-	ht_prefix	*prefix
+	void
 )
 {
-	ht_seed_t seed = ht->seed;
-	ht_hash_t storage;
+	ht_op_countdown = HT_INSTRUMENT_SAMPLE - 1;
+	ht_op_probes = 0;
 
-	switch(ht->hash_size)
+	if(ht_op_time_countdown-- != 0)
 	{
-		case HT_HASH_SIZE_32:
-			{
-				uint32_t h;
-				if(prefix == 0)
-				{
-					h = spookyhash32(key,key_length,seed.s32);
-				}
-				else
-				{
-					uint64_t h1;
-					uint64_t h2;
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-					h = (uint32_t) h1;
-				}
-				storage.h32 = h;
-			}
-			break;
-		case HT_HASH_SIZE_64:
-			{
-				uint64_t h;
-				if(prefix == 0)
-				{
-					h = spookyhash64(key,key_length,seed.s64);
-				}
-				else
-				{
-					uint64_t h1;
-					uint64_t h2;
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-					h = h1;
-				}
-				storage.h64 = h;
-			}
-			break;
-		case HT_HASH_SIZE_64_DIFFUSE_32:
-			{
-				uint64_t h;
-				if(prefix == 0)
-				{
-					h = spookyhash64(key,key_length,seed.s64);
-				}
-				else
-				{
-					uint64_t h1;
-					uint64_t h2;
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-					h = h1;
-				}
-				storage.h32 = diffuse64_32(h);
-			}
-			break;
-		case HT_HASH_SIZE_128:
-			{
-				uint64_t h1 = seed.s128[0];
-				uint64_t h2 = seed.s128[1];
-				if(prefix == 0)
-				{
-					spookyhash128(key,key_length,&h1,&h2);
-				}
-				else
-				{
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-				}
-				storage.h128[0] = h1;
-				storage.h128[1] = h2;
-			}
-			break;
-		case HT_HASH_SIZE_128_DIFFUSE_64:
-			{
-				uint64_t h1 = seed.s128[0];
-				uint64_t h2 = seed.s128[1];
-				if(prefix == 0)
-				{
-					spookyhash128(key,key_length,&h1,&h2);
-				}
-				else
-				{
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-				}
-				storage.h64 = diffuse128_64(h1,h2);
-			}
-			break;
-		case HT_HASH_SIZE_128_DIFFUSE_32:
-			{
-				uint64_t h1 = seed.s128[0];
-				uint64_t h2 = seed.s128[1];
-				if(prefix == 0)
-				{
-					spookyhash128(key,key_length,&h1,&h2);
-				}
-				else
-				{
-					spookyhash_state_t s;
-					spookyhash_clone_state(prefix->state,&s);
-					spookyhash_update(&s,key,key_length);
-					spookyhash_final(&s,&h1,&h2);
-				}
-				storage.h32 = diffuse128_32(h1,h2);
-			}
-			break;
+		return HT_OP_UNTIMED;
 	}
 
-	return storage;
+	ht_op_time_countdown = HT_INSTRUMENT_TIME_SAMPLE - 1;
+
+	return ht_now();
 }
 
 static
-inline
-size_t
-ht_index
+__attribute__((noinline,cold))
+void
+ht_op_sample_end
 (
-	ht_t		*ht,
-	ht_hash_t	 hash
+	ht_op_t		op,
+	uint64_t	start
 )
 {
-	size_t i = (size_t) -1;
-	size_t l = ht->table_length;
-
-	switch(ht->hash_size)
+	if(start != HT_OP_UNTIMED)
 	{
-		case HT_HASH_SIZE_32:
-		case HT_HASH_SIZE_64_DIFFUSE_32:
-		case HT_HASH_SIZE_128_DIFFUSE_32:
-			i = hash.h32 % l;
-			break;
-		case HT_HASH_SIZE_128_DIFFUSE_64:
-		case HT_HASH_SIZE_64:
-			i = hash.h64 % l;
-			break;
-		case HT_HASH_SIZE_128:
-			i = hash.h128[1] % l;
-			break;
+		ht_op_record_latency(op,ht_now() - start);
 	}
 
-	return i;
+	ht_op_record(op,ht_op_probes);
 }
 
+////////////////////////////////////////
+//	returns the start time of a sampled
+//		operation, HT_OP_UNTIMED if it is
+//		not timed, 0 if not sampled
+////////////////////////////////////////
 static
-int
-ht_v_compare
+inline
+uint64_t
+ht_op_begin
 (
-	const void	*aa,
-	const void	*bb
+	ht_op_t		 op,
+	const void	*key,
+	size_t		 key_length
 )
 {
-	if(aa == 0 || bb == 0)
-	{
-		return -1;
-	}
+	HT_TRACE3(op__entry,op,key,key_length);
 
-	const ht_entry_t *a = aa;
-	const ht_entry_t *b = bb;
+#ifdef HT_USDT
+	ht_op_probes = 0;
+#endif
 
-	if(a->key_length != b->key_length)
+	if(__builtin_expect(ht_op_countdown-- != 0,1))
 	{
-		return -1;
+		return 0;
 	}
 
-	return strncmp((char *)a->key,(char *)b->key,a->key_length);
+	return ht_op_sample_begin();
 }
 
 static
+inline
 void
-ht_v_destroy
+ht_op_end
 (
-	ht_entry_t	*v,
-	ht_t	*ht
+	ht_op_t		op,
+	uint64_t	start,
+	ht_status_t	status
 )
 {
-	if(v->key)
-	{
-		free(v->key);
-	}
-	if(v->value)
+	HT_TRACE3(op__exit,op,status,ht_op_probes);
+
+	if(__builtin_expect(start != 0,0))
 	{
-		if(ht->destroy_value)
-		{
-			ht->destroy_value(v->value,ht->extra);
-		}
+		ht_op_sample_end(op,start);
 	}
-
-	free(v);
 }
 
 static
 inline
-ht_entry_t *
-ht_v_find
+uint64_t
+ht_resize_begin
 (
-	ht_entry_t		 *list,
-	ht_entry_t		 *v,
-	int		(*compare)
-			(
-				const void	*aa,
-				const void	*bb
-			)
+	size_t	old_length,
+	size_t	new_length
 )
 {
-	ht_entry_t *next = list;
-	while(next)
-	{
-		if(0 == compare(next,v))
-		{
-			return next;
-		}
-		next = next->next;
-	}
-	return 0;
+	HT_TRACE2(resize__entry,old_length,new_length);
+
+	return ht_now();
 }
 
 static
 inline
 void
-ht_v_append
+ht_resize_end
 (
-	ht_t	*ht,
-	int	 index,
-	ht_entry_t	*v
+	size_t		new_length,
+	uint64_t	start
 )
 {
-	ht_entry_t *vs = ht->table[index];
+	HT_TRACE1(resize__exit,new_length);
 
-	if(vs == 0)
-	{
-		ht->table[index] = v;
-		return;
-	}
+	ht_op_record_latency(HT_OP_RESIZE,ht_now() - start);
+	ht_op_record(HT_OP_RESIZE,0);
+}
 
-	while(vs->next)
-	{
-		vs = vs->next;
-	}
+#define HT_PROBES_BEGIN()			size_t ht_probes = 0
+#define HT_PROBE()				ht_probes++
+#define HT_PROBES_END()				ht_op_probes += ht_probes
+#define HT_OP_BEGIN(op,key,key_length)		uint64_t ht_op_start = ht_op_begin(op,key,key_length)
+#define HT_OP_HASHED(op,hash)			HT_TRACE2(op__hashed,op,(hash).word)
+#define HT_OP_END(op,status)			ht_op_end(op,ht_op_start,status)
+#define HT_RESIZE_BEGIN(old_length,new_length)	uint64_t ht_resize_start = ht_resize_begin(old_length,new_length)
+#define HT_RESIZE_END(new_length)		ht_resize_end(new_length,ht_resize_start)
+#define HT_ALLOC(node_size,key_length)		HT_TRACE2(alloc,node_size,key_length)
+
+#else
+
+#define HT_PROBES_BEGIN()			do {} while(0)
+#define HT_PROBE()				do {} while(0)
+#define HT_PROBES_END()				do {} while(0)
+#define HT_OP_BEGIN(op,key,key_length)		do {} while(0)
+#define HT_OP_HASHED(op,hash)			do {} while(0)
+#define HT_OP_END(op,status)			do {} while(0)
+#define HT_RESIZE_BEGIN(old_length,new_length)	do {} while(0)
+#define HT_RESIZE_END(new_length)		do {} while(0)
+#define HT_ALLOC(node_size,key_length)		do {} while(0)
+
+#endif
 
-	vs->next = v;
+////////////////////////////////////////
+//	HASH DIFFUSE
+////////////////////////////////////////
+static
+inline
+uint32_t
+diffuse64_32
+(
+	uint64_t	h
+)
+{
+	uint32_t *m;
+	m = (uint32_t *) &h;
+
+	return m[0] ^ m[1];
 }
 
 static
-void
-ht_vacuous_free
+inline
+uint64_t
+diffuse128_64
 (
-	void	*data,
-	void	*extra
+	uint64_t	h1,
+	uint64_t	h2
 )
 {
-	free(data);
+	return h1 ^ h2;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-//	CREATION AND DESTRUCTION
-////////////////////////////////////////////////////////////////////////////////
-ht_t *
-ht_create
+static
+inline
+uint32_t
+diffuse128_32
 (
-	size_t		table_length,
-	ht_hash_size_t	hash_size,
-	ht_seed_t	seed
+	uint64_t	h1,
+	uint64_t	h2
 )
 {
-	return ht_create_full(table_length,hash_size,seed,0,ht_vacuous_free,free);
+	uint32_t m1 = diffuse64_32(h1);
+	uint32_t m2 = diffuse64_32(h2);
+	return m1 ^ m2;
+}
+
+////////////////////////////////////////
+//	PREFIXES
+//	- cache is the state after the prefix
+//		for the first streaming hash
+//		function and seeds the prefix was
+//		used with, built on first use
+//		- spooky is only set for
+//			ht_hash_spookyhash
+//	- id hashes the prefix's bytes, to
+//		find its namespace
+////////////////////////////////////////
+////////////////////////////////////////
+//	SpookyHash's short routine only carries
+//		four words from one 32 byte block
+//		to the next, so a prefix is kept
+//		as those words after its whole
+//		blocks and the bytes left over
+//	- tail is zeroed past tail_length so
+//		8 bytes can be read anywhere in
+//		the first 32
+////////////////////////////////////////
+typedef struct
+{
+	uint64_t	state[4];
+	uint8_t		tail[40];
+	size_t		tail_length;
+} ht_spooky_prefix_t;
+
+typedef struct
+{
+	const ht_hash_function_t	*function;
+	uint64_t			 seed1;
+	uint64_t			 seed2;
+	ht_spooky_prefix_t		 spooky;
+	max_align_t			 state[];
+} ht_prefix_cache_t;
+
+struct ht_prefix
+{
+	void			*prefix;
+	size_t			 prefix_length;
+	uint64_t		 id;
+	ht_prefix_cache_t	*cache;
+};
+
+////////////////////////////////////////
+//	HASH FUNCTIONS
+////////////////////////////////////////
+static
+void
+ht_spookyhash_hash
+(
+	const void	*key,
+	size_t		 key_length,
+	uint64_t	 seed1,
+	uint64_t	 seed2,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	*hash1 = seed1;
+	*hash2 = seed2;
+	spookyhash128(key,key_length,hash1,hash2);
+}
+
+static
+void
+ht_spookyhash_init
+(
+	void		*state,
+	uint64_t	 seed1,
+	uint64_t	 seed2
+)
+{
+	spookyhash_init(state,seed1,seed2);
+}
+
+static
+void
+ht_spookyhash_update
+(
+	void		*state,
+	const void	*key,
+	size_t		 key_length
+)
+{
+	spookyhash_update(state,key,key_length);
+}
+
+static
+void
+ht_spookyhash_final
+(
+	void		*state,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	spookyhash_final(state,hash1,hash2);
+}
+
+const ht_hash_function_t ht_hash_spookyhash = {
+	.name		= "spookyhash",
+	.hash		= ht_spookyhash_hash,
+	.state_size	= sizeof(spookyhash_state_t),
+	.init		= ht_spookyhash_init,
+	.update		= ht_spookyhash_update,
+	.final		= ht_spookyhash_final,
+};
+
+static
+inline
+uint64_t
+ht_read64
+(
+	const uint8_t	*p
+)
+{
+	uint64_t w;
+	memcpy(&w,p,sizeof(w));
+	return w;
+}
+
+static
+inline
+uint64_t
+ht_read32
+(
+	const uint8_t	*p
+)
+{
+	uint32_t w;
+	memcpy(&w,p,sizeof(w));
+	return w;
+}
+
+////////////////////////////////////////
+//	the two words of a key of up to 16
+//		bytes, read so that each byte
+//		lands in at least one of them
+////////////////////////////////////////
+static
+inline
+void
+ht_read_short
+(
+	const uint8_t	*p,
+	size_t		 length,
+	uint64_t	*a,
+	uint64_t	*b
+)
+{
+	if(length >= 8)
+	{
+		*a = ht_read64(p);
+		*b = ht_read64(p + length - 8);
+	}
+	else if(length >= 4)
+	{
+		*a = ht_read32(p);
+		*b = ht_read32(p + length - 4);
+	}
+	else if(length > 0)
+	{
+		*a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+		*b = 0;
+	}
+	else
+	{
+		*a = 0;
+		*b = 0;
+	}
+}
+
+////////////////////////////////////////
+//	splitmix64's finalizer
+////////////////////////////////////////
+static
+inline
+uint64_t
+ht_mix64
+(
+	uint64_t	x
+)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static
+void
+ht_mix64_hash
+(
+	const void	*key,
+	size_t		 key_length,
+	uint64_t	 seed1,
+	uint64_t	 seed2,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	const uint8_t *p = key;
+	size_t length = key_length;
+	uint64_t acc = seed1 ^ (key_length * 0x9e3779b97f4a7c15ULL);
+	uint64_t a;
+	uint64_t b;
+
+	for(; length > 16; length -= 16, p += 16)
+	{
+		acc = ht_mix64(acc ^ ht_read64(p)) + ht_read64(p + 8);
+	}
+
+	ht_read_short(p,length,&a,&b);
+
+	uint64_t h = ht_mix64(acc ^ a) ^ ht_mix64(b + seed2);
+
+	*hash1 = ht_mix64(h);
+	*hash2 = ht_mix64(h ^ seed2 ^ 0x9e3779b97f4a7c15ULL);
+}
+
+const ht_hash_function_t ht_hash_mix64 = {
+	.name		= "mix64",
+	.hash		= ht_mix64_hash,
+};
+
+static
+const uint64_t ht_wy_secret[4] = {
+	0x2d358dccaa6c78a5ULL,
+	0x8bb84b93962eacc9ULL,
+	0x4b33a62ed433d4a3ULL,
+	0x4d5a2da51de1aa47ULL,
+};
+
+static
+inline
+uint64_t
+ht_wymix
+(
+	uint64_t	a,
+	uint64_t	b
+)
+{
+	unsigned __int128 r = (unsigned __int128) a * b;
+	return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+static
+void
+ht_wyhash_hash
+(
+	const void	*key,
+	size_t		 key_length,
+	uint64_t	 seed1,
+	uint64_t	 seed2,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	const uint8_t *p = key;
+	const uint64_t *s = ht_wy_secret;
+	uint64_t seed = seed1 ^ ht_wymix(seed1 ^ s[0],s[1]);
+	uint64_t a;
+	uint64_t b;
+
+	if(key_length <= 16)
+	{
+		if(key_length >= 4)
+		{
+			size_t q = (key_length >> 3) << 2;
+			a = (ht_read32(p) << 32) | ht_read32(p + q);
+			b = (ht_read32(p + key_length - 4) << 32) | ht_read32(p + key_length - 4 - q);
+		}
+		else if(key_length > 0)
+		{
+			a = ((uint64_t) p[0] << 16) | ((uint64_t) p[key_length >> 1] << 8) | p[key_length - 1];
+			b = 0;
+		}
+		else
+		{
+			a = 0;
+			b = 0;
+		}
+	}
+	else
+	{
+		size_t i = key_length;
+
+		if(i > 48)
+		{
+			uint64_t see1 = seed;
+			uint64_t see2 = seed;
+			do
+			{
+				seed = ht_wymix(ht_read64(p) ^ s[1],ht_read64(p + 8) ^ seed);
+				see1 = ht_wymix(ht_read64(p + 16) ^ s[2],ht_read64(p + 24) ^ see1);
+				see2 = ht_wymix(ht_read64(p + 32) ^ s[3],ht_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			}
+			while(i > 48);
+			seed ^= see1 ^ see2;
+		}
+
+		while(i > 16)
+		{
+			seed = ht_wymix(ht_read64(p) ^ s[1],ht_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+
+		a = ht_read64(p + i - 16);
+		b = ht_read64(p + i - 8);
+	}
+
+	unsigned __int128 r = (unsigned __int128) (a ^ s[1]) * (b ^ seed);
+	uint64_t h = ht_wymix((uint64_t) r ^ s[0] ^ key_length,(uint64_t) (r >> 64) ^ s[1]);
+
+	*hash1 = h;
+	*hash2 = ht_wymix(h ^ s[2],seed2 ^ s[3]);
+}
+
+const ht_hash_function_t ht_hash_wyhash = {
+	.name		= "wyhash",
+	.hash		= ht_wyhash_hash,
+};
+
+const ht_hash_function_t *
+ht_find_hash_function
+(
+	const char	*name
+)
+{
+	static const ht_hash_function_t *functions[] = {
+		&ht_hash_spookyhash,
+		&ht_hash_mix64,
+		&ht_hash_wyhash,
+	};
+
+	for(size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++)
+	{
+		if(strcmp(functions[i]->name,name) == 0)
+		{
+			return functions[i];
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////
+//	HASH TABLE STRUCTS
+////////////////////////////////////////
+typedef struct ht_entry_t ht_entry_t;
+struct ht_entry_t
+{
+	uint64_t	  hash;
+	ht_entry_t		 *next;
+	size_t		  key_length;
+	uint8_t		 *key;
+	void		 *value;
+	size_t		  value_length;
+	uint8_t		  inline_key[];
+};
+
+////////////////////////////////////////
+//	NAMESPACES
+//	- tables with namespaces keep a link
+//		at namespace_link bytes into each
+//		entry, after any inline key
+//	- a namespace lists the entries added
+//		through prefixes with its bytes,
+//		newest first, and is freed with
+//		its last entry
+//	- namespaces are found through a small
+//		chained table of their own, by
+//		the prefix's id
+////////////////////////////////////////
+typedef struct ht_namespace_t ht_namespace_t;
+
+typedef struct
+{
+	ht_namespace_t	*space;
+	ht_entry_t	*prev;
+	ht_entry_t	*next;
+} ht_ns_link_t;
+
+struct ht_namespace_t
+{
+	ht_namespace_t	*next;
+	uint64_t	 id;
+	ht_entry_t	*entries;
+	size_t		 num_of_entries;
+	size_t		 prefix_length;
+	uint8_t		 prefix[];
+};
+
+////////////////////////////////////////
+//	SLABS
+//	- bump allocated blocks, released
+//		all at once
+////////////////////////////////////////
+#define HT_SLAB_SIZE	(64 * 1024)
+
+typedef struct ht_slab_t ht_slab_t;
+struct ht_slab_t
+{
+	ht_slab_t	*next;
+	size_t		 used;
+	size_t		 size;
+	uint8_t		 data[];
+};
+
+static
+void *
+ht_slab_alloc
+(
+	ht_slab_t	**slabs,
+	size_t		  size
+)
+{
+	size = (size + 7) & ~(size_t) 7;
+
+	ht_slab_t *s = *slabs;
+
+	if(s == 0 || s->size - s->used < size)
+	{
+		size_t l = size > HT_SLAB_SIZE ? size : HT_SLAB_SIZE;
+
+		s = malloc(sizeof(ht_slab_t) + l);
+		*s = (ht_slab_t) {
+			.next = *slabs,
+			.used = 0,
+			.size = l,
+		};
+
+		*slabs = s;
+	}
+
+	void *p = s->data + s->used;
+	s->used += size;
+
+	return p;
+}
+
+static
+void
+ht_slab_free_all
+(
+	ht_slab_t	**slabs
+)
+{
+	ht_slab_t *s = *slabs;
+
+	while(s)
+	{
+		ht_slab_t *next = s->next;
+		free(s);
+		s = next;
+	}
+
+	*slabs = 0;
+}
+
+typedef struct
+{
+	uint8_t		 *key;
+	size_t		  key_length;
+	void		 *value;
+	size_t		  value_length;
+	uint64_t	  hash;
+} ht_slot_t;
+
+typedef struct ht_concurrent_t ht_concurrent_t;
+typedef struct ht_map_t ht_map_t;
+
+struct ht_t
+{
+	ht_layout_t	  layout;
+	ht_concurrent_t	 *cc;
+	ht_map_t	 *map;
+	ht_entry_t		**table;
+	ht_entry_t		**old_table;
+	size_t		  old_table_length;
+	size_t		  rehash_index;
+	size_t		  moves;
+	size_t		  min_table_length;
+	float		  max_load_factor;
+	float		  min_load_factor;
+	uint8_t		 *control;
+	ht_slot_t	 *slots;
+	uint64_t	 *alternates;
+	size_t		  growth_left;
+	size_t		  stash_length;
+	size_t		  stash_used;
+	size_t		  table_length;
+	ht_hash_size_t	  hash_size;
+	unsigned int	  hash_bits;
+	ht_index_mode_t	  index_mode;
+	unsigned int	  index_shift;
+	size_t		  num_of_entries;
+	size_t		  inline_key_length;
+	size_t		  node_size;
+	size_t		  namespace_link;
+	int		  own_values;
+	size_t		  inline_value_length;
+	size_t		  value_inline;
+	size_t		  max_chain_length;
+	size_t		  reseeds;
+	size_t		  reseed_entries;
+	ht_namespace_t	**namespaces;
+	size_t		  namespaces_length;
+	size_t		  num_of_namespaces;
+	ht_slab_t	 *node_slabs;
+	ht_slab_t	 *key_slabs;
+	ht_entry_t		 *free_nodes;
+	ht_seed_t	  seed;
+	const ht_hash_function_t	 *hash_function;
+	void		 *extra;
+	void		(*destroy_value)
+			(
+				void	*data,
+				void	*extra
+			);
+	void		(*destroy_extra)
+			(
+				void	*extra
+			);
+};
+
+////////////////////////////////////////
+//	HASHES
+////////////////////////////////////////
+////////////////////////////////////////
+//	word is the part of the hash used to
+//		pick a bucket, widened to 64 bits
+//	- filled in by ht_hash so callers do
+//		not switch on hash_size again
+////////////////////////////////////////
+typedef struct
+{
+	union
+	{
+		uint32_t	h32;
+		uint64_t	h64;
+		uint64_t	h128[2];
+	};
+	uint64_t	word;
+} ht_hash_t;
+
+////////////////////////////////////////
+//	seeds SpookyHash starts from for the
+//		table's hash size
+//	- spookyhash32 and spookyhash64 are
+//		spookyhash128 with the seed in
+//		both words, truncated to its
+//		first word
+////////////////////////////////////////
+static
+inline
+void
+ht_hash_seeds
+(
+	ht_t		*ht,
+	uint64_t	*seed1,
+	uint64_t	*seed2
+)
+{
+	switch(ht->hash_size)
+	{
+		case HT_HASH_SIZE_32:
+			*seed1 = ht->seed.s32;
+			*seed2 = ht->seed.s32;
+			break;
+		case HT_HASH_SIZE_64:
+		case HT_HASH_SIZE_64_DIFFUSE_32:
+			*seed1 = ht->seed.s64;
+			*seed2 = ht->seed.s64;
+			break;
+		default:
+			*seed1 = ht->seed.s128[0];
+			*seed2 = ht->seed.s128[1];
+			break;
+	}
+}
+
+////////////////////////////////////////
+//	the table's hash of a key from the
+//		two SpookyHash words
+////////////////////////////////////////
+static
+inline
+ht_hash_t
+ht_hash_words
+(
+	ht_t		*ht,
+	uint64_t	 h1,
+	uint64_t	 h2
+)
+{
+	ht_hash_t storage = {.word = 0};
+
+	switch(ht->hash_size)
+	{
+		case HT_HASH_SIZE_32:
+			storage.h32 = (uint32_t) h1;
+			storage.word = storage.h32;
+			break;
+		case HT_HASH_SIZE_64:
+			storage.h64 = h1;
+			storage.word = h1;
+			break;
+		case HT_HASH_SIZE_64_DIFFUSE_32:
+			storage.h32 = diffuse64_32(h1);
+			storage.word = storage.h32;
+			break;
+		case HT_HASH_SIZE_128:
+			storage.h128[0] = h1;
+			storage.h128[1] = h2;
+			storage.word = h2;
+			break;
+		case HT_HASH_SIZE_128_DIFFUSE_64:
+			storage.h64 = diffuse128_64(h1,h2);
+			storage.word = storage.h64;
+			break;
+		case HT_HASH_SIZE_128_DIFFUSE_32:
+			storage.h32 = diffuse128_32(h1,h2);
+			storage.word = storage.h32;
+			break;
+	}
+
+	return storage;
+}
+
+////////////////////////////////////////
+//	BATCH HASHING
+//	- SpookyHash V2 hashes messages under
+//		HT_SPOOKY_SHORT bytes with its
+//		"short" routine, on four 64 bit
+//		words of state
+//	- the routine is repeated here so that
+//		several keys of the same length
+//		can run it side by side, one key
+//		per 64 bit SIMD lane
+//	- results are identical to
+//		spookyhash128 for the same seeds
+////////////////////////////////////////
+#define HT_SPOOKY_SHORT		192
+#define HT_SPOOKY_CONST		0xdeadbeefdeadbeefULL
+#define HT_SPOOKY_LANES		8
+
+#define HT_ROT64(x,k)	(((x) << (k)) | ((x) >> (64 - (k))))
+
+#define HT_SPOOKY_SHORT_MIX(ROT,ADD,XOR,h0,h1,h2,h3) \
+	h2 = ROT(h2,50); h2 = ADD(h2,h3); h0 = XOR(h0,h2); \
+	h3 = ROT(h3,52); h3 = ADD(h3,h0); h1 = XOR(h1,h3); \
+	h0 = ROT(h0,30); h0 = ADD(h0,h1); h2 = XOR(h2,h0); \
+	h1 = ROT(h1,41); h1 = ADD(h1,h2); h3 = XOR(h3,h1); \
+	h2 = ROT(h2,54); h2 = ADD(h2,h3); h0 = XOR(h0,h2); \
+	h3 = ROT(h3,48); h3 = ADD(h3,h0); h1 = XOR(h1,h3); \
+	h0 = ROT(h0,38); h0 = ADD(h0,h1); h2 = XOR(h2,h0); \
+	h1 = ROT(h1,37); h1 = ADD(h1,h2); h3 = XOR(h3,h1); \
+	h2 = ROT(h2,62); h2 = ADD(h2,h3); h0 = XOR(h0,h2); \
+	h3 = ROT(h3,34); h3 = ADD(h3,h0); h1 = XOR(h1,h3); \
+	h0 = ROT(h0,5);  h0 = ADD(h0,h1); h2 = XOR(h2,h0); \
+	h1 = ROT(h1,36); h1 = ADD(h1,h2); h3 = XOR(h3,h1);
+
+#define HT_SPOOKY_SHORT_END(ROT,ADD,XOR,h0,h1,h2,h3) \
+	h3 = XOR(h3,h2); h2 = ROT(h2,15); h3 = ADD(h3,h2); \
+	h0 = XOR(h0,h3); h3 = ROT(h3,52); h0 = ADD(h0,h3); \
+	h1 = XOR(h1,h0); h0 = ROT(h0,26); h1 = ADD(h1,h0); \
+	h2 = XOR(h2,h1); h1 = ROT(h1,51); h2 = ADD(h2,h1); \
+	h3 = XOR(h3,h2); h2 = ROT(h2,28); h3 = ADD(h3,h2); \
+	h0 = XOR(h0,h3); h3 = ROT(h3,9);  h0 = ADD(h0,h3); \
+	h1 = XOR(h1,h0); h0 = ROT(h0,47); h1 = ADD(h1,h0); \
+	h2 = XOR(h2,h1); h1 = ROT(h1,54); h2 = ADD(h2,h1); \
+	h3 = XOR(h3,h2); h2 = ROT(h2,32); h3 = ADD(h3,h2); \
+	h0 = XOR(h0,h3); h3 = ROT(h3,25); h0 = ADD(h0,h3); \
+	h1 = XOR(h1,h0); h0 = ROT(h0,63); h1 = ADD(h1,h0);
+
+#define HT_ADD64(a,b)	((a) + (b))
+#define HT_XOR64(a,b)	((a) ^ (b))
+
+////////////////////////////////////////
+//	the words the last length % 16 bytes
+//		add to c and d
+//	- SpookyHash reads them as a little
+//		endian, zero padded 16 bytes
+////////////////////////////////////////
+static
+inline
+void
+ht_spooky_tail
+(
+	const uint8_t	*tail,
+	size_t		 remainder,
+	uint64_t	*c,
+	uint64_t	*d
+)
+{
+	uint8_t t[16] = {0};
+
+	if(remainder == 0)
+	{
+		*c = HT_SPOOKY_CONST;
+		*d = HT_SPOOKY_CONST;
+		return;
+	}
+
+	memcpy(t,tail,remainder);
+	*c = ht_read64(t);
+	*d = ht_read64(t + 8);
+}
+
+static
+void
+ht_spooky_short
+(
+	const uint8_t	*message,
+	size_t		 length,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	uint64_t a = *hash1;
+	uint64_t b = *hash2;
+	uint64_t c = HT_SPOOKY_CONST;
+	uint64_t d = HT_SPOOKY_CONST;
+	size_t remainder = length;
+	const uint8_t *p = message;
+
+	if(length > 15)
+	{
+		for(size_t i = 0; i < length / 32; i++, p += 32)
+		{
+			c += ht_read64(p);
+			d += ht_read64(p + 8);
+			HT_SPOOKY_SHORT_MIX(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+			a += ht_read64(p + 16);
+			b += ht_read64(p + 24);
+		}
+
+		remainder = length % 32;
+		if(remainder >= 16)
+		{
+			c += ht_read64(p);
+			d += ht_read64(p + 8);
+			HT_SPOOKY_SHORT_MIX(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+			p += 16;
+			remainder -= 16;
+		}
+	}
+
+	uint64_t tc;
+	uint64_t td;
+	ht_spooky_tail(p,remainder,&tc,&td);
+
+	d += ((uint64_t) length) << 56;
+	c += tc;
+	d += td;
+
+	HT_SPOOKY_SHORT_END(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+
+	*hash1 = a;
+	*hash2 = b;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define HT_ROT256(x,k) \
+	_mm256_or_si256(_mm256_slli_epi64(x,k),_mm256_srli_epi64(x,64 - (k)))
+
+#define HT_LANES256(keys,offset) \
+	_mm256_set_epi64x( \
+		ht_read64(keys[3] + (offset)), \
+		ht_read64(keys[2] + (offset)), \
+		ht_read64(keys[1] + (offset)), \
+		ht_read64(keys[0] + (offset)) \
+	)
+
+////////////////////////////////////////
+//	ht_spooky_short on four keys of the
+//		same length
+////////////////////////////////////////
+__attribute__((target("avx2")))
+static
+void
+ht_spooky_short_x4
+(
+	const uint8_t	**keys,
+	size_t		  length,
+	uint64_t	  seed1,
+	uint64_t	  seed2,
+	uint64_t	 *hash1,
+	uint64_t	 *hash2
+)
+{
+	__m256i a = _mm256_set1_epi64x((long long) seed1);
+	__m256i b = _mm256_set1_epi64x((long long) seed2);
+	__m256i c = _mm256_set1_epi64x((long long) HT_SPOOKY_CONST);
+	__m256i d = _mm256_set1_epi64x((long long) HT_SPOOKY_CONST);
+	size_t remainder = length;
+	size_t o = 0;
+
+	if(length > 15)
+	{
+		for(size_t i = 0; i < length / 32; i++, o += 32)
+		{
+			c = _mm256_add_epi64(c,HT_LANES256(keys,o));
+			d = _mm256_add_epi64(d,HT_LANES256(keys,o + 8));
+			HT_SPOOKY_SHORT_MIX(HT_ROT256,_mm256_add_epi64,_mm256_xor_si256,a,b,c,d);
+			a = _mm256_add_epi64(a,HT_LANES256(keys,o + 16));
+			b = _mm256_add_epi64(b,HT_LANES256(keys,o + 24));
+		}
+
+		remainder = length % 32;
+		if(remainder >= 16)
+		{
+			c = _mm256_add_epi64(c,HT_LANES256(keys,o));
+			d = _mm256_add_epi64(d,HT_LANES256(keys,o + 8));
+			HT_SPOOKY_SHORT_MIX(HT_ROT256,_mm256_add_epi64,_mm256_xor_si256,a,b,c,d);
+			o += 16;
+			remainder -= 16;
+		}
+	}
+
+	uint64_t tc[4];
+	uint64_t td[4];
+	for(int i = 0; i < 4; i++)
+	{
+		ht_spooky_tail(keys[i] + o,remainder,&tc[i],&td[i]);
+		td[i] += ((uint64_t) length) << 56;
+	}
+
+	c = _mm256_add_epi64(c,_mm256_loadu_si256((const __m256i *) tc));
+	d = _mm256_add_epi64(d,_mm256_loadu_si256((const __m256i *) td));
+
+	HT_SPOOKY_SHORT_END(HT_ROT256,_mm256_add_epi64,_mm256_xor_si256,a,b,c,d);
+
+	_mm256_storeu_si256((__m256i *) hash1,a);
+	_mm256_storeu_si256((__m256i *) hash2,b);
+}
+
+#define HT_ROT512(x,k)	_mm512_rol_epi64(x,k)
+
+#define HT_LANES512(keys,offset) \
+	_mm512_set_epi64( \
+		ht_read64(keys[7] + (offset)), \
+		ht_read64(keys[6] + (offset)), \
+		ht_read64(keys[5] + (offset)), \
+		ht_read64(keys[4] + (offset)), \
+		ht_read64(keys[3] + (offset)), \
+		ht_read64(keys[2] + (offset)), \
+		ht_read64(keys[1] + (offset)), \
+		ht_read64(keys[0] + (offset)) \
+	)
+
+////////////////////////////////////////
+//	ht_spooky_short on eight keys of the
+//		same length
+////////////////////////////////////////
+__attribute__((target("avx512f")))
+static
+void
+ht_spooky_short_x8
+(
+	const uint8_t	**keys,
+	size_t		  length,
+	uint64_t	  seed1,
+	uint64_t	  seed2,
+	uint64_t	 *hash1,
+	uint64_t	 *hash2
+)
+{
+	__m512i a = _mm512_set1_epi64((long long) seed1);
+	__m512i b = _mm512_set1_epi64((long long) seed2);
+	__m512i c = _mm512_set1_epi64((long long) HT_SPOOKY_CONST);
+	__m512i d = _mm512_set1_epi64((long long) HT_SPOOKY_CONST);
+	size_t remainder = length;
+	size_t o = 0;
+
+	if(length > 15)
+	{
+		for(size_t i = 0; i < length / 32; i++, o += 32)
+		{
+			c = _mm512_add_epi64(c,HT_LANES512(keys,o));
+			d = _mm512_add_epi64(d,HT_LANES512(keys,o + 8));
+			HT_SPOOKY_SHORT_MIX(HT_ROT512,_mm512_add_epi64,_mm512_xor_si512,a,b,c,d);
+			a = _mm512_add_epi64(a,HT_LANES512(keys,o + 16));
+			b = _mm512_add_epi64(b,HT_LANES512(keys,o + 24));
+		}
+
+		remainder = length % 32;
+		if(remainder >= 16)
+		{
+			c = _mm512_add_epi64(c,HT_LANES512(keys,o));
+			d = _mm512_add_epi64(d,HT_LANES512(keys,o + 8));
+			HT_SPOOKY_SHORT_MIX(HT_ROT512,_mm512_add_epi64,_mm512_xor_si512,a,b,c,d);
+			o += 16;
+			remainder -= 16;
+		}
+	}
+
+	uint64_t tc[8];
+	uint64_t td[8];
+	for(int i = 0; i < 8; i++)
+	{
+		ht_spooky_tail(keys[i] + o,remainder,&tc[i],&td[i]);
+		td[i] += ((uint64_t) length) << 56;
+	}
+
+	c = _mm512_add_epi64(c,_mm512_loadu_si512(tc));
+	d = _mm512_add_epi64(d,_mm512_loadu_si512(td));
+
+	HT_SPOOKY_SHORT_END(HT_ROT512,_mm512_add_epi64,_mm512_xor_si512,a,b,c,d);
+
+	_mm512_storeu_si512(hash1,a);
+	_mm512_storeu_si512(hash2,b);
+}
+#endif
+
+////////////////////////////////////////
+//	number of keys the widest kernel the
+//		CPU supports hashes at once
+//	- 1 means scalar only
+////////////////////////////////////////
+static
+int
+ht_spooky_lanes
+(
+	void
+)
+{
+	static int cached = 0;
+	int lanes = __atomic_load_n(&cached,__ATOMIC_RELAXED);
+
+	if(lanes == 0)
+	{
+		int l = 1;
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx512f"))
+		{
+			l = 8;
+		}
+		else if(__builtin_cpu_supports("avx2"))
+		{
+			l = 4;
+		}
+#endif
+		__atomic_store_n(&cached,l,__ATOMIC_RELAXED);
+		lanes = l;
+	}
+
+	return lanes;
+}
+
+////////////////////////////////////////
+//	hash up to HT_SPOOKY_LANES keys of the
+//		same length under
+//		HT_SPOOKY_SHORT bytes
+//	- unused lanes repeat the first key
+////////////////////////////////////////
+static
+void
+ht_spooky_short_many
+(
+	const uint8_t	**keys,
+	size_t		  n,
+	size_t		  length,
+	uint64_t	  seed1,
+	uint64_t	  seed2,
+	uint64_t	 *hash1,
+	uint64_t	 *hash2
+)
+{
+	int lanes = ht_spooky_lanes();
+
+#if defined(__x86_64__) || defined(__i386__)
+	if(lanes > 1 && n > 1)
+	{
+		const uint8_t *k[HT_SPOOKY_LANES];
+		uint64_t h1[HT_SPOOKY_LANES];
+		uint64_t h2[HT_SPOOKY_LANES];
+
+		for(size_t i = 0; i < HT_SPOOKY_LANES; i++)
+		{
+			k[i] = i < n ? keys[i] : keys[0];
+		}
+
+		if(lanes == 8 && n > 4)
+		{
+			ht_spooky_short_x8(k,length,seed1,seed2,h1,h2);
+		}
+		else
+		{
+			ht_spooky_short_x4(k,length,seed1,seed2,h1,h2);
+			if(n > 4)
+			{
+				ht_spooky_short_x4(k + 4,length,seed1,seed2,h1 + 4,h2 + 4);
+			}
+		}
+
+		memcpy(hash1,h1,n * sizeof(uint64_t));
+		memcpy(hash2,h2,n * sizeof(uint64_t));
+
+		return;
+	}
+#endif
+
+	for(size_t i = 0; i < n; i++)
+	{
+		hash1[i] = seed1;
+		hash2[i] = seed2;
+		ht_spooky_short(keys[i],length,&hash1[i],&hash2[i]);
+	}
+}
+
+////////////////////////////////////////
+//	zero filled read of under 8 bytes
+//	- the bytes are put together in
+//		registers, a word read back from
+//		a buffer they were just copied to
+//		waits for the copy's stores
+////////////////////////////////////////
+static
+inline
+uint64_t
+ht_read_partial
+(
+	const uint8_t	*p,
+	size_t		 length
+)
+{
+	if(length >= 4)
+	{
+		return ht_read32(p) | (ht_read32(p + length - 4) << (8 * (length - 4)));
+	}
+
+	if(length > 0)
+	{
+		return (uint64_t) p[0]
+			| ((uint64_t) p[length >> 1] << (8 * (length >> 1)))
+			| ((uint64_t) p[length - 1] << (8 * (length - 1)));
+	}
+
+	return 0;
+}
+
+static
+void
+ht_spooky_prefix_init
+(
+	ht_spooky_prefix_t	*s,
+	const uint8_t		*prefix,
+	size_t			 prefix_length,
+	uint64_t		 seed1,
+	uint64_t		 seed2
+)
+{
+	uint64_t a = seed1;
+	uint64_t b = seed2;
+	uint64_t c = HT_SPOOKY_CONST;
+	uint64_t d = HT_SPOOKY_CONST;
+	const uint8_t *p = prefix;
+
+	for(size_t i = 0; i < prefix_length / 32; i++, p += 32)
+	{
+		c += ht_read64(p);
+		d += ht_read64(p + 8);
+		HT_SPOOKY_SHORT_MIX(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+		a += ht_read64(p + 16);
+		b += ht_read64(p + 24);
+	}
+
+	s->state[0] = a;
+	s->state[1] = b;
+	s->state[2] = c;
+	s->state[3] = d;
+	s->tail_length = prefix_length % 32;
+
+	memset(s->tail,0,sizeof(s->tail));
+	memcpy(s->tail,p,s->tail_length);
+}
+
+////////////////////////////////////////
+//	word at offset of a prefix's tail
+//		followed by a key, zero filled
+//		past the key
+////////////////////////////////////////
+static
+inline
+uint64_t
+ht_spooky_word
+(
+	const ht_spooky_prefix_t	*s,
+	const uint8_t			*key,
+	size_t				 key_length,
+	size_t				 offset
+)
+{
+	size_t tl = s->tail_length;
+
+	if(offset >= tl)
+	{
+		size_t k = offset - tl;
+
+		if(k + 8 <= key_length)
+		{
+			return ht_read64(key + k);
+		}
+
+		return k < key_length ? ht_read_partial(key + k,key_length - k) : 0;
+	}
+
+	uint64_t w = ht_read64(s->tail + offset);
+
+	if(offset + 8 > tl)
+	{
+		size_t n = offset + 8 - tl;
+		w |= ht_read_partial(key,n < key_length ? n : key_length) << (8 * (tl - offset));
+	}
+
+	return w;
+}
+
+////////////////////////////////////////
+//	ht_spooky_short of a prefix followed
+//		by a key, under HT_SPOOKY_SHORT
+//		bytes in all
+//	- little endian only, like the shifts
+//		in ht_spooky_word
+////////////////////////////////////////
+static
+void
+ht_spooky_short_prefixed
+(
+	const ht_spooky_prefix_t	*s,
+	size_t				 prefix_length,
+	const uint8_t			*key,
+	size_t				 key_length,
+	uint64_t			*hash1,
+	uint64_t			*hash2
+)
+{
+	uint64_t a = s->state[0];
+	uint64_t b = s->state[1];
+	uint64_t c = s->state[2];
+	uint64_t d = s->state[3];
+	size_t length = prefix_length + key_length;
+	size_t remainder = s->tail_length + key_length;
+	size_t o = 0;
+
+	if(length > 15)
+	{
+		for(size_t i = 0; i < remainder / 32; i++, o += 32)
+		{
+			c += ht_spooky_word(s,key,key_length,o);
+			d += ht_spooky_word(s,key,key_length,o + 8);
+			HT_SPOOKY_SHORT_MIX(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+			a += ht_spooky_word(s,key,key_length,o + 16);
+			b += ht_spooky_word(s,key,key_length,o + 24);
+		}
+
+		remainder %= 32;
+		if(remainder >= 16)
+		{
+			c += ht_spooky_word(s,key,key_length,o);
+			d += ht_spooky_word(s,key,key_length,o + 8);
+			HT_SPOOKY_SHORT_MIX(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+			o += 16;
+			remainder -= 16;
+		}
+	}
+
+	if(remainder == 0)
+	{
+		c += HT_SPOOKY_CONST;
+		d += HT_SPOOKY_CONST;
+	}
+	else
+	{
+		c += ht_spooky_word(s,key,key_length,o);
+		d += ht_spooky_word(s,key,key_length,o + 8);
+	}
+
+	d += ((uint64_t) length) << 56;
+
+	HT_SPOOKY_SHORT_END(HT_ROT64,HT_ADD64,HT_XOR64,a,b,c,d);
+
+	*hash1 = a;
+	*hash2 = b;
+}
+
+////////////////////////////////////////
+//	what a prefix keeps for a streaming
+//		hash function and seeds
+//	- the prefix keeps the first one
+//		built, published with a compare
+//		and swap so concurrent tables can
+//		share prefixes
+//	- returns 0 if the cache holds another
+//		function or other seeds
+////////////////////////////////////////
+static
+const ht_prefix_cache_t *
+ht_prefix_cache
+(
+	ht_prefix			*prefix,
+	const ht_hash_function_t	*function,
+	uint64_t			 seed1,
+	uint64_t			 seed2
+)
+{
+	ht_prefix_cache_t *c = __atomic_load_n(&prefix->cache,__ATOMIC_ACQUIRE);
+
+	if(c == 0)
+	{
+		c = malloc(sizeof(ht_prefix_cache_t) + function->state_size);
+		c->function = function;
+		c->seed1 = seed1;
+		c->seed2 = seed2;
+		function->init(c->state,seed1,seed2);
+		function->update(c->state,prefix->prefix,prefix->prefix_length);
+
+		if(function == &ht_hash_spookyhash)
+		{
+			ht_spooky_prefix_init(&c->spooky,prefix->prefix,prefix->prefix_length,seed1,seed2);
+		}
+
+		ht_prefix_cache_t *expected = 0;
+		if(!__atomic_compare_exchange_n(&prefix->cache,&expected,c,0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE))
+		{
+			free(c);
+			c = expected;
+		}
+	}
+
+	if(c->function != function || c->seed1 != seed1 || c->seed2 != seed2)
+	{
+		return 0;
+	}
+
+	return c;
+}
+
+////////////////////////////////////////
+//	hash with a table's hash function
+//		through its vtable
+//	- prefixed keys hash as the prefix
+//		followed by the key
+////////////////////////////////////////
+static
+void
+ht_hash_custom
+(
+	ht_t		*ht,
+	uint8_t		*key,
+	size_t		 key_length,
+	ht_prefix	*prefix,
+	uint64_t	*h1,
+	uint64_t	*h2
+)
+{
+	const ht_hash_function_t *f = ht->hash_function;
+	uint64_t seed1;
+	uint64_t seed2;
+
+	ht_hash_seeds(ht,&seed1,&seed2);
+
+	if(prefix == 0)
+	{
+		f->hash(key,key_length,seed1,seed2,h1,h2);
+		return;
+	}
+
+	if(f->init != 0)
+	{
+		max_align_t scratch[(f->state_size + sizeof(max_align_t) - 1) / sizeof(max_align_t)];
+		const ht_prefix_cache_t *c = ht_prefix_cache(prefix,f,seed1,seed2);
+
+		if(c != 0)
+		{
+			memcpy(scratch,c->state,f->state_size);
+		}
+		else
+		{
+			f->init(scratch,seed1,seed2);
+			f->update(scratch,prefix->prefix,prefix->prefix_length);
+		}
+
+		f->update(scratch,key,key_length);
+		f->final(scratch,h1,h2);
+		return;
+	}
+
+	uint8_t buffer[256];
+	size_t length = prefix->prefix_length + key_length;
+	uint8_t *whole = length <= sizeof(buffer) ? buffer : malloc(length);
+
+	memcpy(whole,prefix->prefix,prefix->prefix_length);
+	memcpy(whole + prefix->prefix_length,key,key_length);
+
+	f->hash(whole,length,seed1,seed2,h1,h2);
+
+	if(whole != buffer)
+	{
+		free(whole);
+	}
+}
+
+////////////////////////////////////////
+//	the table's hash of a key
+//	- prefixed keys hash as the prefix
+//		followed by the key, with the
+//		table's seeds
+//	- short prefixed SpookyHash keys pick
+//		up from the prefix's compact state
+//		instead of copying the whole
+//		streaming state
+////////////////////////////////////////
+static
+inline
+ht_hash_t
+ht_hash
+(
+	ht_t		*ht,
+	uint8_t		*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	uint64_t h1;
+	uint64_t h2;
+
+	if(ht->hash_function != &ht_hash_spookyhash
+		|| (prefix != 0 && prefix->prefix_length + key_length >= HT_SPOOKY_SHORT)
+		|| (prefix != 0 && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__))
+	{
+		ht_hash_custom(ht,key,key_length,prefix,&h1,&h2);
+	}
+	else if(prefix == 0)
+	{
+		ht_hash_seeds(ht,&h1,&h2);
+		spookyhash128(key,key_length,&h1,&h2);
+	}
+	else
+	{
+		uint64_t seed1;
+		uint64_t seed2;
+		ht_spooky_prefix_t scratch;
+
+		ht_hash_seeds(ht,&seed1,&seed2);
+
+		const ht_prefix_cache_t *c = ht_prefix_cache(prefix,&ht_hash_spookyhash,seed1,seed2);
+		const ht_spooky_prefix_t *s = &scratch;
+
+		if(c != 0)
+		{
+			s = &c->spooky;
+		}
+		else
+		{
+			ht_spooky_prefix_init(&scratch,prefix->prefix,prefix->prefix_length,seed1,seed2);
+		}
+
+		ht_spooky_short_prefixed(s,prefix->prefix_length,key,key_length,&h1,&h2);
+	}
+
+	return ht_hash_words(ht,h1,h2);
+}
+
+////////////////////////////////////////
+//	bucket of a hash word in an array of
+//		the given length
+//	- takes the stored word so entries
+//		can be moved without rehashing
+//	- HT_INDEX_MASK lengths are powers
+//		of two
+//	- HT_INDEX_FASTRANGE moves the word
+//		to the top of 64 bits so the high
+//		half of word * length lands in
+//		[0,length)
+////////////////////////////////////////
+static
+inline
+size_t
+ht_index_length
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	size_t		 length
+)
+{
+	switch(ht->index_mode)
+	{
+		case HT_INDEX_MASK:
+			return hash & (length - 1);
+		case HT_INDEX_FASTRANGE:
+			return (size_t) (((unsigned __int128) (hash << ht->index_shift) * length) >> 64);
+		default:
+			return hash % length;
+	}
+}
+
+static
+inline
+size_t
+ht_index
+(
+	ht_t		*ht,
+	uint64_t	 hash
+)
+{
+	return ht_index_length(ht,hash,ht->table_length);
+}
+
+static
+inline
+size_t
+ht_old_index
+(
+	ht_t		*ht,
+	uint64_t	 hash
+)
+{
+	return ht_index_length(ht,hash,ht->old_table_length);
+}
+
+static
+inline
+size_t
+ht_round_up_pow2
+(
+	size_t	n
+)
+{
+	size_t p = 1;
+	while(p < n)
+	{
+		p <<= 1;
+	}
+	return p;
+}
+
+static
+inline
+unsigned int
+ht_hash_bits
+(
+	ht_hash_size_t	hash_size
+)
+{
+	switch(hash_size)
+	{
+		case HT_HASH_SIZE_32:
+		case HT_HASH_SIZE_64_DIFFUSE_32:
+		case HT_HASH_SIZE_128_DIFFUSE_32:
+			return 32;
+		default:
+			return 64;
+	}
+}
+
+////////////////////////////////////////
+//	compare a stored key with a key that
+//		may be split into a prefix and
+//		the rest of the key
+////////////////////////////////////////
+static
+inline
+int
+ht_key_equal
+(
+	const uint8_t	*stored,
+	size_t		 stored_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(prefix == 0)
+	{
+		return stored_length == key_length
+			&& memcmp(stored,key,key_length) == 0;
+	}
+
+	size_t pl = prefix->prefix_length;
+
+	return stored_length == pl + key_length
+		&& memcmp(stored,prefix->prefix,pl) == 0
+		&& memcmp(stored + pl,key,key_length) == 0;
+}
+
+////////////////////////////////////////
+//	write a key, prepending the prefix
+////////////////////////////////////////
+static
+inline
+void
+ht_key_write
+(
+	uint8_t		*dest,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	size_t pl = 0;
+
+	if(prefix != 0)
+	{
+		pl = prefix->prefix_length;
+		memcpy(dest,prefix->prefix,pl);
+	}
+	memcpy(dest + pl,key,key_length);
+}
+
+////////////////////////////////////////
+//	copy a key, prepending the prefix
+////////////////////////////////////////
+static
+inline
+uint8_t *
+ht_key_copy
+(
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix,
+	size_t		*copy_length
+)
+{
+	size_t pl = prefix ? prefix->prefix_length : 0;
+	uint8_t *k = malloc(pl + key_length);
+
+	ht_key_write(k,key,key_length,prefix);
+
+	*copy_length = pl + key_length;
+
+	return k;
+}
+
+////////////////////////////////////////
+//	OWNED VALUES
+//	- tables owning their values copy them
+//		into the entry, value_inline bytes
+//		in, when they fit
+//		inline_value_length bytes, and into
+//		a malloc'd block when not
+////////////////////////////////////////
+static
+inline
+void *
+ht_v_inline_value
+(
+	ht_t		*ht,
+	ht_entry_t	*v
+)
+{
+	return ht->inline_value_length ? (void *) v + ht->value_inline : 0;
+}
+
+////////////////////////////////////////
+//	give up an entry's value
+//	- owned values are freed, others are
+//		passed to destroy_value
+////////////////////////////////////////
+static
+inline
+void
+ht_v_free_value
+(
+	ht_t		*ht,
+	ht_entry_t	*v
+)
+{
+	if(ht->own_values)
+	{
+		if(v->value != ht_v_inline_value(ht,v))
+		{
+			free(v->value);
+		}
+		return;
+	}
+
+	if(v->value)
+	{
+		if(ht->destroy_value)
+		{
+			ht->destroy_value(v->value,ht->extra);
+		}
+	}
+}
+
+////////////////////////////////////////
+//	set an entry's value, replacing the
+//		value it had unless fresh
+//	- the new value may be the old one's
+//		copy, so the old block is freed
+//		only once the value is copied
+////////////////////////////////////////
+static
+inline
+void
+ht_v_set_value
+(
+	ht_t		*ht,
+	ht_entry_t	*v,
+	void		*value,
+	size_t		 value_length,
+	int		 fresh
+)
+{
+	if(!ht->own_values)
+	{
+		v->value = value;
+		v->value_length = value_length;
+		return;
+	}
+
+	void *inline_value = ht_v_inline_value(ht,v);
+	void *old = fresh || v->value == inline_value ? 0 : v->value;
+	void *copy;
+
+	if(inline_value != 0 && value_length <= ht->inline_value_length)
+	{
+		copy = inline_value;
+		memmove(copy,value,value_length);
+	}
+	else
+	{
+		copy = malloc(value_length ? value_length : 1);
+		memcpy(copy,value,value_length);
+	}
+
+	free(old);
+
+	v->value = copy;
+	v->value_length = value_length;
+}
+
+static
+void
+ht_v_destroy
+(
+	ht_entry_t	*v,
+	ht_t	*ht
+)
+{
+	ht_v_free_value(ht,v);
+
+	////////////////////////////////////////
+	//	pooled nodes are reused, their keys
+	//		are inline or in the key arena
+	////////////////////////////////////////
+	if(ht->inline_key_length != 0)
+	{
+		v->next = ht->free_nodes;
+		ht->free_nodes = v;
+		return;
+	}
+
+	if(v->key)
+	{
+		free(v->key);
+	}
+
+	free(v);
+}
+
+////////////////////////////////////////
+//	destroy every entry of a chain
+//	- pooled nodes and keys are released
+//		with their slabs, so only values
+//		are visited
+////////////////////////////////////////
+static
+void
+ht_v_destroy_chain
+(
+	ht_entry_t	*data,
+	ht_t	*ht
+)
+{
+	if(ht->inline_key_length != 0)
+	{
+		if(ht->destroy_value == 0 && !ht->own_values)
+		{
+			return;
+		}
+
+		while(data)
+		{
+			ht_v_free_value(ht,data);
+			data = data->next;
+		}
+
+		return;
+	}
+
+	while(data)
+	{
+		ht_entry_t *next = data->next;
+
+		ht_v_destroy(data,ht);
+
+		data = next;
+	}
+}
+
+////////////////////////////////////////
+//	find the link pointing at the entry
+//		with the given key
+//	- the stored hash is compared first,
+//		so the key bytes are only read
+//		for likely matches
+////////////////////////////////////////
+static
+inline
+ht_entry_t **
+ht_v_find_link
+(
+	ht_entry_t	**link,
+	uint64_t	  hash,
+	const void	 *key,
+	size_t		  key_length,
+	ht_prefix	 *prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	while(*link)
+	{
+		ht_entry_t *v = *link;
+
+		HT_PROBE();
+
+		if(v->hash == hash
+			&& ht_key_equal(v->key,v->key_length,key,key_length,prefix))
+		{
+			HT_PROBES_END();
+			return link;
+		}
+
+		link = &v->next;
+	}
+	HT_PROBES_END();
+	return 0;
+}
+
+static
+inline
+ht_entry_t *
+ht_v_find
+(
+	ht_entry_t	*list,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	ht_entry_t *next = list;
+	while(next)
+	{
+		HT_PROBE();
+
+		if(next->hash == hash
+			&& ht_key_equal(next->key,next->key_length,key,key_length,prefix))
+		{
+			HT_PROBES_END();
+			return next;
+		}
+		next = next->next;
+	}
+	HT_PROBES_END();
+	return 0;
+}
+
+////////////////////////////////////////
+//	create an entry
+//	- pooled tables take the node from
+//		the free list or the node slabs,
+//		and store keys of up to
+//		inline_key_length bytes in the
+//		node and longer ones in the key
+//		arena
+//	- the lists are passed in so bulk
+//		loading threads can carve from
+//		slabs of their own
+////////////////////////////////////////
+static
+inline
+ht_entry_t *
+ht_v_create_from
+(
+	ht_t		 *ht,
+	ht_slab_t	**node_slabs,
+	ht_slab_t	**key_slabs,
+	ht_entry_t	**free_nodes,
+	uint64_t	  hash,
+	void		 *value,
+	size_t		  value_length,
+	const void	 *key,
+	size_t		  key_length,
+	ht_prefix	 *prefix
+)
+{
+	ht_entry_t *v;
+	uint8_t *k;
+	size_t kl;
+
+	if(ht->inline_key_length == 0)
+	{
+		k = ht_key_copy(key,key_length,prefix,&kl);
+		v = malloc(ht->node_size);
+
+		HT_ALLOC(ht->node_size,kl);
+	}
+	else
+	{
+		v = *free_nodes;
+		if(v != 0)
+		{
+			*free_nodes = v->next;
+		}
+		else
+		{
+			v = ht_slab_alloc(node_slabs,ht->node_size);
+		}
+
+		kl = key_length + (prefix ? prefix->prefix_length : 0);
+		if(kl <= ht->inline_key_length)
+		{
+			k = v->inline_key;
+		}
+		else
+		{
+			k = ht_slab_alloc(key_slabs,kl);
+		}
+
+		ht_key_write(k,key,key_length,prefix);
+	}
+
+	*v = (ht_entry_t) {
+		.hash = hash,
+		.next = 0,
+		.key_length = kl,
+		.key = k,
+	};
+
+	ht_v_set_value(ht,v,value,value_length,1);
+
+	return v;
+}
+
+////////////////////////////////////////
+//	the namespace link of an entry
+////////////////////////////////////////
+static
+inline
+ht_ns_link_t *
+ht_ns_link
+(
+	ht_t		*ht,
+	ht_entry_t	*v
+)
+{
+	return (void *) v + ht->namespace_link;
+}
+
+static
+ht_namespace_t **
+ht_ns_find
+(
+	ht_t		*ht,
+	ht_prefix	*prefix
+)
+{
+	ht_namespace_t **link = &ht->namespaces[prefix->id & (ht->namespaces_length - 1)];
+
+	while(*link)
+	{
+		ht_namespace_t *n = *link;
+
+		if(n->id == prefix->id
+			&& n->prefix_length == prefix->prefix_length
+			&& memcmp(n->prefix,prefix->prefix,prefix->prefix_length) == 0)
+		{
+			break;
+		}
+
+		link = &n->next;
+	}
+
+	return link;
+}
+
+////////////////////////////////////////
+//	the namespace of a prefix, created if
+//		there is none
+////////////////////////////////////////
+static
+ht_namespace_t *
+ht_ns_get
+(
+	ht_t		*ht,
+	ht_prefix	*prefix
+)
+{
+	if(ht->namespaces == 0)
+	{
+		ht->namespaces_length = 16;
+		ht->namespaces = calloc(ht->namespaces_length,sizeof(ht_namespace_t *));
+	}
+
+	ht_namespace_t **link = ht_ns_find(ht,prefix);
+
+	if(*link != 0)
+	{
+		return *link;
+	}
+
+	ht_namespace_t *n = malloc(sizeof(ht_namespace_t) + prefix->prefix_length);
+	*n = (ht_namespace_t) {
+		.next		= 0,
+		.id		= prefix->id,
+		.entries	= 0,
+		.num_of_entries	= 0,
+		.prefix_length	= prefix->prefix_length,
+	};
+	memcpy(n->prefix,prefix->prefix,prefix->prefix_length);
+
+	*link = n;
+	ht->num_of_namespaces++;
+
+	////////////////////////////////////////
+	//	double the table once namespaces
+	//		outnumber its buckets
+	////////////////////////////////////////
+	if(ht->num_of_namespaces > ht->namespaces_length)
+	{
+		size_t l = ht->namespaces_length * 2;
+		ht_namespace_t **t = calloc(l,sizeof(ht_namespace_t *));
+
+		for(size_t i = 0; i < ht->namespaces_length; i++)
+		{
+			ht_namespace_t *data = ht->namespaces[i];
+
+			while(data)
+			{
+				ht_namespace_t *next = data->next;
+
+				data->next = t[data->id & (l - 1)];
+				t[data->id & (l - 1)] = data;
+
+				data = next;
+			}
+		}
+
+		free(ht->namespaces);
+		ht->namespaces = t;
+		ht->namespaces_length = l;
+	}
+
+	return n;
+}
+
+////////////////////////////////////////
+//	put a list of count entries, linked
+//		from first to last, in front of a
+//		namespace's entries
+////////////////////////////////////////
+static
+void
+ht_ns_splice
+(
+	ht_t		*ht,
+	ht_namespace_t	*space,
+	ht_entry_t	*first,
+	ht_entry_t	*last,
+	size_t		 count
+)
+{
+	if(first == 0)
+	{
+		return;
+	}
+
+	ht_ns_link(ht,last)->next = space->entries;
+	if(space->entries != 0)
+	{
+		ht_ns_link(ht,space->entries)->prev = last;
+	}
+
+	space->entries = first;
+	space->num_of_entries += count;
+}
+
+////////////////////////////////////////
+//	free a namespace left without entries
+////////////////////////////////////////
+static
+void
+ht_ns_release
+(
+	ht_t		*ht,
+	ht_namespace_t	*space
+)
+{
+	if(space->num_of_entries != 0)
+	{
+		return;
+	}
+
+	ht_namespace_t **link = &ht->namespaces[space->id & (ht->namespaces_length - 1)];
+
+	while(*link != space)
+	{
+		link = &(*link)->next;
+	}
+
+	*link = space->next;
+	ht->num_of_namespaces--;
+
+	free(space);
+}
+
+static
+void
+ht_ns_unlink
+(
+	ht_t		*ht,
+	ht_entry_t	*v
+)
+{
+	ht_ns_link_t *l = ht_ns_link(ht,v);
+	ht_namespace_t *space = l->space;
+
+	if(space == 0)
+	{
+		return;
+	}
+
+	if(l->prev != 0)
+	{
+		ht_ns_link(ht,l->prev)->next = l->next;
+	}
+	else
+	{
+		space->entries = l->next;
+	}
+
+	if(l->next != 0)
+	{
+		ht_ns_link(ht,l->next)->prev = l->prev;
+	}
+
+	space->num_of_entries--;
+	ht_ns_release(ht,space);
+}
+
+////////////////////////////////////////
+//	the link pointing at an entry in a
+//		chain, 0 if it is not there
+////////////////////////////////////////
+static
+ht_entry_t **
+ht_v_link_to
+(
+	ht_entry_t	**link,
+	ht_entry_t	 *v
+)
+{
+	while(*link != 0 && *link != v)
+	{
+		link = &(*link)->next;
+	}
+
+	return *link ? link : 0;
+}
+
+////////////////////////////////////////
+//	free every namespace, for clearing
+////////////////////////////////////////
+static
+void
+ht_ns_clear
+(
+	ht_t	*ht
+)
+{
+	for(size_t i = 0; i < ht->namespaces_length; i++)
+	{
+		ht_namespace_t *data = ht->namespaces[i];
+
+		while(data)
+		{
+			ht_namespace_t *next = data->next;
+			free(data);
+			data = next;
+		}
+
+		ht->namespaces[i] = 0;
+	}
+
+	ht->num_of_namespaces = 0;
+}
+
+////////////////////////////////////////
+//	create an entry and, for tables with
+//		namespaces, list it under its
+//		prefix
+////////////////////////////////////////
+static
+inline
+ht_entry_t *
+ht_v_create
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	ht_entry_t *v = ht_v_create_from(
+		ht,
+		&ht->node_slabs,
+		&ht->key_slabs,
+		&ht->free_nodes,
+		hash,
+		value,
+		value_length,
+		key,
+		key_length,
+		prefix
+	);
+
+	if(ht->namespace_link != 0)
+	{
+		ht_ns_link_t *l = ht_ns_link(ht,v);
+
+		*l = (ht_ns_link_t) {
+			.space	= 0,
+			.prev	= 0,
+			.next	= 0,
+		};
+
+		if(prefix != 0)
+		{
+			l->space = ht_ns_get(ht,prefix);
+			ht_ns_splice(ht,l->space,v,v,1);
+		}
+	}
+
+	return v;
+}
+
+////////////////////////////////////////
+//	find an entry in either bucket array
+//	- while rehashing, old buckets before
+//		rehash_index have been emptied
+////////////////////////////////////////
+static
+inline
+ht_entry_t **
+ht_v_lookup_link
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->old_table != 0)
+	{
+		size_t oi = ht_old_index(ht,hash);
+
+		if(oi >= ht->rehash_index)
+		{
+			ht_entry_t **link = ht_v_find_link(
+				&ht->old_table[oi],
+				hash,
+				key,
+				key_length,
+				prefix
+			);
+
+			if(link != 0)
+			{
+				return link;
+			}
+		}
+	}
+
+	return ht_v_find_link(
+		&ht->table[ht_index(ht,hash)],
+		hash,
+		key,
+		key_length,
+		prefix
+	);
+}
+
+static
+inline
+ht_entry_t *
+ht_v_lookup
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->old_table == 0)
+	{
+		return ht_v_find(
+			ht->table[ht_index(ht,hash)],
+			hash,
+			key,
+			key_length,
+			prefix
+		);
+	}
+
+	ht_entry_t **link = ht_v_lookup_link(ht,hash,key,key_length,prefix);
+
+	return link ? *link : 0;
+}
+
+////////////////////////////////////////
+//	INCREMENTAL REHASHING
+//	- a new bucket array is installed as
+//		table and the previous one is kept
+//		as old_table
+//	- every add, update and remove moves a
+//		few old buckets into table
+//	- new entries only go into table
+////////////////////////////////////////
+#define HT_REHASH_STEP		4
+#define HT_REHASH_EMPTY_VISITS	(HT_REHASH_STEP * 16)
+
+static
+void
+ht_rehash_begin
+(
+	ht_t	*ht,
+	size_t	 table_length
+)
+{
+	HT_RESIZE_BEGIN(ht->table_length,table_length);
+
+	ht->old_table = ht->table;
+	ht->old_table_length = ht->table_length;
+	ht->rehash_index = 0;
+
+	ht->table = calloc(table_length,sizeof(ht_entry_t *));
+	ht->table_length = table_length;
+	ht->moves++;
+
+	HT_RESIZE_END(table_length);
+}
+
+////////////////////////////////////////
+//	move up to buckets non-empty old
+//		buckets, giving up after
+//		empty_visits empty ones
+////////////////////////////////////////
+static
+void
+ht_rehash_step
+(
+	ht_t	*ht,
+	size_t	 buckets,
+	size_t	 empty_visits
+)
+{
+	while(ht->old_table != 0 && buckets > 0)
+	{
+		ht_entry_t *data = ht->old_table[ht->rehash_index];
+
+		if(data == 0)
+		{
+			empty_visits--;
+		}
+		else
+		{
+			buckets--;
+			ht->moves++;
+		}
+
+		while(data)
+		{
+			ht_entry_t *next = data->next;
+
+			size_t index = ht_index(ht,data->hash);
+			data->next = ht->table[index];
+			ht->table[index] = data;
+
+			data = next;
+		}
+
+		ht->old_table[ht->rehash_index] = 0;
+		ht->rehash_index++;
+
+		if(ht->rehash_index == ht->old_table_length)
+		{
+			free(ht->old_table);
+			ht->old_table = 0;
+			ht->old_table_length = 0;
+			ht->rehash_index = 0;
+		}
+
+		if(empty_visits == 0)
+		{
+			return;
+		}
+	}
+}
+
+static
+inline
+void
+ht_rehash_finish
+(
+	ht_t	*ht
+)
+{
+	ht_rehash_step(ht,SIZE_MAX,SIZE_MAX);
+}
+
+////////////////////////////////////////
+//	called before inserting an entry
+//	- if the table is already rehashing
+//		and has outgrown the new array,
+//		the rehash is finished first
+////////////////////////////////////////
+static
+inline
+void
+ht_v_grow
+(
+	ht_t	*ht
+)
+{
+	ht_rehash_step(ht,HT_REHASH_STEP,HT_REHASH_EMPTY_VISITS);
+
+	if(ht->max_load_factor <= 0)
+	{
+		return;
+	}
+
+	if(ht->num_of_entries + 1 <= ht->max_load_factor * ht->table_length)
+	{
+		return;
+	}
+
+	ht_rehash_finish(ht);
+	ht_rehash_begin(ht,ht->table_length * 2);
+}
+
+////////////////////////////////////////
+//	called after removing an entry
+//	- never shrinks below the length the
+//		table was created with
+////////////////////////////////////////
+static
+inline
+void
+ht_v_shrink
+(
+	ht_t	*ht
+)
+{
+	ht_rehash_step(ht,HT_REHASH_STEP,HT_REHASH_EMPTY_VISITS);
+
+	if(ht->min_load_factor <= 0 || ht->old_table != 0)
+	{
+		return;
+	}
+
+	size_t l = ht->table_length / 2;
+
+	if(l < ht->min_table_length
+		|| ht->num_of_entries >= ht->min_load_factor * ht->table_length)
+	{
+		return;
+	}
+
+	ht_rehash_begin(ht,l);
+}
+
+////////////////////////////////////////
+//	RESEEDING
+//	- a chain grown past max_chain_length
+//		is taken as keys chosen to collide
+//		under the seed, so every key is
+//		hashed again under a random one
+//	- stored keys include their prefix,
+//		which hashes the same as the
+//		prefix and key apart
+//	- entries stay where they are in
+//		memory, only their hashes and
+//		buckets change
+////////////////////////////////////////
+static
+void
+ht_random_seed
+(
+	ht_t		*ht,
+	ht_seed_t	*seed
+)
+{
+	if(getentropy(seed,sizeof(ht_seed_t)) == 0)
+	{
+		return;
+	}
+
+	////////////////////////////////////////
+	//	without an entropy source, the old
+	//		seed is stirred with the time
+	////////////////////////////////////////
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+
+	uint64_t h1 = seed->s128[0] ^ (uintptr_t) ht;
+	uint64_t h2 = seed->s128[1] ^ ht->reseeds;
+	uint64_t words[2] = {ts.tv_sec,ts.tv_nsec};
+
+	spookyhash128(words,sizeof(words),&h1,&h2);
+
+	seed->s128[0] = h1;
+	seed->s128[1] = h2;
+}
+
+static
+void
+ht_reseed
+(
+	ht_t	*ht
+)
+{
+	ht_rehash_finish(ht);
+	ht_random_seed(ht,&ht->seed);
+
+	ht_entry_t *all = 0;
+
+	for(size_t i = 0; i < ht->table_length; i++)
+	{
+		ht_entry_t *data = ht->table[i];
+
+		while(data)
+		{
+			ht_entry_t *next = data->next;
+			data->next = all;
+			all = data;
+			data = next;
+		}
+
+		ht->table[i] = 0;
+	}
+
+	while(all)
+	{
+		ht_entry_t *next = all->next;
+
+		all->hash = ht_hash(ht,all->key,all->key_length,0).word;
+
+		size_t index = ht_index(ht,all->hash);
+		all->next = ht->table[index];
+		ht->table[index] = all;
+
+		all = next;
+	}
+
+	ht->moves++;
+	ht->reseeds++;
+	ht->reseed_entries = ht->num_of_entries;
+}
+
+////////////////////////////////////////
+//	reseed if a chain of length entries
+//		is too long, and the table has
+//		doubled since the last reseed
+////////////////////////////////////////
+static
+inline
+void
+ht_reseed_check
+(
+	ht_t	*ht,
+	size_t	 length
+)
+{
+	if(ht->max_chain_length != 0
+		&& length > ht->max_chain_length
+		&& ht->num_of_entries >= 2 * ht->reseed_entries)
+	{
+		ht_reseed(ht);
+	}
+}
+
+static
+inline
+void
+ht_v_append
+(
+	ht_t	*ht,
+	int	 index,
+	ht_entry_t	*v
+)
+{
+	ht_entry_t *vs = ht->table[index];
+
+	if(vs == 0)
+	{
+		ht->table[index] = v;
+		return;
+	}
+
+	size_t length = 2;
+
+	while(vs->next)
+	{
+		vs = vs->next;
+		length++;
+	}
+
+	vs->next = v;
+
+	ht_reseed_check(ht,length);
+}
+
+static
+void
+ht_vacuous_free
+(
+	void	*data,
+	void	*extra
+)
+{
+	free(data);
+}
+
+////////////////////////////////////////
+//	OPEN ADDRESSING
+//	- one control byte per slot
+//		- HT_CTRL_EMPTY or HT_CTRL_DELETED,
+//			or the top 7 bits of the hash
+//			of the slot's key
+//	- slots are probed HT_GROUP_WIDTH at
+//		a time, moving between groups
+//		with triangular steps so every
+//		group is visited
+//	- lookups stop at the first group
+//		with an empty slot
+////////////////////////////////////////
+#define HT_CTRL_EMPTY	((uint8_t) 0x80)
+#define HT_CTRL_DELETED	((uint8_t) 0xfe)
+#define HT_NO_SLOT	((size_t) -1)
+
+#if HT_GROUP_WIDTH == 8
+#define HT_GROUP_LSBS	0x0101010101010101ULL
+#define HT_GROUP_MSBS	0x8080808080808080ULL
+typedef uint64_t ht_bitmask_t;
+#else
+typedef uint32_t ht_bitmask_t;
+#endif
+
+static
+inline
+size_t
+ht_bitmask_lowest
+(
+	ht_bitmask_t	m
+)
+{
+#if HT_GROUP_WIDTH == 8
+	return __builtin_ctzll(m) >> 3;
+#else
+	return __builtin_ctz(m);
+#endif
+}
+
+////////////////////////////////////////
+//	slots in the group whose control byte
+//		is h2
+//	- the portable version may report
+//		false positives, which the key
+//		compare rejects
+////////////////////////////////////////
+static
+inline
+ht_bitmask_t
+ht_group_match
+(
+	const uint8_t	*group,
+	uint8_t		 h2
+)
+{
+#if HT_GROUP_WIDTH == 32
+	__m256i g = _mm256_loadu_si256((const __m256i *) group);
+	return (uint32_t) _mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(g,_mm256_set1_epi8((char) h2))
+	);
+#elif HT_GROUP_WIDTH == 16
+	__m128i g = _mm_loadu_si128((const __m128i *) group);
+	return (uint32_t) _mm_movemask_epi8(
+		_mm_cmpeq_epi8(g,_mm_set1_epi8((char) h2))
+	);
+#else
+	uint64_t g;
+	memcpy(&g,group,sizeof(g));
+	uint64_t x = g ^ (HT_GROUP_LSBS * h2);
+	return (x - HT_GROUP_LSBS) & ~x & HT_GROUP_MSBS;
+#endif
+}
+
+static
+inline
+ht_bitmask_t
+ht_group_match_empty
+(
+	const uint8_t	*group
+)
+{
+#if HT_GROUP_WIDTH == 32
+	__m256i g = _mm256_loadu_si256((const __m256i *) group);
+	return (uint32_t) _mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(g,_mm256_set1_epi8((char) HT_CTRL_EMPTY))
+	);
+#elif HT_GROUP_WIDTH == 16
+	__m128i g = _mm_loadu_si128((const __m128i *) group);
+	return (uint32_t) _mm_movemask_epi8(
+		_mm_cmpeq_epi8(g,_mm_set1_epi8((char) HT_CTRL_EMPTY))
+	);
+#else
+	uint64_t g;
+	memcpy(&g,group,sizeof(g));
+	return g & ~(g << 6) & HT_GROUP_MSBS;
+#endif
+}
+
+static
+inline
+ht_bitmask_t
+ht_group_match_empty_or_deleted
+(
+	const uint8_t	*group
+)
+{
+#if HT_GROUP_WIDTH == 32
+	__m256i g = _mm256_loadu_si256((const __m256i *) group);
+	return (uint32_t) _mm256_movemask_epi8(g);
+#elif HT_GROUP_WIDTH == 16
+	__m128i g = _mm_loadu_si128((const __m128i *) group);
+	return (uint32_t) _mm_movemask_epi8(g);
+#else
+	uint64_t g;
+	memcpy(&g,group,sizeof(g));
+	return g & HT_GROUP_MSBS;
+#endif
+}
+
+static
+inline
+uint8_t
+ht_oa_h2
+(
+	ht_t		*ht,
+	uint64_t	 hash
+)
+{
+	return (uint8_t) ((hash >> (ht->hash_bits - 7)) & 0x7f);
+}
+
+static
+inline
+size_t
+ht_oa_capacity
+(
+	size_t	table_length
+)
+{
+	if(table_length < HT_GROUP_WIDTH)
+	{
+		return HT_GROUP_WIDTH;
+	}
+	return ht_round_up_pow2(table_length);
+}
+
+static
+void
+ht_oa_allocate
+(
+	ht_t	*ht,
+	size_t	 capacity
+)
+{
+	ht->control = aligned_alloc(HT_GROUP_WIDTH,capacity);
+	ht->slots = malloc(capacity * sizeof(ht_slot_t));
+	ht->table_length = capacity;
+	ht->growth_left = capacity - capacity / 8;
+
+	memset(ht->control,HT_CTRL_EMPTY,capacity);
+}
+
+static
+inline
+size_t
+ht_oa_find
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	size_t groups_mask = ht->table_length / HT_GROUP_WIDTH - 1;
+	size_t g = hash & groups_mask;
+	uint8_t h2 = ht_oa_h2(ht,hash);
+
+	for(size_t step = 1; ; step++)
+	{
+		const uint8_t *group = ht->control + g * HT_GROUP_WIDTH;
+
+		HT_PROBE();
+
+		ht_bitmask_t m = ht_group_match(group,h2);
+		while(m)
+		{
+			size_t i = g * HT_GROUP_WIDTH + ht_bitmask_lowest(m);
+			ht_slot_t *s = &ht->slots[i];
+
+			HT_PROBE();
+
+			if(s->hash == hash
+				&& ht_key_equal(s->key,s->key_length,key,key_length,prefix))
+			{
+				HT_PROBES_END();
+				return i;
+			}
+
+			m &= m - 1;
+		}
+
+		if(ht_group_match_empty(group))
+		{
+			HT_PROBES_END();
+			return HT_NO_SLOT;
+		}
+
+		g = (g + step) & groups_mask;
+	}
+}
+
+static
+inline
+size_t
+ht_oa_find_free
+(
+	ht_t		*ht,
+	uint64_t	 hash
+)
+{
+	size_t groups_mask = ht->table_length / HT_GROUP_WIDTH - 1;
+	size_t g = hash & groups_mask;
+
+	for(size_t step = 1; ; step++)
+	{
+		ht_bitmask_t m = ht_group_match_empty_or_deleted(
+			ht->control + g * HT_GROUP_WIDTH
+		);
+
+		if(m)
+		{
+			return g * HT_GROUP_WIDTH + ht_bitmask_lowest(m);
+		}
+
+		g = (g + step) & groups_mask;
+	}
+}
+
+////////////////////////////////////////
+//	move every slot into freshly allocated
+//		arrays of the given capacity
+//	- uses the stored hash, keys are not
+//		rehashed or copied
+//	- drops all tombstones
+////////////////////////////////////////
+static
+void
+ht_oa_rehash
+(
+	ht_t	*ht,
+	size_t	 capacity
+)
+{
+	uint8_t *oc = ht->control;
+	ht_slot_t *os = ht->slots;
+	size_t ol = ht->table_length;
+
+	HT_RESIZE_BEGIN(ol,capacity);
+
+	ht_oa_allocate(ht,capacity);
+
+	for(size_t i = 0; i < ol; i++)
+	{
+		if(oc[i] & HT_CTRL_EMPTY)
+		{
+			continue;
+		}
+
+		size_t j = ht_oa_find_free(ht,os[i].hash);
+		ht->control[j] = oc[i];
+		ht->slots[j] = os[i];
+	}
+
+	ht->growth_left -= ht->num_of_entries;
+	ht->moves++;
+
+	free(oc);
+	free(os);
+
+	HT_RESIZE_END(capacity);
+}
+
+////////////////////////////////////////
+//	make room for one more entry
+//	- tombstones are reclaimed without
+//		growing when at most half of the
+//		usable slots hold live entries
+////////////////////////////////////////
+static
+void
+ht_oa_reserve
+(
+	ht_t	*ht
+)
+{
+	size_t c = ht->table_length;
+
+	if(ht->num_of_entries + 1 <= (c - c / 8) / 2)
+	{
+		ht_oa_rehash(ht,c);
+	}
+	else
+	{
+		ht_oa_rehash(ht,c * 2);
+	}
+}
+
+static
+size_t
+ht_oa_insert
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	size_t i = ht_oa_find_free(ht,hash);
+
+	if(ht->growth_left == 0 && ht->control[i] == HT_CTRL_EMPTY)
+	{
+		ht_oa_reserve(ht);
+		i = ht_oa_find_free(ht,hash);
+	}
+
+	if(ht->control[i] == HT_CTRL_EMPTY)
+	{
+		ht->growth_left--;
+	}
+
+	size_t kl;
+	uint8_t *k = ht_key_copy(key,key_length,prefix,&kl);
+
+	ht->control[i] = ht_oa_h2(ht,hash);
+	ht->slots[i] = (ht_slot_t) {
+		.key = k,
+		.key_length = kl,
+		.value = value,
+		.value_length = value_length,
+		.hash = hash,
+	};
+	ht->num_of_entries++;
+
+	return i;
+}
+
+static
+void
+ht_oa_erase
+(
+	ht_t	*ht,
+	size_t	 i
+)
+{
+	ht_slot_t *s = &ht->slots[i];
+
+	free(s->key);
+	if(s->value && ht->destroy_value)
+	{
+		ht->destroy_value(s->value,ht->extra);
+	}
+
+	////////////////////////////////////////
+	//	no probe has ever continued past
+	//		a group that still has an
+	//		empty slot
+	////////////////////////////////////////
+	size_t g = i - i % HT_GROUP_WIDTH;
+	if(ht_group_match_empty(ht->control + g))
+	{
+		ht->control[i] = HT_CTRL_EMPTY;
+		ht->growth_left++;
+	}
+	else
+	{
+		ht->control[i] = HT_CTRL_DELETED;
+	}
+
+	ht->num_of_entries--;
+}
+
+////////////////////////////////////////
+//	CUCKOO HASHING
+//	- buckets of HT_CUCKOO_WAYS slots, with
+//		the open layout's control bytes
+//		and slots, and no tombstones
+//	- a key lives in the bucket picked by
+//		one of the two words of its 128
+//		bit hash, or in the stash after
+//		the last bucket
+//		- the second word, the slot's
+//			hash, picks the bucket tried
+//			first, the first word is kept
+//			in alternates
+//		- the first word is only read if
+//			the key is not in the first
+//			bucket, so most lookups do not
+//			wait on it
+//	- a lookup reads the control bytes of
+//		two buckets, one word each, then
+//		the stash while it is not empty
+//	- the stash starts at HT_CUCKOO_STASH
+//		slots and only grows for keys
+//		that share their buckets so often
+//		that more buckets would not help
+////////////////////////////////////////
+#define HT_CUCKOO_WAYS		4
+#define HT_CUCKOO_STASH		8
+#define HT_CUCKOO_QUEUE		256
+#define HT_CUCKOO_LSBS		0x01010101U
+#define HT_CUCKOO_MSBS		0x80808080U
+
+static
+inline
+size_t
+ht_ck_buckets
+(
+	ht_t	*ht
+)
+{
+	return (ht->table_length - ht->stash_length) / HT_CUCKOO_WAYS;
+}
+
+static
+inline
+uint32_t
+ht_ck_control
+(
+	ht_t	*ht,
+	size_t	 b
+)
+{
+	uint32_t c;
+	memcpy(&c,ht->control + b * HT_CUCKOO_WAYS,sizeof(c));
+	return c;
+}
+
+////////////////////////////////////////
+//	ways of a bucket whose control byte
+//		is h2, as the top bit of each
+//		byte
+//	- may report false positives next to
+//		a true match, which the key
+//		compare rejects
+////////////////////////////////////////
+static
+inline
+uint32_t
+ht_ck_match
+(
+	uint32_t	c,
+	uint8_t		h2
+)
+{
+	uint32_t x = c ^ (HT_CUCKOO_LSBS * h2);
+	return (x - HT_CUCKOO_LSBS) & ~x & HT_CUCKOO_MSBS;
+}
+
+////////////////////////////////////////
+//	buckets fill to 7/8 before the table
+//		grows, the stash is not counted
+////////////////////////////////////////
+static
+inline
+size_t
+ht_ck_limit
+(
+	size_t	buckets
+)
+{
+	size_t slots = buckets * HT_CUCKOO_WAYS;
+	return slots - slots / 8;
+}
+
+static
+inline
+size_t
+ht_ck_buckets_for
+(
+	size_t	table_length
+)
+{
+	return ht_round_up_pow2((table_length + HT_CUCKOO_WAYS - 1) / HT_CUCKOO_WAYS);
+}
+
+static
+void
+ht_ck_allocate
+(
+	ht_t	*ht,
+	size_t	 buckets,
+	size_t	 stash_length
+)
+{
+	size_t capacity = buckets * HT_CUCKOO_WAYS + stash_length;
+
+	ht->control = aligned_alloc(HT_CUCKOO_WAYS,capacity);
+	ht->slots = malloc(capacity * sizeof(ht_slot_t));
+	ht->alternates = malloc(capacity * sizeof(uint64_t));
+	ht->table_length = capacity;
+	ht->stash_length = stash_length;
+	ht->stash_used = 0;
+	ht->growth_left = ht_ck_limit(buckets);
+
+	memset(ht->control,HT_CTRL_EMPTY,capacity);
+}
+
+////////////////////////////////////////
+//	kept out of line so ht_ck_find stays
+//		small enough to inline
+////////////////////////////////////////
+static
+__attribute__((noinline))
+size_t
+ht_ck_find_stash
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	uint8_t h2 = ht_oa_h2(ht,hash);
+
+	for(size_t i = ht->table_length - ht->stash_length; i < ht->table_length; i++)
+	{
+		ht_slot_t *s = &ht->slots[i];
+
+		if(ht->control[i] == h2
+			&& s->hash == hash
+			&& ht_key_equal(s->key,s->key_length,key,key_length,prefix))
+		{
+			return i;
+		}
+	}
+
+	return HT_NO_SLOT;
+}
+
+static
+inline
+size_t
+ht_ck_find
+(
+	ht_t		*ht,
+	uint64_t	 alternate,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	size_t mask = ht_ck_buckets(ht) - 1;
+	size_t b = hash & mask;
+	uint8_t h2 = ht_oa_h2(ht,hash);
+
+	for(int k = 0; k < 2; k++)
+	{
+		HT_PROBE();
+
+		uint32_t m = ht_ck_match(ht_ck_control(ht,b),h2);
+		while(m)
+		{
+			size_t i = b * HT_CUCKOO_WAYS + (__builtin_ctz(m) >> 3);
+			ht_slot_t *s = &ht->slots[i];
+
+			HT_PROBE();
+
+			if(s->hash == hash
+				&& ht_key_equal(s->key,s->key_length,key,key_length,prefix))
+			{
+				HT_PROBES_END();
+				return i;
+			}
+
+			m &= m - 1;
+		}
+
+		if(b == (alternate & mask))
+		{
+			break;
+		}
+
+		b = alternate & mask;
+	}
+
+	size_t i = HT_NO_SLOT;
+
+	if(ht->stash_used != 0)
+	{
+		HT_PROBE();
+
+		i = ht_ck_find_stash(ht,hash,key,key_length,prefix);
+	}
+
+	HT_PROBES_END();
+	return i;
+}
+
+static
+inline
+void
+ht_ck_move
+(
+	ht_t	*ht,
+	size_t	 from,
+	size_t	 to
+)
+{
+	ht->control[to] = ht->control[from];
+	ht->slots[to] = ht->slots[from];
+	ht->alternates[to] = ht->alternates[from];
+	ht->control[from] = HT_CTRL_EMPTY;
+}
+
+////////////////////////////////////////
+//	a free slot in bucket b0 or b1, found
+//		by moving entries to their other
+//		bucket along the shortest path to
+//		an empty slot
+//	- the search is breadth first over at
+//		most HT_CUCKOO_QUEUE buckets, and
+//		a path never passes through the
+//		same bucket twice, so each slot
+//		on it is moved once
+//	- HT_NO_SLOT if no path was found,
+//		nothing is moved then
+////////////////////////////////////////
+typedef struct
+{
+	size_t		bucket;
+	int		parent;
+	unsigned int	way;
+} ht_ck_node_t;
+
+static
+size_t
+ht_ck_make_room
+(
+	ht_t	*ht,
+	size_t	 b0,
+	size_t	 b1
+)
+{
+	ht_ck_node_t queue[HT_CUCKOO_QUEUE];
+	size_t mask = ht_ck_buckets(ht) - 1;
+	int head = 0;
+	int tail = 0;
+
+	queue[tail++] = (ht_ck_node_t) {.bucket = b0, .parent = -1};
+	if(b1 != b0)
+	{
+		queue[tail++] = (ht_ck_node_t) {.bucket = b1, .parent = -1};
+	}
+
+	for(; head < tail; head++)
+	{
+		size_t b = queue[head].bucket;
+		uint32_t empty = ht_ck_control(ht,b) & HT_CUCKOO_MSBS;
+
+		if(empty)
+		{
+			size_t free_slot = b * HT_CUCKOO_WAYS + (__builtin_ctz(empty) >> 3);
+
+			if(queue[head].parent >= 0)
+			{
+				ht->moves++;
+			}
+
+			for(int n = head; queue[n].parent >= 0; n = queue[n].parent)
+			{
+				size_t from = queue[queue[n].parent].bucket * HT_CUCKOO_WAYS + queue[n].way;
+
+				ht_ck_move(ht,from,free_slot);
+				free_slot = from;
+			}
+
+			return free_slot;
+		}
+
+		for(unsigned int way = 0; way < HT_CUCKOO_WAYS && tail < HT_CUCKOO_QUEUE; way++)
+		{
+			size_t i = b * HT_CUCKOO_WAYS + way;
+			size_t other = ht->alternates[i] & mask;
+
+			if(other == b)
+			{
+				other = ht->slots[i].hash & mask;
+			}
+
+			int seen = 0;
+			for(int n = head; n >= 0 && !seen; n = queue[n].parent)
+			{
+				seen = queue[n].bucket == other;
+			}
+
+			if(!seen)
+			{
+				queue[tail++] = (ht_ck_node_t) {
+					.bucket = other,
+					.parent = head,
+					.way = way,
+				};
+			}
+		}
+	}
+
+	return HT_NO_SLOT;
+}
+
+////////////////////////////////////////
+//	a free slot for a key with the given
+//		words, in one of its buckets or
+//		else the stash
+////////////////////////////////////////
+static
+size_t
+ht_ck_find_free
+(
+	ht_t		*ht,
+	uint64_t	 alternate,
+	uint64_t	 hash
+)
+{
+	size_t mask = ht_ck_buckets(ht) - 1;
+	uint32_t empty = ht_ck_control(ht,hash & mask) & HT_CUCKOO_MSBS;
+
+	if(empty)
+	{
+		return (hash & mask) * HT_CUCKOO_WAYS + (__builtin_ctz(empty) >> 3);
+	}
+
+	size_t i = ht_ck_make_room(ht,hash & mask,alternate & mask);
+
+	if(i != HT_NO_SLOT || ht->stash_used == ht->stash_length)
+	{
+		return i;
+	}
+
+	for(i = ht->table_length - ht->stash_length; ht->control[i] != HT_CTRL_EMPTY; i++)
+	{
+	}
+
+	ht->stash_used++;
+
+	return i;
+}
+
+////////////////////////////////////////
+//	move every slot into freshly allocated
+//		arrays
+//	- uses the stored hashes, keys are
+//		not rehashed or copied
+//	- if an entry finds no room, the stash
+//		doubles while the buckets are
+//		under half full, more buckets
+//		would not help them, otherwise
+//		the buckets double
+//	- the old arrays are kept until every
+//		entry has been placed
+////////////////////////////////////////
+static
+void
+ht_ck_rehash
+(
+	ht_t	*ht,
+	size_t	 buckets,
+	size_t	 stash_length
+)
+{
+	uint8_t *oc = ht->control;
+	ht_slot_t *os = ht->slots;
+	uint64_t *oa = ht->alternates;
+	size_t ol = ht->table_length;
+
+	HT_RESIZE_BEGIN(ol,buckets * HT_CUCKOO_WAYS + stash_length);
+
+	for(;;)
+	{
+		ht_ck_allocate(ht,buckets,stash_length);
+
+		size_t i = 0;
+		for(; i < ol; i++)
+		{
+			if(oc[i] & HT_CTRL_EMPTY)
+			{
+				continue;
+			}
+
+			size_t j = ht_ck_find_free(ht,oa[i],os[i].hash);
+
+			if(j == HT_NO_SLOT)
+			{
+				break;
+			}
+
+			ht->control[j] = oc[i];
+			ht->slots[j] = os[i];
+			ht->alternates[j] = oa[i];
+		}
+
+		if(i == ol)
+		{
+			break;
+		}
+
+		free(ht->control);
+		free(ht->slots);
+		free(ht->alternates);
+
+		if(ht->num_of_entries < buckets * HT_CUCKOO_WAYS / 2)
+		{
+			stash_length *= 2;
+		}
+		else
+		{
+			buckets *= 2;
+		}
+	}
+
+	////////////////////////////////////////
+	//	a bigger stash can leave the buckets
+	//		holding more than the limit
+	////////////////////////////////////////
+	size_t used = ht->num_of_entries - ht->stash_used;
+	ht->growth_left = used < ht->growth_left ? ht->growth_left - used : 0;
+	ht->moves++;
+
+	free(oc);
+	free(os);
+	free(oa);
+
+	HT_RESIZE_END(ht->table_length);
+}
+
+static
+size_t
+ht_ck_insert
+(
+	ht_t		*ht,
+	uint64_t	 alternate,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	size_t i = HT_NO_SLOT;
+
+	if(ht->growth_left != 0)
+	{
+		i = ht_ck_find_free(ht,alternate,hash);
+	}
+
+	while(i == HT_NO_SLOT)
+	{
+		size_t buckets = ht_ck_buckets(ht);
+
+		if(ht->num_of_entries < buckets * HT_CUCKOO_WAYS / 2)
+		{
+			ht_ck_rehash(ht,buckets,ht->stash_length * 2);
+		}
+		else
+		{
+			ht_ck_rehash(ht,buckets * 2,HT_CUCKOO_STASH);
+		}
+
+		i = ht_ck_find_free(ht,alternate,hash);
+	}
+
+	if(i < ht->table_length - ht->stash_length && ht->growth_left != 0)
+	{
+		ht->growth_left--;
+	}
+
+	size_t kl;
+	uint8_t *k = ht_key_copy(key,key_length,prefix,&kl);
+
+	ht->control[i] = ht_oa_h2(ht,hash);
+	ht->slots[i] = (ht_slot_t) {
+		.key = k,
+		.key_length = kl,
+		.value = value,
+		.value_length = value_length,
+		.hash = hash,
+	};
+	ht->alternates[i] = alternate;
+	ht->num_of_entries++;
+
+	return i;
+}
+
+////////////////////////////////////////
+//	a slot freed in a bucket takes back a
+//		stashed entry that belongs there
+////////////////////////////////////////
+static
+void
+ht_ck_erase
+(
+	ht_t	*ht,
+	size_t	 i
+)
+{
+	ht_slot_t *s = &ht->slots[i];
+	size_t stash = ht->table_length - ht->stash_length;
+
+	free(s->key);
+	if(s->value && ht->destroy_value)
+	{
+		ht->destroy_value(s->value,ht->extra);
+	}
+
+	ht->control[i] = HT_CTRL_EMPTY;
+	ht->num_of_entries--;
+
+	if(i >= stash)
+	{
+		ht->stash_used--;
+		return;
+	}
+
+	ht->growth_left++;
+
+	size_t mask = ht_ck_buckets(ht) - 1;
+	size_t b = i / HT_CUCKOO_WAYS;
+
+	for(size_t j = stash; ht->stash_used != 0 && j < ht->table_length; j++)
+	{
+		if(ht->control[j] != HT_CTRL_EMPTY
+			&& ((ht->alternates[j] & mask) == b || (ht->slots[j].hash & mask) == b))
+		{
+			ht_ck_move(ht,j,i);
+			ht->stash_used--;
+			ht->growth_left--;
+			ht->moves++;
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////
+//	the open and cuckoo layouts share
+//		their slots, these pick the
+//		layout's probing
+//	- take the words of the hash rather
+//		than an ht_hash_t so they stay
+//		in registers, alternate is only
+//		read by the cuckoo layout
+////////////////////////////////////////
+static
+inline
+__attribute__((always_inline))
+size_t
+ht_slot_find
+(
+	ht_t		*ht,
+	uint64_t	 alternate,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		return ht_ck_find(ht,alternate,hash,key,key_length,prefix);
+	}
+
+	return ht_oa_find(ht,hash,key,key_length,prefix);
+}
+
+static
+inline
+size_t
+ht_slot_insert
+(
+	ht_t		*ht,
+	uint64_t	 alternate,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		return ht_ck_insert(ht,alternate,hash,value,value_length,key,key_length,prefix);
+	}
+
+	return ht_oa_insert(ht,hash,value,value_length,key,key_length,prefix);
+}
+
+static
+inline
+void
+ht_slot_erase
+(
+	ht_t	*ht,
+	size_t	 i
+)
+{
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		ht_ck_erase(ht,i);
+	}
+	else
+	{
+		ht_oa_erase(ht,i);
+	}
+}
+
+////////////////////////////////////////
+//	CONCURRENT TABLES
+//	- writers take the lock of the stripe
+//		their bucket falls in
+//	- readers take no locks, they announce
+//		the epoch they started in and
+//		retry a miss if a resize ran
+//		while they were walking
+//	- unlinked entries and replaced bucket
+//		arrays are retired and freed once
+//		the epoch has moved on twice, when
+//		no reader can still hold them
+//	- values are never changed in place,
+//		updates replace the entry
+////////////////////////////////////////
+#define HT_LOCK_STRIPES		256
+#define HT_READER_SLOTS		128
+#define HT_RETIRE_BATCH		64
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HT_CPU_RELAX()	__builtin_ia32_pause()
+#else
+#define HT_CPU_RELAX()	do {} while(0)
+#endif
+
+typedef struct
+{
+	int	locked;
+} __attribute__((aligned(64))) ht_lock_t;
+
+////////////////////////////////////////
+//	0 when free, otherwise the epoch the
+//		reader started in shifted left
+//		once, with the low bit set
+////////////////////////////////////////
+typedef struct
+{
+	uint64_t	state;
+} __attribute__((aligned(64))) ht_reader_slot_t;
+
+typedef struct
+{
+	size_t		 length;
+	ht_entry_t	*buckets[];
+} ht_cc_table_t;
+
+typedef enum
+{
+	HT_RETIRE_ENTRY,
+	HT_RETIRE_NODE,
+	HT_RETIRE_TABLE,
+} ht_retire_kind_t;
+
+typedef struct
+{
+	void			*p;
+	uint64_t		 epoch;
+	ht_retire_kind_t	 kind;
+} ht_retired_t;
+
+struct ht_concurrent_t
+{
+	ht_cc_table_t		*table;
+	uint64_t		 seq;
+	uint64_t		 epoch;
+	ht_lock_t		 stripes[HT_LOCK_STRIPES];
+	ht_reader_slot_t	 readers[HT_READER_SLOTS];
+	ht_lock_t		 retire_lock;
+	ht_retired_t		*retired;
+	size_t			 retired_length;
+	size_t			 retired_size;
+	size_t			 retire_threshold;
+};
+
+static __thread unsigned int ht_reader_hint;
+
+static
+inline
+void
+ht_lock
+(
+	ht_lock_t	*l
+)
+{
+	while(__atomic_exchange_n(&l->locked,1,__ATOMIC_ACQUIRE))
+	{
+		while(__atomic_load_n(&l->locked,__ATOMIC_RELAXED))
+		{
+			HT_CPU_RELAX();
+		}
+	}
+}
+
+static
+inline
+void
+ht_unlock
+(
+	ht_lock_t	*l
+)
+{
+	__atomic_store_n(&l->locked,0,__ATOMIC_RELEASE);
+}
+
+static
+ht_concurrent_t *
+ht_cc_create
+(
+	size_t	table_length
+)
+{
+	ht_concurrent_t *cc = aligned_alloc(64,sizeof(ht_concurrent_t));
+	memset(cc,0,sizeof(ht_concurrent_t));
+
+	cc->table = calloc(1,sizeof(ht_cc_table_t) + table_length * sizeof(ht_entry_t *));
+	cc->table->length = table_length;
+	cc->retire_threshold = HT_RETIRE_BATCH;
+
+	return cc;
+}
+
+////////////////////////////////////////
+//	claim a reader slot for the current
+//		epoch
+//	- threads remember the slot they last
+//		got so they rarely contend
+////////////////////////////////////////
+static
+inline
+ht_reader_slot_t *
+ht_cc_enter
+(
+	ht_concurrent_t	*cc
+)
+{
+	unsigned int i = ht_reader_hint;
+
+	if(i == 0)
+	{
+		i = (unsigned int) ((uintptr_t) &ht_reader_hint >> 6);
+	}
+
+	for(;; i++)
+	{
+		ht_reader_slot_t *r = &cc->readers[i % HT_READER_SLOTS];
+
+		if(__atomic_load_n(&r->state,__ATOMIC_RELAXED) != 0)
+		{
+			continue;
+		}
+
+		uint64_t e = __atomic_load_n(&cc->epoch,__ATOMIC_SEQ_CST);
+		uint64_t expected = 0;
+
+		if(__atomic_compare_exchange_n(
+			&r->state,
+			&expected,
+			(e << 1) | 1,
+			0,
+			__ATOMIC_SEQ_CST,
+			__ATOMIC_RELAXED
+		))
+		{
+			ht_reader_hint = i % HT_READER_SLOTS + 1;
+			return r;
+		}
+	}
+}
+
+static
+inline
+void
+ht_cc_exit
+(
+	ht_reader_slot_t	*r
+)
+{
+	__atomic_store_n(&r->state,0,__ATOMIC_RELEASE);
+}
+
+static
+void
+ht_cc_free_retired
+(
+	ht_t		*ht,
+	ht_retired_t	*r
+)
+{
+	switch(r->kind)
+	{
+		case HT_RETIRE_ENTRY:
+			ht_v_destroy(r->p,ht);
+			break;
+		case HT_RETIRE_NODE:
+		case HT_RETIRE_TABLE:
+			free(r->p);
+			break;
+	}
+}
+
+////////////////////////////////////////
+//	move the epoch on if every active
+//		reader has seen the current one,
+//		then free whatever was retired
+//		two or more epochs ago
+//	- called with retire_lock held
+////////////////////////////////////////
+static
+void
+ht_cc_reclaim
+(
+	ht_t	*ht
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+	uint64_t e = __atomic_load_n(&cc->epoch,__ATOMIC_SEQ_CST);
+	int advance = 1;
+
+	for(size_t i = 0; i < HT_READER_SLOTS; i++)
+	{
+		uint64_t s = __atomic_load_n(&cc->readers[i].state,__ATOMIC_SEQ_CST);
+
+		if(s != 0 && (s >> 1) != e)
+		{
+			advance = 0;
+			break;
+		}
+	}
+
+	if(advance)
+	{
+		__atomic_compare_exchange_n(
+			&cc->epoch,
+			&e,
+			e + 1,
+			0,
+			__ATOMIC_SEQ_CST,
+			__ATOMIC_RELAXED
+		);
+	}
+
+	e = __atomic_load_n(&cc->epoch,__ATOMIC_SEQ_CST);
+
+	size_t kept = 0;
+	for(size_t i = 0; i < cc->retired_length; i++)
+	{
+		if(cc->retired[i].epoch + 2 <= e)
+		{
+			ht_cc_free_retired(ht,&cc->retired[i]);
+		}
+		else
+		{
+			cc->retired[kept++] = cc->retired[i];
+		}
+	}
+	cc->retired_length = kept;
+
+	////////////////////////////////////////
+	//	a stalled reader keeps everything
+	//		alive, so back off rather than
+	//		rescanning on every retire
+	////////////////////////////////////////
+	cc->retire_threshold = kept * 2 > HT_RETIRE_BATCH ? kept * 2 : HT_RETIRE_BATCH;
+}
+
+static
+void
+ht_cc_retire
+(
+	ht_t			*ht,
+	void			*p,
+	ht_retire_kind_t	 kind
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+
+	ht_lock(&cc->retire_lock);
+
+	if(cc->retired_length == cc->retired_size)
+	{
+		cc->retired_size = cc->retired_size ? cc->retired_size * 2 : HT_RETIRE_BATCH;
+		cc->retired = realloc(cc->retired,cc->retired_size * sizeof(ht_retired_t));
+	}
+
+	cc->retired[cc->retired_length++] = (ht_retired_t) {
+		.p = p,
+		.epoch = __atomic_load_n(&cc->epoch,__ATOMIC_SEQ_CST),
+		.kind = kind,
+	};
+
+	if(cc->retired_length >= cc->retire_threshold)
+	{
+		ht_cc_reclaim(ht);
+	}
+
+	ht_unlock(&cc->retire_lock);
+}
+
+////////////////////////////////////////
+//	free the table's concurrent state and
+//		everything still retired
+//	- no other thread may be using the
+//		table
+////////////////////////////////////////
+static
+void
+ht_cc_destroy
+(
+	ht_t	*ht
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+
+	for(size_t i = 0; i < cc->retired_length; i++)
+	{
+		ht_cc_free_retired(ht,&cc->retired[i]);
+	}
+
+	free(cc->retired);
+	free(cc->table);
+	free(cc);
+
+	ht->cc = 0;
+}
+
+////////////////////////////////////////
+//	lock-free lookup
+//	- must be called between ht_cc_enter
+//		and ht_cc_exit
+//	- a miss is only trusted if no resize
+//		started or finished during the walk
+////////////////////////////////////////
+static
+ht_entry_t *
+ht_cc_find
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	ht_concurrent_t *cc = ht->cc;
+
+	for(;;)
+	{
+		uint64_t s1 = __atomic_load_n(&cc->seq,__ATOMIC_ACQUIRE);
+		ht_cc_table_t *t = __atomic_load_n(&cc->table,__ATOMIC_ACQUIRE);
+		size_t i = ht_index_length(ht,hash,t->length);
+
+		ht_entry_t *v = __atomic_load_n(&t->buckets[i],__ATOMIC_ACQUIRE);
+		while(v)
+		{
+			HT_PROBE();
+
+			if(v->hash == hash
+				&& ht_key_equal(v->key,v->key_length,key,key_length,prefix))
+			{
+				HT_PROBES_END();
+				return v;
+			}
+			v = __atomic_load_n(&v->next,__ATOMIC_ACQUIRE);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		uint64_t s2 = __atomic_load_n(&cc->seq,__ATOMIC_RELAXED);
+
+		if(s1 == s2 && (s1 & 1) == 0)
+		{
+			HT_PROBES_END();
+			return 0;
+		}
+
+		HT_CPU_RELAX();
+	}
+}
+
+////////////////////////////////////////
+//	lock the stripe of the bucket the hash
+//		falls in
+//	- retried if a resize swapped the
+//		bucket array before the lock was
+//		taken
+////////////////////////////////////////
+static
+ht_cc_table_t *
+ht_cc_lock_bucket
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	size_t		*index
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+
+	for(;;)
+	{
+		ht_cc_table_t *t = __atomic_load_n(&cc->table,__ATOMIC_ACQUIRE);
+		size_t i = ht_index_length(ht,hash,t->length);
+
+		ht_lock(&cc->stripes[i % HT_LOCK_STRIPES]);
+
+		if(__atomic_load_n(&cc->table,__ATOMIC_ACQUIRE) == t)
+		{
+			*index = i;
+			return t;
+		}
+
+		ht_unlock(&cc->stripes[i % HT_LOCK_STRIPES]);
+	}
+}
+
+static
+inline
+void
+ht_cc_unlock_bucket
+(
+	ht_t	*ht,
+	size_t	 index
+)
+{
+	ht_unlock(&ht->cc->stripes[index % HT_LOCK_STRIPES]);
+}
+
+static
+void
+ht_cc_lock_all
+(
+	ht_concurrent_t	*cc
+)
+{
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++)
+	{
+		ht_lock(&cc->stripes[i]);
+	}
+}
+
+static
+void
+ht_cc_unlock_all
+(
+	ht_concurrent_t	*cc
+)
+{
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++)
+	{
+		ht_unlock(&cc->stripes[i]);
+	}
+}
+
+////////////////////////////////////////
+//	relink every entry into a new bucket
+//		array with all stripes locked
+//	- skipped if the bucket array is no
+//		longer expected_length long,
+//		another writer got there first
+//	- expected_length of 0 always resizes
+////////////////////////////////////////
+static
+void
+ht_cc_resize
+(
+	ht_t	*ht,
+	size_t	 expected_length,
+	size_t	 table_length
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+
+	ht_cc_lock_all(cc);
+
+	ht_cc_table_t *ot = cc->table;
+
+	if(expected_length != 0 && ot->length != expected_length)
+	{
+		ht_cc_unlock_all(cc);
+		return;
+	}
+
+	HT_RESIZE_BEGIN(ot->length,table_length);
+
+	ht_cc_table_t *nt = calloc(1,sizeof(ht_cc_table_t) + table_length * sizeof(ht_entry_t *));
+	nt->length = table_length;
+
+	__atomic_add_fetch(&cc->seq,1,__ATOMIC_SEQ_CST);
+
+	for(size_t i = 0; i < ot->length; i++)
+	{
+		ht_entry_t *data = ot->buckets[i];
+
+		while(data)
+		{
+			ht_entry_t *next = data->next;
+
+			size_t index = ht_index_length(ht,data->hash,table_length);
+			__atomic_store_n(&data->next,nt->buckets[index],__ATOMIC_RELEASE);
+			nt->buckets[index] = data;
+
+			data = next;
+		}
+	}
+
+	__atomic_store_n(&cc->table,nt,__ATOMIC_RELEASE);
+	__atomic_add_fetch(&cc->seq,1,__ATOMIC_SEQ_CST);
+
+	ht->table_length = table_length;
+
+	ht_cc_unlock_all(cc);
+
+	ht_cc_retire(ht,ot,HT_RETIRE_TABLE);
+
+	HT_RESIZE_END(table_length);
+}
+
+////////////////////////////////////////
+//	add or update under the bucket's
+//		stripe lock
+//	- mode 0 adds, 1 updates, 2 updates
+//		strictly
+////////////////////////////////////////
+static
+ht_status_t
+ht_cc_put
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix,
+	int		 mode
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+	ht_reader_slot_t *r = ht_cc_enter(cc);
+
+	size_t i;
+	ht_cc_table_t *t = ht_cc_lock_bucket(ht,hash,&i);
+	size_t l = t->length;
+
+	ht_entry_t **link = ht_v_find_link(&t->buckets[i],hash,key,key_length,prefix);
+
+	if(link != 0)
+	{
+		if(mode == 0)
+		{
+			ht_cc_unlock_bucket(ht,i);
+			ht_cc_exit(r);
+			return HT_KEY_ALREADY_IN_USE;
+		}
+
+		ht_entry_t *old = *link;
+		ht_entry_t *v = malloc(sizeof(ht_entry_t));
+		*v = *old;
+		v->value = value;
+		v->value_length = value_length;
+
+		__atomic_store_n(link,v,__ATOMIC_RELEASE);
+
+		ht_cc_unlock_bucket(ht,i);
+		ht_cc_exit(r);
+
+		ht_cc_retire(ht,old,HT_RETIRE_NODE);
+
+		return HT_SUCCESS;
+	}
+
+	if(mode == 2)
+	{
+		ht_cc_unlock_bucket(ht,i);
+		ht_cc_exit(r);
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	ht_entry_t *v = ht_v_create(ht,hash,value,value_length,key,key_length,prefix);
+	v->next = t->buckets[i];
+	__atomic_store_n(&t->buckets[i],v,__ATOMIC_RELEASE);
+
+	ht_cc_unlock_bucket(ht,i);
+	ht_cc_exit(r);
+
+	size_t n = __atomic_add_fetch(&ht->num_of_entries,1,__ATOMIC_RELAXED);
+
+	if(ht->max_load_factor > 0 && n > ht->max_load_factor * l)
+	{
+		ht_cc_resize(ht,l,l * 2);
+	}
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////
+//	UPSERTS
+//	- what ht_get_or_insert and
+//		ht_upsert do with a key in use,
+//		and where the stored value goes
+////////////////////////////////////////
+typedef struct
+{
+	void		(*merge)(void **,size_t *,void *);
+	void		 *context;
+	void		**destination;
+	size_t		 *destination_length;
+	int		 *inserted;
+} ht_upsert_t;
+
+static
+inline
+void
+ht_upsert_out
+(
+	ht_upsert_t	*u,
+	void		*value,
+	size_t		 value_length,
+	int		 inserted
+)
+{
+	if(u->destination != 0)
+	{
+		*u->destination = value;
+		*u->destination_length = value_length;
+	}
+
+	if(u->inserted != 0)
+	{
+		*u->inserted = inserted;
+	}
+}
+
+////////////////////////////////////////
+//	merges replace the entry, as
+//		ht_cc_put does, so readers see
+//		the old value or the merged one
+////////////////////////////////////////
+static
+ht_status_t
+ht_cc_upsert
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix,
+	ht_upsert_t	*u
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+	ht_reader_slot_t *r = ht_cc_enter(cc);
+
+	size_t i;
+	ht_cc_table_t *t = ht_cc_lock_bucket(ht,hash,&i);
+	size_t l = t->length;
+
+	ht_entry_t **link = ht_v_find_link(&t->buckets[i],hash,key,key_length,prefix);
+
+	if(link != 0)
+	{
+		ht_entry_t *old = *link;
+
+		if(u->merge == 0)
+		{
+			ht_upsert_out(u,old->value,old->value_length,0);
+
+			ht_cc_unlock_bucket(ht,i);
+			ht_cc_exit(r);
+			return HT_SUCCESS;
+		}
+
+		ht_entry_t *v = malloc(sizeof(ht_entry_t));
+		*v = *old;
+		u->merge(&v->value,&v->value_length,u->context);
+
+		__atomic_store_n(link,v,__ATOMIC_RELEASE);
+
+		ht_upsert_out(u,v->value,v->value_length,0);
+
+		ht_cc_unlock_bucket(ht,i);
+		ht_cc_exit(r);
+
+		ht_cc_retire(ht,old,HT_RETIRE_NODE);
+
+		return HT_SUCCESS;
+	}
+
+	ht_entry_t *v = ht_v_create(ht,hash,value,value_length,key,key_length,prefix);
+	v->next = t->buckets[i];
+	__atomic_store_n(&t->buckets[i],v,__ATOMIC_RELEASE);
+
+	ht_upsert_out(u,v->value,v->value_length,1);
+
+	ht_cc_unlock_bucket(ht,i);
+	ht_cc_exit(r);
+
+	size_t n = __atomic_add_fetch(&ht->num_of_entries,1,__ATOMIC_RELAXED);
+
+	if(ht->max_load_factor > 0 && n > ht->max_load_factor * l)
+	{
+		ht_cc_resize(ht,l,l * 2);
+	}
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_cc_remove
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+	ht_reader_slot_t *r = ht_cc_enter(cc);
+
+	size_t i;
+	ht_cc_table_t *t = ht_cc_lock_bucket(ht,hash,&i);
+	size_t l = t->length;
+
+	ht_entry_t **link = ht_v_find_link(&t->buckets[i],hash,key,key_length,prefix);
+
+	if(link == 0)
+	{
+		ht_cc_unlock_bucket(ht,i);
+		ht_cc_exit(r);
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	ht_entry_t *data = *link;
+	__atomic_store_n(link,data->next,__ATOMIC_RELEASE);
+
+	ht_cc_unlock_bucket(ht,i);
+	ht_cc_exit(r);
+
+	ht_cc_retire(ht,data,HT_RETIRE_ENTRY);
+
+	size_t n = __atomic_sub_fetch(&ht->num_of_entries,1,__ATOMIC_RELAXED);
+
+	if(ht->min_load_factor > 0
+		&& l / 2 >= ht->min_table_length
+		&& n < ht->min_load_factor * l)
+	{
+		ht_cc_resize(ht,l,l / 2);
+	}
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////
+//	unlink and retire every entry with
+//		all stripes locked
+////////////////////////////////////////
+static
+void
+ht_cc_clear
+(
+	ht_t	*ht
+)
+{
+	ht_concurrent_t *cc = ht->cc;
+
+	ht_cc_lock_all(cc);
+
+	ht_cc_table_t *t = cc->table;
+
+	for(size_t i = 0; i < t->length; i++)
+	{
+		ht_entry_t *data = t->buckets[i];
+
+		__atomic_store_n(&t->buckets[i],0,__ATOMIC_RELEASE);
+
+		while(data)
+		{
+			ht_entry_t *next = data->next;
+
+			ht_cc_retire(ht,data,HT_RETIRE_ENTRY);
+
+			data = next;
+		}
+	}
+
+	__atomic_store_n(&ht->num_of_entries,0,__ATOMIC_RELAXED);
+
+	ht_cc_unlock_all(cc);
+}
+
+////////////////////////////////////////
+//	WALKING ENTRIES
+//	- calls function on every entry of
+//		any layout, with its stored hash
+//		word and a context
+////////////////////////////////////////
+typedef void (*ht_walk_function_t)
+	(
+		uint64_t	 hash,
+		void		*value,
+		size_t		 value_length,
+		void		*key,
+		size_t		 key_length,
+		void		*context
+	);
+
+static
+void
+ht_walk_chain
+(
+	ht_entry_t		*data,
+	ht_walk_function_t	 function,
+	void			*context
+)
+{
+	while(data)
+	{
+		function(data->hash,data->value,data->value_length,data->key,data->key_length,context);
+		data = __atomic_load_n(&data->next,__ATOMIC_ACQUIRE);
+	}
+}
+
+static
+void
+ht_walk
+(
+	ht_t			*ht,
+	ht_walk_function_t	 function,
+	void			*context
+);
+
+////////////////////////////////////////
+//	MAPPED SNAPSHOTS
+//	- a snapshot is a header, then the
+//		first record of each bucket,
+//		then the records bucket by
+//		bucket, then the keys and values
+//	- everything is found by its offset
+//		from the start of the file, so
+//		the file can be mapped anywhere
+//	- buckets are picked with the low
+//		bits of the stored hash word
+//	- keys and values start on 8 byte
+//		boundaries
+//	- numbers are in the byte order of
+//		the machine that saved them
+////////////////////////////////////////
+#define HT_SNAPSHOT_MAGIC	"htsnap\0\0"
+#define HT_SNAPSHOT_VERSION	2
+#define HT_SNAPSHOT_BYTE_ORDER	0x01020304
+#define HT_SNAPSHOT_NAME_LENGTH	32
+
+typedef struct
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	byte_order;
+	uint32_t	hash_size;
+	uint32_t	reserved;
+	ht_seed_t	seed;
+	char		hash_function[HT_SNAPSHOT_NAME_LENGTH];
+	uint64_t	table_length;
+	uint64_t	num_of_entries;
+	uint64_t	buckets;
+	uint64_t	records;
+	uint64_t	file_length;
+} ht_snapshot_header_t;
+
+typedef struct
+{
+	uint64_t	hash;
+	uint64_t	key;
+	uint64_t	key_length;
+	uint64_t	value;
+	uint64_t	value_length;
+} ht_snapshot_record_t;
+
+struct ht_map_t
+{
+	uint8_t				*base;
+	size_t				 length;
+	const uint64_t			*buckets;
+	const ht_snapshot_record_t	*records;
+};
+
+static
+inline
+size_t
+ht_snapshot_align
+(
+	size_t	n
+)
+{
+	return (n + 7) & ~(size_t) 7;
+}
+
+static
+const ht_snapshot_record_t *
+ht_map_find
+(
+	ht_t		*ht,
+	uint64_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	HT_PROBES_BEGIN();
+
+	ht_map_t *m = ht->map;
+	size_t b = ht_index(ht,hash);
+
+	for(uint64_t r = m->buckets[b]; r < m->buckets[b + 1]; r++)
+	{
+		const ht_snapshot_record_t *record = &m->records[r];
+
+		HT_PROBE();
+
+		if(record->hash == hash
+			&& ht_key_equal(m->base + record->key,record->key_length,key,key_length,prefix))
+		{
+			HT_PROBES_END();
+			return record;
+		}
+	}
+
+	HT_PROBES_END();
+	return 0;
+}
+
+static
+void
+ht_map_walk
+(
+	ht_t			*ht,
+	ht_walk_function_t	 function,
+	void			*context
+)
+{
+	ht_map_t *m = ht->map;
+
+	for(size_t i = 0; i < ht->num_of_entries; i++)
+	{
+		const ht_snapshot_record_t *record = &m->records[i];
+
+		function(
+			record->hash,
+			m->base + record->value,
+			record->value_length,
+			m->base + record->key,
+			record->key_length,
+			context
+		);
+	}
+}
+
+static
+void
+ht_walk
+(
+	ht_t			*ht,
+	ht_walk_function_t	 function,
+	void			*context
+)
+{
+	if(ht->map != 0)
+	{
+		ht_map_walk(ht,function,context);
+		return;
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		for(size_t i = 0; i < ht->table_length; i++)
+		{
+			if(!(ht->control[i] & HT_CTRL_EMPTY))
+			{
+				ht_slot_t *s = &ht->slots[i];
+				function(s->hash,s->value,s->value_length,s->key,s->key_length,context);
+			}
+		}
+		return;
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_reader_slot_t *r = ht_cc_enter(ht->cc);
+		ht_cc_table_t *t = __atomic_load_n(&ht->cc->table,__ATOMIC_ACQUIRE);
+
+		for(size_t i = 0; i < t->length; i++)
+		{
+			ht_walk_chain(__atomic_load_n(&t->buckets[i],__ATOMIC_ACQUIRE),function,context);
+		}
+
+		ht_cc_exit(r);
+		return;
+	}
+
+	if(ht->old_table != 0)
+	{
+		for(size_t i = ht->rehash_index; i < ht->old_table_length; i++)
+		{
+			ht_walk_chain(ht->old_table[i],function,context);
+		}
+	}
+
+	for(size_t i = 0; i < ht->table_length; i++)
+	{
+		ht_walk_chain(ht->table[i],function,context);
+	}
+}
+
+typedef struct
+{
+	uint64_t	 hash;
+	void		*value;
+	size_t		 value_length;
+	void		*key;
+	size_t		 key_length;
+} ht_snapshot_item_t;
+
+typedef struct
+{
+	ht_snapshot_item_t	*items;
+	size_t			 length;
+	size_t			 size;
+} ht_snapshot_items_t;
+
+static
+void
+ht_snapshot_collect
+(
+	uint64_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	void		*key,
+	size_t		 key_length,
+	void		*context
+)
+{
+	ht_snapshot_items_t *v = context;
+
+	if(v->length == v->size)
+	{
+		v->size = v->size ? v->size * 2 : 1024;
+		v->items = realloc(v->items,v->size * sizeof(ht_snapshot_item_t));
+	}
+
+	v->items[v->length++] = (ht_snapshot_item_t) {
+		.hash		= hash,
+		.value		= value,
+		.value_length	= value_length,
+		.key		= key,
+		.key_length	= key_length,
+	};
+}
+
+static
+int
+ht_snapshot_pad
+(
+	FILE	*f,
+	size_t	 length
+)
+{
+	static const uint8_t zeros[8] = {0};
+	size_t p = ht_snapshot_align(length) - length;
+
+	return p == 0 || fwrite(zeros,1,p,f) == p;
+}
+
+////////////////////////////////////////
+//	write the snapshot of the collected
+//		entries
+//	- records are sorted by bucket with
+//		a counting sort
+//	- returns 0 on a write error
+////////////////////////////////////////
+static
+int
+ht_snapshot_write
+(
+	ht_t			*ht,
+	ht_snapshot_items_t	*v,
+	FILE			*f
+)
+{
+	size_t n = v->length;
+	size_t l = ht_round_up_pow2(n ? n : 1);
+	size_t mask = l - 1;
+
+	uint64_t *buckets = calloc(l + 1,sizeof(uint64_t));
+	size_t *order = malloc((n ? n : 1) * sizeof(size_t));
+
+	for(size_t i = 0; i < n; i++)
+	{
+		buckets[(v->items[i].hash & mask) + 1]++;
+	}
+
+	for(size_t b = 0; b < l; b++)
+	{
+		buckets[b + 1] += buckets[b];
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		size_t b = v->items[i].hash & mask;
+		order[buckets[b]++] = i;
+	}
+
+	for(size_t b = l; b > 0; b--)
+	{
+		buckets[b] = buckets[b - 1];
+	}
+	buckets[0] = 0;
+
+	ht_snapshot_header_t h = {
+		.version	= HT_SNAPSHOT_VERSION,
+		.byte_order	= HT_SNAPSHOT_BYTE_ORDER,
+		.hash_size	= ht->hash_size,
+		.seed		= ht->seed,
+		.table_length	= l,
+		.num_of_entries	= n,
+	};
+
+	memcpy(h.magic,HT_SNAPSHOT_MAGIC,sizeof(h.magic));
+	strncpy(h.hash_function,ht->hash_function->name,HT_SNAPSHOT_NAME_LENGTH - 1);
+
+	h.buckets = ht_snapshot_align(sizeof(h));
+	h.records = h.buckets + (l + 1) * sizeof(uint64_t);
+
+	uint64_t data = h.records + n * sizeof(ht_snapshot_record_t);
+	uint64_t offset = data;
+
+	for(size_t i = 0; i < n; i++)
+	{
+		offset += ht_snapshot_align(v->items[i].key_length);
+		offset += ht_snapshot_align(v->items[i].value_length);
+	}
+
+	h.file_length = offset;
+
+	int ok = fwrite(&h,sizeof(h),1,f) == 1
+		&& ht_snapshot_pad(f,sizeof(h))
+		&& fwrite(buckets,sizeof(uint64_t),l + 1,f) == l + 1;
+
+	offset = data;
+
+	for(size_t i = 0; ok && i < n; i++)
+	{
+		ht_snapshot_item_t *item = &v->items[order[i]];
+		ht_snapshot_record_t r = {
+			.hash		= item->hash,
+			.key		= offset,
+			.key_length	= item->key_length,
+			.value		= offset + ht_snapshot_align(item->key_length),
+			.value_length	= item->value_length,
+		};
+
+		offset = r.value + ht_snapshot_align(item->value_length);
+
+		ok = fwrite(&r,sizeof(r),1,f) == 1;
+	}
+
+	for(size_t i = 0; ok && i < n; i++)
+	{
+		ht_snapshot_item_t *item = &v->items[order[i]];
+
+		ok = fwrite(item->key,1,item->key_length,f) == item->key_length
+			&& ht_snapshot_pad(f,item->key_length)
+			&& fwrite(item->value,1,item->value_length,f) == item->value_length
+			&& ht_snapshot_pad(f,item->value_length);
+	}
+
+	free(buckets);
+	free(order);
+
+	return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	CREATION AND DESTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+ht_t *
+ht_create
+(
+	size_t		table_length,
+	ht_hash_size_t	hash_size,
+	ht_seed_t	seed
+)
+{
+	return ht_create_full(table_length,hash_size,seed,0,ht_vacuous_free,free);
+}
+
+ht_t *
+ht_create_full
+(
+	size_t		table_length,
+	ht_hash_size_t	hash_size,
+	ht_seed_t	seed,
+	void		*extra,
+	void		(*destroy_value)
+			(
+				void	*data,
+				void	*extra
+			),
+	void		(*destroy_extra)
+			(
+				void	*extra
+			)
+)
+{
+	return ht_create_with_options(
+		table_length,
+		hash_size,
+		seed,
+		extra,
+		destroy_value,
+		destroy_extra,
+		0
+	);
+}
+
+ht_t *
+ht_create_with_options
+(
+	size_t			 table_length,
+	ht_hash_size_t		 hash_size,
+	ht_seed_t		 seed,
+	void			*extra,
+	void			(*destroy_value)
+				(
+					void	*data,
+					void	*extra
+				),
+	void			(*destroy_extra)
+				(
+					void	*extra
+				),
+	const ht_options_t	*options
+)
+{
+	if(table_length <= 0)
+	{
+		return 0;
+	}
+
+	ht_options_t o = {0};
+	if(options != 0)
+	{
+		o = *options;
+	}
+
+	////////////////////////////////////////
+	//	growing must leave the table over
+	//		the minimum load factor or it
+	//		would shrink straight back
+	////////////////////////////////////////
+	if(o.max_load_factor > 0
+		&& o.min_load_factor > 0
+		&& o.min_load_factor * 2 >= o.max_load_factor)
+	{
+		return 0;
+	}
+
+	if(o.index_mode == HT_INDEX_MASK)
+	{
+		table_length = ht_round_up_pow2(table_length);
+	}
+
+	if(o.hash_function == 0)
+	{
+		o.hash_function = &ht_hash_spookyhash;
+	}
+
+	////////////////////////////////////////
+	//	concurrent tables are chained, with
+	//		entries freed one by one once
+	//		readers are done with them
+	////////////////////////////////////////
+	if(o.concurrent)
+	{
+		if(o.layout != HT_LAYOUT_CHAINED)
+		{
+			return 0;
+		}
+		o.inline_key_length = 0;
+	}
+
+	if((o.namespaces || o.own_values || o.max_chain_length)
+		&& (o.layout != HT_LAYOUT_CHAINED || o.concurrent))
+	{
+		return 0;
+	}
+
+	////////////////////////////////////////
+	//	cuckoo buckets come from the two
+	//		words of a 128 bit hash
+	////////////////////////////////////////
+	if(o.layout == HT_LAYOUT_CUCKOO && hash_size != HT_HASH_SIZE_128)
+	{
+		return 0;
+	}
+
+	if(!o.own_values)
+	{
+		o.inline_value_length = 0;
+	}
+
+	////////////////////////////////////////
+	//	the namespace link goes after the
+	//		inline key, on a pointer
+	//		boundary, and inline values
+	//		after that
+	////////////////////////////////////////
+	size_t node_size = sizeof(ht_entry_t) + o.inline_key_length;
+	size_t namespace_link = 0;
+
+	if(o.namespaces)
+	{
+		namespace_link = (node_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+		node_size = namespace_link + sizeof(ht_ns_link_t);
+	}
+
+	size_t value_inline = (node_size + 7) & ~(size_t) 7;
+
+	if(o.inline_value_length != 0)
+	{
+		node_size = value_inline + o.inline_value_length;
+	}
+
+	ht_t *h = malloc(sizeof(ht_t));
+
+	*h = (ht_t) {
+		.layout			= o.layout,
+		.min_table_length	= table_length,
+		.max_load_factor	= o.max_load_factor,
+		.min_load_factor	= o.min_load_factor,
+		.table_length		= table_length,
+		.hash_size		= hash_size,
+		.hash_bits		= ht_hash_bits(hash_size),
+		.index_mode		= o.index_mode,
+		.index_shift		= 64 - ht_hash_bits(hash_size),
+		.inline_key_length	= o.inline_key_length,
+		.node_size		= node_size,
+		.namespace_link		= namespace_link,
+		.own_values		= o.own_values,
+		.inline_value_length	= o.inline_value_length,
+		.value_inline		= value_inline,
+		.max_chain_length	= o.max_chain_length,
+		.seed			= seed,
+		.hash_function		= o.hash_function,
+		.num_of_entries		= 0,
+		.extra			= extra,
+		.destroy_value		= destroy_value,
+		.destroy_extra		= destroy_extra,
+	};
+
+	if(h->layout == HT_LAYOUT_OPEN)
+	{
+		ht_oa_allocate(h,ht_oa_capacity(table_length));
+		return h;
+	}
+
+	if(h->layout == HT_LAYOUT_CUCKOO)
+	{
+		ht_ck_allocate(h,ht_ck_buckets_for(table_length),HT_CUCKOO_STASH);
+		return h;
+	}
+
+	if(o.concurrent)
+	{
+		h->cc = ht_cc_create(table_length);
+		return h;
+	}
+
+	h->table = malloc(table_length * sizeof(ht_entry_t *));
+
+	for(int i = 0; i < table_length; i++)
+	{
+		h->table[i] = 0;
+	}
+
+	return h;
+}
+
+////////////////////////////////////////
+//	free everything but the entries
+//	- retired entries go before extra,
+//		destroy_value may still need it
+////////////////////////////////////////
+static
+void
+ht_destroy_storage
+(
+	ht_t	*ht
+)
+{
+	if(ht->cc != 0)
+	{
+		ht_cc_destroy(ht);
+	}
+
+	if(ht->extra)
+	{
+		if(ht->destroy_extra)
+		{
+			ht->destroy_extra(ht->extra);
+		}
+	}
+
+	if(ht->map != 0)
+	{
+		munmap(ht->map->base,ht->map->length);
+		free(ht->map);
+	}
+
+	free(ht->table);
+	free(ht->old_table);
+	free(ht->control);
+	free(ht->slots);
+	free(ht->alternates);
+	free(ht->namespaces);
+
+	free(ht);
+}
+
+void
+ht_destroy
+(
+	ht_t	*ht
+)
+{
+	if(ht == 0)
+	{
+		return;
+	}
+
+	if(ht->map == 0)
+	{
+		ht_clear_table(ht);
+	}
+
+	ht_destroy_storage(ht);
+}
+
+void
+ht_parallel_destroy
+(
+	ht_t		*ht,
+	unsigned int	 threads
+)
+{
+	if(ht == 0)
+	{
+		return;
+	}
+
+	if(ht->map == 0)
+	{
+		ht_parallel_clear_table(ht,threads);
+	}
+
+	ht_destroy_storage(ht);
+}
+
+
+////////////////////////////////////////
+//	OPERATIONS ON A HASHED KEY
+//	- shared by the single key and batch
+//		entry points
+////////////////////////////////////////
+static
+ht_status_t
+ht_add_hashed
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		return ht_cc_put(ht,hash.word,value,value_length,key,key_length,prefix,0);
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		if(ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix) != HT_NO_SLOT)
+		{
+			return HT_KEY_ALREADY_IN_USE;
+		}
+
+		ht_slot_insert(ht,hash.h128[0],hash.word,value,value_length,key,key_length,prefix);
+
+		return HT_SUCCESS;
+	}
+
+	uint64_t w = hash.word;
+
+	ht_entry_t *data = ht_v_lookup(ht,w,key,key_length,prefix);
+
+	if(data != 0)
+	{
+		return HT_KEY_ALREADY_IN_USE;
+	}
+
+	ht_v_grow(ht);
+
+	ht_entry_t *v = ht_v_create(ht,w,value,value_length,key,key_length,prefix);
+
+	ht_v_append(ht,ht_index(ht,w),v);
+	ht->num_of_entries++;
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_update_hashed
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		return ht_cc_put(ht,hash.word,value,value_length,key,key_length,prefix,1);
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			ht_slot_insert(ht,hash.h128[0],hash.word,value,value_length,key,key_length,prefix);
+		}
+		else
+		{
+			ht->slots[i].value = value;
+			ht->slots[i].value_length = value_length;
+		}
+
+		return HT_SUCCESS;
+	}
+
+	uint64_t w = hash.word;
+
+	ht_entry_t *data = ht_v_lookup(ht,w,key,key_length,prefix);
+
+	if(data == 0)
+	{
+		ht_v_grow(ht);
+
+		ht_entry_t *v = ht_v_create(ht,w,value,value_length,key,key_length,prefix);
+		ht_v_append(ht,ht_index(ht,w),v);
+		ht->num_of_entries++;
+	}
+	else
+	{
+		ht_v_set_value(ht,data,value,value_length,0);
+	}
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_update_strict_hashed
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		return ht_cc_put(ht,hash.word,value,value_length,key,key_length,prefix,2);
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		ht->slots[i].value = value;
+		ht->slots[i].value_length = value_length;
+
+		return HT_SUCCESS;
+	}
+
+	uint64_t w = hash.word;
+
+	ht_entry_t *data = ht_v_lookup(ht,w,key,key_length,prefix);
+
+	if(data == 0)
+	{
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	ht_v_set_value(ht,data,value,value_length,0);
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_upsert_hashed
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix,
+	ht_upsert_t	*u
+)
+{
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		return ht_cc_upsert(ht,hash.word,value,value_length,key,key_length,prefix,u);
+	}
+
+	uint64_t w = hash.word;
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			i = ht_slot_insert(ht,hash.h128[0],hash.word,value,value_length,key,key_length,prefix);
+			ht_upsert_out(u,ht->slots[i].value,ht->slots[i].value_length,1);
+
+			return HT_SUCCESS;
+		}
+
+		ht_slot_t *slot = &ht->slots[i];
+
+		if(u->merge != 0)
+		{
+			u->merge(&slot->value,&slot->value_length,u->context);
+		}
+
+		ht_upsert_out(u,slot->value,slot->value_length,0);
+
+		return HT_SUCCESS;
+	}
+
+	ht_entry_t *data = ht_v_lookup(ht,w,key,key_length,prefix);
+
+	if(data == 0)
+	{
+		ht_v_grow(ht);
+
+		data = ht_v_create(ht,w,value,value_length,key,key_length,prefix);
+		ht_v_append(ht,ht_index(ht,w),data);
+		ht->num_of_entries++;
+
+		ht_upsert_out(u,data->value,data->value_length,1);
+
+		return HT_SUCCESS;
+	}
+
+	if(u->merge != 0)
+	{
+		////////////////////////////////////////
+		//	owned values only change through
+		//		ht_v_set_value, which copies
+		//		a new pointer or length in
+		////////////////////////////////////////
+		void *merged = data->value;
+		size_t merged_length = data->value_length;
+
+		u->merge(&merged,&merged_length,u->context);
+
+		if(merged != data->value || merged_length != data->value_length)
+		{
+			ht_v_set_value(ht,data,merged,merged_length,0);
+		}
+	}
+
+	ht_upsert_out(u,data->value,data->value_length,0);
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_get_hashed
+(
+	ht_t		 *ht,
+	ht_hash_t	  hash,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *value_length,
+	ht_prefix	 *prefix
+)
+{
+	if(ht->map != 0)
+	{
+		const ht_snapshot_record_t *record = ht_map_find(ht,hash.word,key,key_length,prefix);
+
+		if(record == 0)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		if(destination != 0)
+		{
+			*destination = ht->map->base + record->value;
+			*value_length = record->value_length;
+		}
+
+		return HT_SUCCESS;
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_reader_slot_t *r = ht_cc_enter(ht->cc);
+		ht_entry_t *data = ht_cc_find(ht,hash.word,key,key_length,prefix);
+
+		if(data != 0 && destination != 0)
+		{
+			*destination = data->value;
+			*value_length = data->value_length;
+		}
+
+		ht_cc_exit(r);
+
+		return data ? HT_SUCCESS : HT_KEY_NOT_IN_USE;
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		if(destination != 0)
+		{
+			*destination = ht->slots[i].value;
+			*value_length = ht->slots[i].value_length;
+		}
+
+		return HT_SUCCESS;
+	}
+
+	uint64_t w = hash.word;
+
+	ht_entry_t *data = ht_v_lookup(ht,w,key,key_length,prefix);
+
+	if(data == 0)
+	{
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	if(destination != 0)
+	{
+		*destination = data->value;
+		*value_length = data->value_length;
+	}
+
+	return HT_SUCCESS;
+}
+
+static
+ht_status_t
+ht_remove_hashed
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		return ht_cc_remove(ht,hash.word,key,key_length,prefix);
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		ht_slot_erase(ht,i);
+
+		return HT_SUCCESS;
+	}
+
+	uint64_t w = hash.word;
+
+	ht_entry_t **link = ht_v_lookup_link(ht,w,key,key_length,prefix);
+
+	if(link == 0)
+	{
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	ht_entry_t *data = *link;
+
+	*link = data->next;
+
+	if(ht->namespace_link != 0)
+	{
+		ht_ns_unlink(ht,data);
+	}
+
+	ht_v_destroy(data,ht);
+
+	ht->num_of_entries--;
+
+	ht_v_shrink(ht);
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////
+//	BATCHES
+//	- keys are hashed HT_BATCH at a time,
+//		then their bucket slots, first
+//		entries and first keys are
+//		prefetched in turn, so the misses
+//		of the whole batch overlap before
+//		any key is compared
+////////////////////////////////////////
+#define HT_BATCH	16
+
+static
+void
+ht_prefetch_batch
+(
+	ht_t		*ht,
+	ht_hash_t	*hashes,
+	size_t		 n
+)
+{
+	if(ht->cc != 0)
+	{
+		return;
+	}
+
+	if(ht->map != 0)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			__builtin_prefetch(&ht->map->buckets[ht_index(ht,hashes[i].word)]);
+		}
+		return;
+	}
+
+	if(ht->layout == HT_LAYOUT_OPEN)
+	{
+		size_t groups_mask = ht->table_length / HT_GROUP_WIDTH - 1;
+
+		for(size_t i = 0; i < n; i++)
+		{
+			size_t g = (hashes[i].word & groups_mask) * HT_GROUP_WIDTH;
+			__builtin_prefetch(ht->control + g);
+			__builtin_prefetch(ht->slots + g);
+		}
+		return;
+	}
+
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		size_t mask = ht_ck_buckets(ht) - 1;
+
+		for(size_t i = 0; i < n; i++)
+		{
+			__builtin_prefetch(ht->control + (hashes[i].h128[0] & mask) * HT_CUCKOO_WAYS);
+			__builtin_prefetch(ht->control + (hashes[i].h128[1] & mask) * HT_CUCKOO_WAYS);
+		}
+		return;
+	}
+
+	ht_entry_t *heads[HT_BATCH];
+
+	for(size_t i = 0; i < n; i++)
+	{
+		__builtin_prefetch(&ht->table[ht_index(ht,hashes[i].word)]);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		heads[i] = ht->table[ht_index(ht,hashes[i].word)];
+		if(heads[i] != 0)
+		{
+			__builtin_prefetch(heads[i]);
+		}
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		if(heads[i] != 0 && heads[i]->hash == hashes[i].word)
+		{
+			__builtin_prefetch(heads[i]->key);
+		}
+	}
+}
+
+////////////////////////////////////////
+//	keys under HT_SPOOKY_SHORT bytes are
+//		gathered by length and hashed
+//		HT_SPOOKY_LANES at a time
+//	- prefixed keys, long keys and other
+//		hash functions go through ht_hash
+//		one by one
+////////////////////////////////////////
+static
+void
+ht_hash_batch
+(
+	ht_t		 *ht,
+	const void	**keys,
+	const size_t	 *key_lengths,
+	size_t		  n,
+	ht_prefix	 *prefix,
+	ht_hash_t	 *hashes
+)
+{
+	uint8_t done[HT_BATCH] = {0};
+	uint64_t seed1;
+	uint64_t seed2;
+
+	ht_hash_seeds(ht,&seed1,&seed2);
+
+	for(size_t i = 0; i < n; i++)
+	{
+		if(done[i])
+		{
+			continue;
+		}
+
+		if(keys[i] == 0)
+		{
+			hashes[i].word = 0;
+			continue;
+		}
+
+		if(prefix != 0
+			|| key_lengths[i] >= HT_SPOOKY_SHORT
+			|| ht->hash_function != &ht_hash_spookyhash)
+		{
+			hashes[i] = ht_hash(ht,(uint8_t *)keys[i],key_lengths[i],prefix);
+			continue;
+		}
+
+		const uint8_t *group[HT_SPOOKY_LANES];
+		size_t index[HT_SPOOKY_LANES];
+		size_t g = 0;
+
+		for(size_t j = i; j < n && g < HT_SPOOKY_LANES; j++)
+		{
+			if(!done[j] && keys[j] != 0 && key_lengths[j] == key_lengths[i])
+			{
+				group[g] = keys[j];
+				index[g++] = j;
+				done[j] = 1;
+			}
+		}
+
+		uint64_t h1[HT_SPOOKY_LANES];
+		uint64_t h2[HT_SPOOKY_LANES];
+
+		ht_spooky_short_many(group,g,key_lengths[i],seed1,seed2,h1,h2);
+
+		for(size_t k = 0; k < g; k++)
+		{
+			hashes[index[k]] = ht_hash_words(ht,h1[k],h2[k]);
+		}
+	}
+}
+
+////////////////////////////////////////
+//	THREADS
+//	- runs function(context,i) for i in
+//		[0,threads), i = 0 on the calling
+//		thread
+//	- falls back to fewer threads if some
+//		cannot be started
+////////////////////////////////////////
+typedef void (*ht_parallel_function_t)
+	(
+		void		*context,
+		unsigned int	 index
+	);
+
+typedef struct
+{
+	ht_parallel_function_t	 function;
+	void			*context;
+	unsigned int		 index;
+} ht_parallel_task_t;
+
+static
+void *
+ht_parallel_start
+(
+	void	*task
+)
+{
+	ht_parallel_task_t *t = task;
+	t->function(t->context,t->index);
+	return 0;
+}
+
+static
+void
+ht_parallel
+(
+	unsigned int		 threads,
+	ht_parallel_function_t	 function,
+	void			*context
+)
+{
+	if(threads <= 1)
+	{
+		function(context,0);
+		return;
+	}
+
+	pthread_t *ids = malloc(threads * sizeof(pthread_t));
+	ht_parallel_task_t *tasks = malloc(threads * sizeof(ht_parallel_task_t));
+	int *started = calloc(threads,sizeof(int));
+
+	for(unsigned int i = 1; i < threads; i++)
+	{
+		tasks[i] = (ht_parallel_task_t) {
+			.function	= function,
+			.context	= context,
+			.index		= i,
+		};
+		started[i] = pthread_create(&ids[i],0,ht_parallel_start,&tasks[i]) == 0;
+	}
+
+	function(context,0);
+
+	for(unsigned int i = 1; i < threads; i++)
+	{
+		if(started[i])
+		{
+			pthread_join(ids[i],0);
+		}
+		else
+		{
+			function(context,i);
+		}
+	}
+
+	free(ids);
+	free(tasks);
+	free(started);
+}
+
+////////////////////////////////////////
+//	BULK LOADING
+//	- records are hashed by ranges of
+//		records, counting how many fall
+//		in each partition, a range of
+//		consecutive buckets
+//	- record numbers are then scattered
+//		so each partition's records are
+//		together and in record order
+//	- partitions are built one at a time
+//		by whichever thread is free, no
+//		two threads touching a bucket
+////////////////////////////////////////
+#define HT_BULK_BUCKETS_PER_PARTITION	1024
+#define HT_BULK_MAX_PARTITIONS		65536
+#define HT_BULK_PREFETCH		8
+
+typedef struct
+{
+	uint64_t	hash;
+	size_t		index;
+} ht_bulk_item_t;
+
+////////////////////////////////////////
+//	entries a thread added to the prefix's
+//		namespace, spliced in once the
+//		threads are done
+////////////////////////////////////////
+typedef struct
+{
+	ht_entry_t	*first;
+	ht_entry_t	*last;
+	size_t		 count;
+} ht_bulk_list_t;
+
+typedef struct
+{
+	ht_t			*ht;
+	const ht_record_t	*records;
+	size_t			 count;
+	ht_duplicates_t		 duplicates;
+	ht_status_t		*statuses;
+	ht_prefix		*prefix;
+	unsigned int		 threads;
+
+	uint64_t		*hashes;
+	ht_bulk_item_t		*order;
+	size_t			 partitions;
+	size_t			 span;
+	size_t			*counts;
+
+	size_t			 next_partition;
+	size_t			 first_failure;
+	size_t			 added;
+	size_t			 longest;
+
+	ht_slab_t		**node_slabs;
+	ht_slab_t		**key_slabs;
+
+	ht_namespace_t		 *space;
+	ht_bulk_list_t		 *lists;
+} ht_bulk_t;
+
+static
+inline
+void
+ht_bulk_range
+(
+	ht_bulk_t	*b,
+	unsigned int	 index,
+	size_t		*begin,
+	size_t		*end
+)
+{
+	size_t per = (b->count + b->threads - 1) / b->threads;
+
+	*begin = index * per < b->count ? index * per : b->count;
+	*end = *begin + per < b->count ? *begin + per : b->count;
+}
+
+static
+inline
+void
+ht_bulk_status
+(
+	ht_bulk_t	*b,
+	size_t		 i,
+	ht_status_t	 status
+)
+{
+	if(b->statuses != 0)
+	{
+		b->statuses[i] = status;
+	}
+
+	if(status == HT_SUCCESS)
+	{
+		return;
+	}
+
+	size_t first = __atomic_load_n(&b->first_failure,__ATOMIC_RELAXED);
+	while(i < first
+		&& !__atomic_compare_exchange_n(&b->first_failure,&first,i,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+}
+
+static
+inline
+int
+ht_bulk_valid
+(
+	const ht_record_t	*r
+)
+{
+	return r->key != 0 && r->value != 0;
+}
+
+static
+void
+ht_bulk_hash
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	ht_bulk_t *b = context;
+	size_t begin;
+	size_t end;
+
+	ht_bulk_range(b,index,&begin,&end);
+
+	size_t *counts = b->counts + index * b->partitions;
+
+	for(size_t i = begin; i < end; i += HT_BATCH)
+	{
+		size_t n = end - i < HT_BATCH ? end - i : HT_BATCH;
+		const void *keys[HT_BATCH];
+		size_t key_lengths[HT_BATCH];
+		ht_hash_t hashes[HT_BATCH];
+
+		for(size_t j = 0; j < n; j++)
+		{
+			const ht_record_t *r = &b->records[i + j];
+			keys[j] = ht_bulk_valid(r) ? r->key : 0;
+			key_lengths[j] = r->key_length;
+		}
+
+		ht_hash_batch(b->ht,keys,key_lengths,n,b->prefix,hashes);
+
+		for(size_t j = 0; j < n; j++)
+		{
+			if(keys[j] == 0)
+			{
+				continue;
+			}
+
+			b->hashes[i + j] = hashes[j].word;
+			counts[ht_index(b->ht,hashes[j].word) / b->span]++;
+		}
+	}
+}
+
+static
+void
+ht_bulk_scatter
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	ht_bulk_t *b = context;
+	size_t begin;
+	size_t end;
+
+	ht_bulk_range(b,index,&begin,&end);
+
+	size_t *offsets = b->counts + index * b->partitions;
+
+	for(size_t i = begin; i < end; i++)
+	{
+		if(ht_bulk_valid(&b->records[i]))
+		{
+			uint64_t hash = b->hashes[i];
+			b->order[offsets[ht_index(b->ht,hash) / b->span]++] = (ht_bulk_item_t) {
+				.hash	= hash,
+				.index	= i,
+			};
+		}
+	}
+}
+
+static
+void
+ht_bulk_build
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	ht_bulk_t *b = context;
+	ht_t *ht = b->ht;
+	ht_slab_t *node_slabs = 0;
+	ht_slab_t *key_slabs = 0;
+	ht_entry_t *no_free_nodes = 0;
+	ht_bulk_list_t list = {0};
+	size_t added = 0;
+	size_t longest = 0;
+
+	for(;;)
+	{
+		size_t p = __atomic_fetch_add(&b->next_partition,1,__ATOMIC_RELAXED);
+		if(p >= b->partitions)
+		{
+			break;
+		}
+
+		////////////////////////////////////////
+		//	after the scatter the last thread's
+		//		offsets end where each partition
+		//		ends
+		////////////////////////////////////////
+		size_t *ends = b->counts + (b->threads - 1) * b->partitions;
+		size_t begin = p == 0 ? 0 : ends[p - 1];
+
+		size_t end = ends[p];
+
+		////////////////////////////////////////
+		//	records and keys are in record
+		//		order, so they are fetched a
+		//		few records ahead
+		////////////////////////////////////////
+		for(size_t o = begin; o < end && o < begin + 2 * HT_BULK_PREFETCH; o++)
+		{
+			__builtin_prefetch(&b->records[b->order[o].index]);
+		}
+
+		for(size_t o = begin; o < end; o++)
+		{
+			if(o + 2 * HT_BULK_PREFETCH < end)
+			{
+				__builtin_prefetch(&b->records[b->order[o + 2 * HT_BULK_PREFETCH].index]);
+			}
+			if(o + HT_BULK_PREFETCH < end)
+			{
+				__builtin_prefetch(b->records[b->order[o + HT_BULK_PREFETCH].index].key);
+			}
+
+			size_t i = b->order[o].index;
+			const ht_record_t *r = &b->records[i];
+			uint64_t hash = b->order[o].hash;
+			ht_entry_t **link = &ht->table[ht_index(ht,hash)];
+			ht_entry_t *data = 0;
+			size_t length = 1;
+
+			while(*link)
+			{
+				if((*link)->hash == hash
+					&& ht_key_equal((*link)->key,(*link)->key_length,r->key,r->key_length,b->prefix))
+				{
+					data = *link;
+					break;
+				}
+				link = &(*link)->next;
+				length++;
+			}
+
+			if(data == 0)
+			{
+				if(length > longest)
+				{
+					longest = length;
+				}
+
+				*link = ht_v_create_from(
+					ht,
+					&node_slabs,
+					&key_slabs,
+					&no_free_nodes,
+					hash,
+					r->value,
+					r->value_length,
+					r->key,
+					r->key_length,
+					b->prefix
+				);
+				added++;
+				ht_bulk_status(b,i,HT_SUCCESS);
+
+				if(ht->namespace_link != 0)
+				{
+					ht_entry_t *v = *link;
+
+					*ht_ns_link(ht,v) = (ht_ns_link_t) {
+						.space	= b->space,
+						.prev	= 0,
+						.next	= b->space ? list.first : 0,
+					};
+
+					if(b->space != 0)
+					{
+						if(list.first != 0)
+						{
+							ht_ns_link(ht,list.first)->prev = v;
+						}
+						else
+						{
+							list.last = v;
+						}
+						list.first = v;
+						list.count++;
+					}
+				}
+			}
+			else if(b->duplicates == HT_DUPLICATES_KEEP_LAST)
+			{
+				ht_v_set_value(ht,data,r->value,r->value_length,0);
+				ht_bulk_status(b,i,HT_SUCCESS);
+			}
+			else
+			{
+				ht_bulk_status(
+					b,
+					i,
+					b->duplicates == HT_DUPLICATES_REJECT ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS
+				);
+			}
+		}
+	}
+
+	__atomic_fetch_add(&b->added,added,__ATOMIC_RELAXED);
+
+	size_t l = __atomic_load_n(&b->longest,__ATOMIC_RELAXED);
+	while(longest > l
+		&& !__atomic_compare_exchange_n(&b->longest,&l,longest,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+
+	b->node_slabs[index] = node_slabs;
+	b->key_slabs[index] = key_slabs;
+	b->lists[index] = list;
+}
+
+////////////////////////////////////////
+//	put a thread's slabs in front of the
+//		table's
+////////////////////////////////////////
+static
+void
+ht_slab_splice
+(
+	ht_slab_t	**slabs,
+	ht_slab_t	 *more
+)
+{
+	if(more == 0)
+	{
+		return;
+	}
+
+	ht_slab_t *last = more;
+	while(last->next)
+	{
+		last = last->next;
+	}
+
+	last->next = *slabs;
+	*slabs = more;
+}
+
+////////////////////////////////////////
+//	load records one by one, for open and
+//		concurrent tables
+////////////////////////////////////////
+static
+void
+ht_bulk_serial
+(
+	ht_bulk_t	*b
+)
+{
+	for(size_t i = 0; i < b->count; i++)
+	{
+		const ht_record_t *r = &b->records[i];
+
+		if(!ht_bulk_valid(r))
+		{
+			continue;
+		}
+
+		ht_hash_t hash = ht_hash(b->ht,(uint8_t *)r->key,r->key_length,b->prefix);
+		ht_status_t s;
+
+		if(b->duplicates == HT_DUPLICATES_KEEP_LAST)
+		{
+			s = ht_update_hashed(b->ht,hash,r->value,r->value_length,r->key,r->key_length,b->prefix);
+		}
+		else
+		{
+			s = ht_add_hashed(b->ht,hash,r->value,r->value_length,r->key,r->key_length,b->prefix);
+			if(s == HT_KEY_ALREADY_IN_USE && b->duplicates == HT_DUPLICATES_KEEP_FIRST)
+			{
+				s = HT_SUCCESS;
+			}
+		}
+
+		ht_bulk_status(b,i,s);
+	}
+}
+
+////////////////////////////////////////
+//	RANGES
+//	- iterating and clearing visit units,
+//		numbered from 0
+//		- mapped tables: records
+//		- open layout: slots
+//		- concurrent tables: buckets
+//		- chained tables: the old buckets
+//			still to be rehashed, then
+//			the buckets
+//	- ranges of units can be handed to
+//		different threads
+////////////////////////////////////////
+#define HT_PARALLEL_CHUNK	4096
+
+typedef void (*ht_iterate_function_t)
+	(
+		void	*value,
+		size_t	 value_length,
+		void	*key,
+		size_t	 key_length,
+		size_t	 index,
+		void	*context
+	);
+
+static
+size_t
+ht_units
+(
+	ht_t	*ht
+)
+{
+	if(ht->map != 0)
+	{
+		return ht->num_of_entries;
+	}
+
+	if(ht->cc != 0)
+	{
+		return __atomic_load_n(&ht->cc->table,__ATOMIC_ACQUIRE)->length;
+	}
+
+	return ht->old_table_length + ht->table_length;
+}
+
+static
+void
+ht_iterate_chain
+(
+	ht_entry_t		*data,
+	size_t			 index,
+	ht_iterate_function_t	 function,
+	void			*context
+)
+{
+	while(data)
+	{
+		function(data->value,data->value_length,data->key,data->key_length,index,context);
+		data = __atomic_load_n(&data->next,__ATOMIC_ACQUIRE);
+	}
+}
+
+static
+void
+ht_iterate_range
+(
+	ht_t			*ht,
+	size_t			 begin,
+	size_t			 end,
+	ht_iterate_function_t	 function,
+	void			*context
+)
+{
+	if(ht->map != 0)
+	{
+		ht_map_t *m = ht->map;
+
+		for(size_t i = begin; i < end; i++)
+		{
+			const ht_snapshot_record_t *record = &m->records[i];
+
+			function(
+				m->base + record->value,
+				record->value_length,
+				m->base + record->key,
+				record->key_length,
+				i,
+				context
+			);
+		}
+		return;
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			if(ht->control[i] & HT_CTRL_EMPTY)
+			{
+				continue;
+			}
+
+			ht_slot_t *s = &ht->slots[i];
+
+			function(s->value,s->value_length,s->key,s->key_length,i,context);
+		}
+		return;
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_reader_slot_t *r = ht_cc_enter(ht->cc);
+		ht_cc_table_t *t = __atomic_load_n(&ht->cc->table,__ATOMIC_ACQUIRE);
+
+		for(size_t i = begin; i < end && i < t->length; i++)
+		{
+			ht_iterate_chain(__atomic_load_n(&t->buckets[i],__ATOMIC_ACQUIRE),i,function,context);
+		}
+
+		ht_cc_exit(r);
+		return;
+	}
+
+	size_t ol = ht->old_table_length;
+
+	for(size_t u = begin; u < end; u++)
+	{
+		if(u >= ol)
+		{
+			ht_iterate_chain(ht->table[u - ol],u - ol,function,context);
+		}
+		else if(u >= ht->rehash_index)
+		{
+			ht_iterate_chain(ht->old_table[u],u,function,context);
+		}
+	}
+}
+
+////////////////////////////////////////
+//	destroy the entries in a range of
+//		units, leaving the arrays that
+//		held them for ht_clear_finish
+//	- pooled nodes and keys go with their
+//		slabs
+//	- not for concurrent or mapped tables
+////////////////////////////////////////
+static
+void
+ht_clear_range
+(
+	ht_t	*ht,
+	size_t	 begin,
+	size_t	 end
+)
+{
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			if(ht->control[i] & HT_CTRL_EMPTY)
+			{
+				continue;
+			}
+
+			ht_slot_t *s = &ht->slots[i];
+
+			free(s->key);
+			if(s->value && ht->destroy_value)
+			{
+				ht->destroy_value(s->value,ht->extra);
+			}
+		}
+		return;
+	}
+
+	if(ht->inline_key_length != 0 && ht->destroy_value == 0 && !ht->own_values)
+	{
+		return;
+	}
+
+	size_t ol = ht->old_table_length;
+
+	for(size_t u = begin; u < end; u++)
+	{
+		if(u >= ol)
+		{
+			ht_v_destroy_chain(ht->table[u - ol],ht);
+		}
+		else if(u >= ht->rehash_index)
+		{
+			ht_v_destroy_chain(ht->old_table[u],ht);
+		}
+	}
+}
+
+static
+void
+ht_clear_finish
+(
+	ht_t	*ht
+)
+{
+	size_t l = ht->table_length;
+
+	if(ht->layout == HT_LAYOUT_OPEN)
+	{
+		memset(ht->control,HT_CTRL_EMPTY,l);
+		ht->growth_left = l - l / 8;
+		ht->num_of_entries = 0;
+		return;
+	}
+
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		memset(ht->control,HT_CTRL_EMPTY,l);
+		ht->growth_left = ht_ck_limit(ht_ck_buckets(ht));
+		ht->stash_used = 0;
+		ht->num_of_entries = 0;
+		return;
+	}
+
+	if(ht->old_table != 0)
+	{
+		free(ht->old_table);
+		ht->old_table = 0;
+		ht->old_table_length = 0;
+		ht->rehash_index = 0;
+	}
+
+	memset(ht->table,0,l * sizeof(ht_entry_t *));
+
+	ht_slab_free_all(&ht->node_slabs);
+	ht_slab_free_all(&ht->key_slabs);
+	ht->free_nodes = 0;
+
+	ht_ns_clear(ht);
+
+	ht->num_of_entries = 0;
+	ht->reseed_entries = 0;
+}
+
+typedef struct
+{
+	ht_t			 *ht;
+	size_t			  units;
+	size_t			  next;
+	ht_iterate_function_t	  function;
+	void			**contexts;
+} ht_parallel_walk_t;
+
+////////////////////////////////////////
+//	threads take HT_PARALLEL_CHUNK units
+//		at a time until none are left
+////////////////////////////////////////
+static
+int
+ht_parallel_claim
+(
+	ht_parallel_walk_t	*w,
+	size_t			*begin,
+	size_t			*end
+)
+{
+	*begin = __atomic_fetch_add(&w->next,HT_PARALLEL_CHUNK,__ATOMIC_RELAXED);
+
+	if(*begin >= w->units)
+	{
+		return 0;
+	}
+
+	*end = *begin + HT_PARALLEL_CHUNK < w->units ? *begin + HT_PARALLEL_CHUNK : w->units;
+
+	return 1;
+}
+
+static
+void
+ht_parallel_iterate_worker
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	ht_parallel_walk_t *w = context;
+	void *c = w->contexts ? w->contexts[index] : 0;
+	size_t begin;
+	size_t end;
+
+	while(ht_parallel_claim(w,&begin,&end))
+	{
+		ht_iterate_range(w->ht,begin,end,w->function,c);
+	}
+}
+
+static
+void
+ht_parallel_clear_worker
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	(void) index;
+
+	ht_parallel_walk_t *w = context;
+	size_t begin;
+	size_t end;
+
+	while(ht_parallel_claim(w,&begin,&end))
+	{
+		ht_clear_range(w->ht,begin,end);
+	}
+}
+
+////////////////////////////////////////
+//	CURSORS
+//	- HT_INDEX_MASK and HT_INDEX_FASTRANGE
+//		buckets hold ranges of a 64 bit
+//		order on hashes, the cursor is a
+//		position in that order
+//		- HT_INDEX_FASTRANGE: the word
+//			moved to the top of 64 bits
+//		- HT_INDEX_MASK: the word with its
+//			bits reversed, so a bucket
+//			splits into neighbouring
+//			ranges when the table grows
+//	- a call visits the buckets covering
+//		the position in every bucket array
+//		and moves it to the first end, so
+//		no position is skipped whichever
+//		array an entry lives in later
+//	- other tables visit units in order
+//		and start over once entries move
+////////////////////////////////////////
+typedef struct
+{
+	ht_iterate_function_t	 function;
+	void			*context;
+	size_t			 entries;
+} ht_cursor_visit_t;
+
+static
+void
+ht_cursor_count
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	ht_cursor_visit_t *v = context;
+
+	v->function(value,value_length,key,key_length,index,v->context);
+	v->entries++;
+}
+
+static
+inline
+uint64_t
+ht_reverse64
+(
+	uint64_t	x
+)
+{
+	x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+
+	return __builtin_bswap64(x);
+}
+
+////////////////////////////////////////
+//	bucket covering position in an array
+//		of the given length, and the
+//		position just past it
+//	- the end is 2^64 past the last bucket
+////////////////////////////////////////
+static
+size_t
+ht_cursor_bucket
+(
+	ht_t			*ht,
+	uint64_t		 position,
+	size_t			 length,
+	unsigned __int128	*end
+)
+{
+	if(ht->index_mode == HT_INDEX_MASK)
+	{
+		unsigned int shift = 64 - __builtin_ctzll(length);
+		unsigned __int128 top = shift == 64 ? 0 : position >> shift;
+
+		*end = (top + 1) << shift;
+
+		return ht_reverse64(position) & (length - 1);
+	}
+
+	size_t i = (size_t) (((unsigned __int128) position * length) >> 64);
+
+	*end = ((((unsigned __int128) i + 1) << 64) + length - 1) / length;
+
+	return i;
+}
+
+////////////////////////////////////////
+//	visit buckets from the cursor position
+//		until count entries were seen
+//	- concurrent tables walk each bucket
+//		again if a resize overlapped the
+//		walk, it relinks entries in place
+//		and its chains can end early
+////////////////////////////////////////
+static
+void
+ht_cursor_ordered
+(
+	ht_t			*ht,
+	ht_cursor_t		*cursor,
+	size_t			 count,
+	ht_cursor_visit_t	*v
+)
+{
+	ht_reader_slot_t *r = 0;
+
+	if(ht->cc != 0)
+	{
+		r = ht_cc_enter(ht->cc);
+	}
+
+	while(!cursor->finished && v->entries < count)
+	{
+		unsigned __int128 end;
+		size_t i;
+
+		if(ht->cc != 0)
+		{
+			uint64_t s1 = __atomic_load_n(&ht->cc->seq,__ATOMIC_ACQUIRE);
+
+			if(s1 & 1)
+			{
+				HT_CPU_RELAX();
+				continue;
+			}
+
+			ht_cc_table_t *t = __atomic_load_n(&ht->cc->table,__ATOMIC_ACQUIRE);
+			i = ht_cursor_bucket(ht,cursor->position,t->length,&end);
+
+			ht_iterate_chain(__atomic_load_n(&t->buckets[i],__ATOMIC_ACQUIRE),i,ht_cursor_count,v);
+
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if(__atomic_load_n(&ht->cc->seq,__ATOMIC_RELAXED) != s1)
+			{
+				continue;
+			}
+		}
+		else
+		{
+			i = ht_cursor_bucket(ht,cursor->position,ht->table_length,&end);
+
+			if(ht->old_table != 0)
+			{
+				unsigned __int128 old_end;
+				size_t oi = ht_cursor_bucket(ht,cursor->position,ht->old_table_length,&old_end);
+
+				if(oi >= ht->rehash_index)
+				{
+					ht_iterate_chain(ht->old_table[oi],oi,ht_cursor_count,v);
+				}
+
+				if(old_end < end)
+				{
+					end = old_end;
+				}
+			}
+
+			ht_iterate_chain(ht->table[i],i,ht_cursor_count,v);
+		}
+
+		if(end >> 64)
+		{
+			cursor->finished = 1;
+		}
+		cursor->position = (uint64_t) end;
+	}
+
+	if(r != 0)
+	{
+		ht_cc_exit(r);
+	}
+}
+
+////////////////////////////////////////
+//	entries moved by a resize or rehash
+//		since the last call
+////////////////////////////////////////
+static
+inline
+uint64_t
+ht_cursor_moves
+(
+	ht_t	*ht
+)
+{
+	if(ht->cc != 0)
+	{
+		return __atomic_load_n(&ht->cc->seq,__ATOMIC_ACQUIRE);
+	}
+
+	return ht->moves;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	MODIFICATION
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_add_with_prefix
+(
+	ht_t		*ht,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+	TEST_NULL_VALUE(value);
+
+	HT_OP_BEGIN(HT_OP_ADD,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_ADD,hash);
+
+	ht_status_t status = ht_add_hashed(ht,hash,value,value_length,key,key_length,prefix);
+
+	HT_OP_END(HT_OP_ADD,status);
+
+	return status;
+}
+
+ht_status_t
+ht_update_with_prefix
+(
+	ht_t		*ht,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+	TEST_NULL_VALUE(value);
+
+	HT_OP_BEGIN(HT_OP_UPDATE,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_UPDATE,hash);
+
+	ht_status_t status = ht_update_hashed(ht,hash,value,value_length,key,key_length,prefix);
+
+	HT_OP_END(HT_OP_UPDATE,status);
+
+	return status;
+}
+
+ht_status_t
+ht_update_strict_with_prefix
+(
+	ht_t		*ht,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+	TEST_NULL_VALUE(value);
+
+	HT_OP_BEGIN(HT_OP_UPDATE,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_UPDATE,hash);
+
+	ht_status_t status = ht_update_strict_hashed(ht,hash,value,value_length,key,key_length,prefix);
+
+	HT_OP_END(HT_OP_UPDATE,status);
+
+	return status;
+}
+
+ht_status_t
+ht_get_or_insert_with_prefix
+(
+	ht_t		 *ht,
+	void		 *value,
+	size_t		  value_length,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *destination_length,
+	int		 *inserted,
+	ht_prefix	 *prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+	TEST_NULL_VALUE(value);
+
+	HT_OP_BEGIN(HT_OP_UPDATE,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_UPDATE,hash);
+
+	ht_upsert_t u = {
+		.destination = destination,
+		.destination_length = destination_length,
+		.inserted = inserted,
+	};
+
+	ht_status_t status = ht_upsert_hashed(ht,hash,value,value_length,key,key_length,prefix,&u);
+
+	HT_OP_END(HT_OP_UPDATE,status);
+
+	return status;
+}
+
+ht_status_t
+ht_upsert_with_prefix
+(
+	ht_t		*ht,
+	void		*value,
+	size_t		 value_length,
+	const void	*key,
+	size_t		 key_length,
+	void		(*merge)
+			(
+				void	**value,
+				size_t	 *value_length,
+				void	 *context
+			),
+	void		*context,
+	int		*inserted,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+	TEST_NULL_VALUE(value);
+
+	HT_OP_BEGIN(HT_OP_UPDATE,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_UPDATE,hash);
+
+	ht_upsert_t u = {
+		.merge = merge,
+		.context = context,
+		.inserted = inserted,
+	};
+
+	ht_status_t status = ht_upsert_hashed(ht,hash,value,value_length,key,key_length,prefix,&u);
+
+	HT_OP_END(HT_OP_UPDATE,status);
+
+	return status;
+}
+
+ht_status_t
+ht_get_with_prefix
+(
+	ht_t		 *ht,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *value_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+
+	HT_OP_BEGIN(HT_OP_GET,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_GET,hash);
+
+	ht_status_t status = ht_get_hashed(ht,hash,key,key_length,destination,value_length,prefix);
+
+	HT_OP_END(HT_OP_GET,status);
+
+	return status;
+}
+
+////////////////////////////////////////
+//	COPYING VALUES OUT
+//	- ht_get_copy mallocs the copy,
+//		ht_get_into writes it to the
+//		caller's buffer
+////////////////////////////////////////
+typedef struct
+{
+	void		**destination;
+	void		 *buffer;
+	size_t		  buffer_length;
+	size_t		 *value_length;
+} ht_copy_t;
+
+static
+ht_status_t
+ht_copy_out
+(
+	ht_copy_t	*copy,
+	const void	*value,
+	size_t		 value_length
+)
+{
+	if(copy->destination != 0)
+	{
+		void *v = malloc(value_length);
+		memcpy(v,value,value_length);
+		*copy->destination = v;
+		*copy->value_length = value_length;
+
+		return HT_SUCCESS;
+	}
+
+	if(copy->value_length != 0)
+	{
+		*copy->value_length = value_length;
+	}
+
+	if(copy->buffer == 0)
+	{
+		return HT_SUCCESS;
+	}
+
+	if(value_length > copy->buffer_length)
+	{
+		return HT_BUFFER_TOO_SMALL;
+	}
+
+	memcpy(copy->buffer,value,value_length);
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////
+//	look up a key and copy its value out
+//	- concurrent tables copy before
+//		leaving the reader section, so
+//		the value can't be retired
+//		under the copy
+////////////////////////////////////////
+static
+ht_status_t
+ht_get_copied
+(
+	ht_t		*ht,
+	ht_hash_t	 hash,
+	const void	*key,
+	size_t		 key_length,
+	ht_copy_t	*copy,
+	ht_prefix	*prefix
+)
+{
+	if(ht->map != 0)
+	{
+		const ht_snapshot_record_t *record = ht_map_find(ht,hash.word,key,key_length,prefix);
+
+		if(record == 0)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		return ht_copy_out(copy,ht->map->base + record->value,record->value_length);
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_reader_slot_t *r = ht_cc_enter(ht->cc);
+		ht_entry_t *data = ht_cc_find(ht,hash.word,key,key_length,prefix);
+		ht_status_t status = HT_KEY_NOT_IN_USE;
+
+		if(data != 0)
+		{
+			status = ht_copy_out(copy,data->value,data->value_length);
+		}
+
+		ht_cc_exit(r);
+
+		return status;
+	}
+
+	if(ht->layout != HT_LAYOUT_CHAINED)
+	{
+		size_t i = ht_slot_find(ht,hash.h128[0],hash.word,key,key_length,prefix);
+
+		if(i == HT_NO_SLOT)
+		{
+			return HT_KEY_NOT_IN_USE;
+		}
+
+		return ht_copy_out(copy,ht->slots[i].value,ht->slots[i].value_length);
+	}
+
+	ht_entry_t *data = ht_v_lookup(ht,hash.word,key,key_length,prefix);
+
+	if(data == 0)
+	{
+		return HT_KEY_NOT_IN_USE;
+	}
+
+	return ht_copy_out(copy,data->value,data->value_length);
+}
+
+ht_status_t
+ht_get_copy_with_prefix
+(
+	ht_t		 *ht,
+	const void	 *key,
+	size_t		  key_length,
+	void		**destination,
+	size_t		 *value_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+
+	HT_OP_BEGIN(HT_OP_GET,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_GET,hash);
+
+	ht_copy_t copy = {
+		.destination = destination,
+		.value_length = destination ? value_length : 0,
+	};
+
+	ht_status_t status = ht_get_copied(ht,hash,key,key_length,&copy,prefix);
+
+	HT_OP_END(HT_OP_GET,status);
+
+	return status;
+}
+
+ht_status_t
+ht_get_into_with_prefix
+(
+	ht_t		*ht,
+	const void	*key,
+	size_t		 key_length,
+	void		*buffer,
+	size_t		 buffer_length,
+	size_t		*value_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+
+	HT_OP_BEGIN(HT_OP_GET,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_GET,hash);
+
+	ht_copy_t copy = {
+		.buffer = buffer,
+		.buffer_length = buffer_length,
+		.value_length = value_length,
+	};
+
+	ht_status_t status = ht_get_copied(ht,hash,key,key_length,&copy,prefix);
+
+	HT_OP_END(HT_OP_GET,status);
+
+	return status;
+}
+
+ht_status_t
+ht_remove_with_prefix
+(
+	ht_t		*ht,
+	const void	*key,
+	size_t		 key_length,
+	ht_prefix	*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(key);
+
+	HT_OP_BEGIN(HT_OP_REMOVE,key,key_length);
+
+	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_REMOVE,hash);
+
+	ht_status_t status = ht_remove_hashed(ht,hash,key,key_length,prefix);
+
+	HT_OP_END(HT_OP_REMOVE,status);
+
+	return status;
+}
+
+ht_status_t
+ht_clear_table
+(
+	ht_t		*ht
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_cc_clear(ht);
+		return HT_SUCCESS;
+	}
+
+	ht_clear_range(ht,0,ht_units(ht));
+	ht_clear_finish(ht);
+
+	return HT_SUCCESS;
+}
+
+ht_status_t
+ht_parallel_clear_table
+(
+	ht_t		*ht,
+	unsigned int	 threads
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_cc_clear(ht);
+		return HT_SUCCESS;
+	}
+
+	ht_parallel_walk_t w = {
+		.ht	= ht,
+		.units	= ht_units(ht),
+	};
+
+	ht_parallel(threads,ht_parallel_clear_worker,&w);
+	ht_clear_finish(ht);
+
+	return HT_SUCCESS;
+}
+
+ht_status_t
+ht_resize_table
+(
+	ht_t		*ht,
+	size_t		 table_length
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	if(table_length == 0)
+	{
+		return HT_NONPOSITIVE_LENGTH;
+	}
+
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->layout == HT_LAYOUT_OPEN)
+	{
+		size_t c = ht_oa_capacity(table_length);
+		while(c - c / 8 < ht->num_of_entries)
+		{
+			c <<= 1;
+		}
+
+		ht_oa_rehash(ht,c);
+
+		return HT_SUCCESS;
+	}
+
+	if(ht->layout == HT_LAYOUT_CUCKOO)
+	{
+		size_t buckets = ht_ck_buckets_for(table_length);
+		while(ht_ck_limit(buckets) < ht->num_of_entries)
+		{
+			buckets <<= 1;
+		}
+
+		ht_ck_rehash(ht,buckets,HT_CUCKOO_STASH);
+
+		return HT_SUCCESS;
+	}
+
+	if(ht->index_mode == HT_INDEX_MASK)
+	{
+		table_length = ht_round_up_pow2(table_length);
+	}
+
+	if(ht->cc != 0)
+	{
+		ht_cc_resize(ht,0,table_length);
+		return HT_SUCCESS;
+	}
+
+	ht_rehash_finish(ht);
+
+	size_t l = ht->table_length;
+	ht_entry_t **ot = ht->table;
+
+	HT_RESIZE_BEGIN(l,table_length);
+
+	ht_entry_t **nt = malloc(table_length * sizeof(ht_entry_t *));
+	for(int i = 0; i < table_length; i++)
+	{
+		nt[i] = 0;
+	}
+
+	ht->table = nt;
+	ht->table_length = table_length;
+	ht->moves++;
+
+	for(int i = 0; i < l; i++)
+	{
+		ht_entry_t *data = ot[i];
+
+		while(data)
+		{
+			ht_entry_t *next = data->next;
+
+			size_t index = ht_index(ht,data->hash);
+			data->next = nt[index];
+			nt[index] = data;
+
+			data = next;
+		}
+	}
+
+	free(ot);
+
+	HT_RESIZE_END(table_length);
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////
+//	calls a context free callback from
+//		ht_iterate_with_context
+////////////////////////////////////////
+typedef struct
+{
+	void	(*function)
+		(
+			void	*value,
+			size_t	 value_length,
+			void	*key,
+			size_t	 key_length,
+			size_t	 index
+		);
+} ht_iterate_plain_t;
+
+static
+void
+ht_iterate_plain
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	ht_iterate_plain_t *p = context;
+	p->function(value,value_length,key,key_length,index);
+}
+
+ht_status_t
+ht_iterate
+(
+	ht_t	*ht,
+	void	(*function)
+		(
+			void	*value,
+			size_t	 value_length,
+			void	*key,
+			size_t	 key_length,
+			size_t	 index
+		)
+)
+{
+	TEST_NULL_ITERATOR(function);
+
+	ht_iterate_plain_t p = {
+		.function = function,
+	};
+
+	return ht_iterate_with_context(ht,ht_iterate_plain,&p);
+}
+
+ht_status_t
+ht_iterate_with_context
+(
+	ht_t	*ht,
+	void	(*function)
+		(
+			void	*value,
+			size_t	 value_length,
+			void	*key,
+			size_t	 key_length,
+			size_t	 index,
+			void	*context
+		),
+	void	*context
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_ITERATOR(function);
+
+	ht_iterate_range(ht,0,ht_units(ht),function,context);
+
+	return HT_SUCCESS;
+}
+
+ht_status_t
+ht_parallel_iterate
+(
+	ht_t		 *ht,
+	unsigned int	  threads,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		**contexts
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_ITERATOR(function);
+
+	ht_parallel_walk_t w = {
+		.ht		= ht,
+		.units		= ht_units(ht),
+		.function	= function,
+		.contexts	= contexts,
+	};
+
+	ht_parallel(threads,ht_parallel_iterate_worker,&w);
+
+	return HT_SUCCESS;
+}
+
+ht_status_t
+ht_cursor_next
+(
+	ht_t		*ht,
+	ht_cursor_t	*cursor,
+	size_t		 count,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		*context
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_ITERATOR(function);
+
+	ht_cursor_visit_t v = {
+		.function	= function,
+		.context	= context,
+	};
+
+	if(ht->map == 0
+		&& ht->layout == HT_LAYOUT_CHAINED
+		&& ht->index_mode != HT_INDEX_MODULO)
+	{
+		////////////////////////////////////////
+		//	a reseed reorders every hash, so
+		//		the position means nothing
+		//		after one
+		////////////////////////////////////////
+		if(cursor->moves != ht->reseeds)
+		{
+			cursor->position = 0;
+			cursor->moves = ht->reseeds;
+			cursor->finished = 0;
+		}
+
+		ht_cursor_ordered(ht,cursor,count,&v);
+		return HT_SUCCESS;
+	}
+
+	uint64_t moves = ht_cursor_moves(ht);
+
+	if(cursor->moves != moves)
+	{
+		cursor->position = 0;
+		cursor->moves = moves;
+		cursor->finished = 0;
+	}
+
+	size_t units = ht_units(ht);
+
+	while(cursor->position < units && v.entries < count)
+	{
+		ht_iterate_range(ht,cursor->position,cursor->position + 1,ht_cursor_count,&v);
+		cursor->position++;
+	}
+
+	////////////////////////////////////////
+	//	a concurrent resize that overlapped
+	//		the call, or was running when
+	//		moves was read, may have hidden
+	//		entries from it, the next call
+	//		starts over instead
+	////////////////////////////////////////
+	if(cursor->position >= units
+		&& (ht->cc == 0 || (moves & 1) == 0)
+		&& ht_cursor_moves(ht) == moves)
+	{
+		cursor->finished = 1;
+	}
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	BATCHES
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_get_many_with_prefix
+(
+	ht_t		 *ht,
+	size_t		  count,
+	const void	**keys,
+	const size_t	 *key_lengths,
+	void		**destinations,
+	size_t		 *value_lengths,
+	ht_status_t	 *statuses,
+	ht_prefix	 *prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(keys);
+
+	ht_status_t result = HT_SUCCESS;
+
+	for(size_t b = 0; b < count; b += HT_BATCH)
+	{
+		size_t n = count - b < HT_BATCH ? count - b : HT_BATCH;
+		ht_hash_t hashes[HT_BATCH];
+
+		ht_hash_batch(ht,keys + b,key_lengths + b,n,prefix,hashes);
+		ht_prefetch_batch(ht,hashes,n);
+
+		for(size_t i = 0; i < n; i++)
+		{
+			ht_status_t s = HT_NULL_KEY;
+
+			if(keys[b + i] != 0)
+			{
+				s = ht_get_hashed(
+					ht,
+					hashes[i],
+					keys[b + i],
+					key_lengths[b + i],
+					destinations && value_lengths ? &destinations[b + i] : 0,
+					value_lengths ? &value_lengths[b + i] : 0,
+					prefix
+				);
+			}
+
+			if(statuses != 0)
+			{
+				statuses[b + i] = s;
+			}
+			if(result == HT_SUCCESS)
+			{
+				result = s;
+			}
+		}
+	}
+
+	return result;
+}
+
+ht_status_t
+ht_add_many_with_prefix
+(
+	ht_t		 *ht,
+	size_t		  count,
+	void		**values,
+	const size_t	 *value_lengths,
+	const void	**keys,
+	const size_t	 *key_lengths,
+	ht_status_t	 *statuses,
+	ht_prefix	 *prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_KEY(keys);
+	TEST_NULL_VALUE(values);
+
+	ht_status_t result = HT_SUCCESS;
+
+	for(size_t b = 0; b < count; b += HT_BATCH)
+	{
+		size_t n = count - b < HT_BATCH ? count - b : HT_BATCH;
+		ht_hash_t hashes[HT_BATCH];
+		size_t reseeds = ht->reseeds;
+
+		ht_hash_batch(ht,keys + b,key_lengths + b,n,prefix,hashes);
+		ht_prefetch_batch(ht,hashes,n);
+
+		for(size_t i = 0; i < n; i++)
+		{
+			ht_status_t s;
+
+			////////////////////////////////////////
+			//	an add that reseeded the table
+			//		leaves the rest of the batch
+			//		hashed under the old seed
+			if(ht->reseeds != reseeds)
+			{
+				reseeds = ht->reseeds;
+				ht_hash_batch(ht,keys + b + i,key_lengths + b + i,n - i,prefix,hashes + i);
+			}
+
+			if(keys[b + i] == 0)
+			{
+				s = HT_NULL_KEY;
+			}
+			else if(values[b + i] == 0)
+			{
+				s = HT_NULL_VALUE;
+			}
+			else
+			{
+				s = ht_add_hashed(
+					ht,
+					hashes[i],
+					values[b + i],
+					value_lengths[b + i],
+					keys[b + i],
+					key_lengths[b + i],
+					prefix
+				);
+			}
+
+			if(statuses != 0)
+			{
+				statuses[b + i] = s;
+			}
+			if(result == HT_SUCCESS)
+			{
+				result = s;
+			}
+		}
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	BULK LOADING
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_bulk_load_with_prefix
+(
+	ht_t			*ht,
+	const ht_record_t	*records,
+	size_t			 count,
+	ht_duplicates_t		 duplicates,
+	unsigned int		 threads,
+	ht_status_t		*statuses,
+	ht_prefix		*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	ht_bulk_t b = {
+		.ht		= ht,
+		.records	= records,
+		.count		= count,
+		.duplicates	= duplicates,
+		.statuses	= statuses,
+		.prefix		= prefix,
+		.first_failure	= count,
+	};
+
+	for(size_t i = 0; i < count; i++)
+	{
+		if(records[i].key == 0)
+		{
+			ht_bulk_status(&b,i,HT_NULL_KEY);
+		}
+		else if(records[i].value == 0)
+		{
+			ht_bulk_status(&b,i,HT_NULL_VALUE);
+		}
+	}
+
+	if(ht->cc != 0 || ht->layout != HT_LAYOUT_CHAINED)
+	{
+		ht_bulk_serial(&b);
+	}
+	else
+	{
+		if(ht->max_load_factor > 0)
+		{
+			size_t need = (size_t) ((ht->num_of_entries + count) / ht->max_load_factor) + 1;
+			if(need > ht->table_length)
+			{
+				ht_resize_table(ht,need);
+			}
+		}
+
+		ht_rehash_finish(ht);
+
+		size_t l = ht->table_length;
+		size_t partitions = l / HT_BULK_BUCKETS_PER_PARTITION;
+
+		if(partitions > HT_BULK_MAX_PARTITIONS)
+		{
+			partitions = HT_BULK_MAX_PARTITIONS;
+		}
+
+		////////////////////////////////////////
+		//	a thread per thousand records at
+		//		most, and enough partitions to
+		//		keep every thread busy
+		////////////////////////////////////////
+		b.threads = threads ? threads : 1;
+		if(b.threads > count / 1024 + 1)
+		{
+			b.threads = count / 1024 + 1;
+		}
+
+		if(partitions < b.threads * 4)
+		{
+			partitions = b.threads * 4;
+		}
+		if(partitions > l)
+		{
+			partitions = l;
+		}
+
+		b.span = (l + partitions - 1) / partitions;
+		b.partitions = (l + b.span - 1) / b.span;
+
+		b.hashes = malloc((count ? count : 1) * sizeof(uint64_t));
+		b.order = malloc((count ? count : 1) * sizeof(ht_bulk_item_t));
+		b.counts = calloc(b.threads * b.partitions,sizeof(size_t));
+		b.node_slabs = calloc(b.threads,sizeof(ht_slab_t *));
+		b.key_slabs = calloc(b.threads,sizeof(ht_slab_t *));
+		b.lists = calloc(b.threads,sizeof(ht_bulk_list_t));
+
+		if(ht->namespace_link != 0 && prefix != 0)
+		{
+			b.space = ht_ns_get(ht,prefix);
+		}
+
+		ht_parallel(b.threads,ht_bulk_hash,&b);
+
+		size_t running = 0;
+		for(size_t p = 0; p < b.partitions; p++)
+		{
+			for(unsigned int t = 0; t < b.threads; t++)
+			{
+				size_t c = b.counts[t * b.partitions + p];
+				b.counts[t * b.partitions + p] = running;
+				running += c;
+			}
+		}
+
+		ht_parallel(b.threads,ht_bulk_scatter,&b);
+		ht_parallel(b.threads,ht_bulk_build,&b);
+
+		for(unsigned int t = 0; t < b.threads; t++)
+		{
+			ht_slab_splice(&ht->node_slabs,b.node_slabs[t]);
+			ht_slab_splice(&ht->key_slabs,b.key_slabs[t]);
+
+			if(b.space != 0)
+			{
+				ht_ns_splice(ht,b.space,b.lists[t].first,b.lists[t].last,b.lists[t].count);
+			}
+		}
+
+		if(b.space != 0)
+		{
+			ht_ns_release(ht,b.space);
+		}
+
+		ht->num_of_entries += b.added;
+
+		ht_reseed_check(ht,b.longest);
+
+		free(b.hashes);
+		free(b.order);
+		free(b.counts);
+		free(b.node_slabs);
+		free(b.key_slabs);
+		free(b.lists);
+	}
+
+	if(b.first_failure == count)
+	{
+		return HT_SUCCESS;
+	}
+
+	const ht_record_t *r = &records[b.first_failure];
+
+	return r->key == 0 ? HT_NULL_KEY
+		: r->value == 0 ? HT_NULL_VALUE
+		: HT_KEY_ALREADY_IN_USE;
+}
+
+ht_status_t
+ht_bulk_load_from_with_prefix
+(
+	ht_t			*ht,
+	int			(*next)
+				(
+					ht_record_t	*record,
+					void		*context
+				),
+	void			*context,
+	ht_duplicates_t		 duplicates,
+	unsigned int		 threads,
+	ht_prefix		*prefix
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_ITERATOR(next);
+
+	ht_record_t *records = 0;
+	size_t count = 0;
+	size_t size = 0;
+	ht_record_t r;
+
+	while(next(&r,context))
+	{
+		if(count == size)
+		{
+			size = size ? size * 2 : 1024;
+			records = realloc(records,size * sizeof(ht_record_t));
+		}
+		records[count++] = r;
+	}
+
+	ht_status_t s = ht_bulk_load_with_prefix(ht,records,count,duplicates,threads,0,prefix);
+
+	free(records);
+
+	return s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	SNAPSHOTS
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_save
+(
+	ht_t		*ht,
+	const char	*path
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	size_t pl = strlen(path);
+	char *temporary = malloc(pl + sizeof(".tmp"));
+	memcpy(temporary,path,pl);
+	memcpy(temporary + pl,".tmp",sizeof(".tmp"));
+
+	FILE *f = fopen(temporary,"wb");
+	if(f == 0)
+	{
+		free(temporary);
+		return HT_IO_ERROR;
+	}
+
+	ht_snapshot_items_t v = {0};
+	ht_walk(ht,ht_snapshot_collect,&v);
+
+	int ok = ht_snapshot_write(ht,&v,f);
+
+	free(v.items);
+
+	ok = fclose(f) == 0 && ok;
+	ok = ok && rename(temporary,path) == 0;
+
+	if(!ok)
+	{
+		remove(temporary);
+	}
+
+	free(temporary);
+
+	return ok ? HT_SUCCESS : HT_IO_ERROR;
 }
 
 ht_t *
-ht_create_full
+ht_map
+(
+	const char			*path,
+	const ht_hash_function_t	*hash_function
+)
+{
+	int fd = open(path,O_RDONLY);
+	if(fd < 0)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	if(fstat(fd,&st) != 0 || (size_t) st.st_size < sizeof(ht_snapshot_header_t))
+	{
+		close(fd);
+		return 0;
+	}
+
+	size_t length = st.st_size;
+	uint8_t *base = mmap(0,length,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+
+	if(base == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	const ht_snapshot_header_t *h = (const ht_snapshot_header_t *) base;
+	char name[HT_SNAPSHOT_NAME_LENGTH + 1] = {0};
+	memcpy(name,h->hash_function,HT_SNAPSHOT_NAME_LENGTH);
+
+	if(hash_function == 0)
+	{
+		hash_function = ht_find_hash_function(name);
+	}
+
+	uint64_t l = h->table_length;
+	uint64_t n = h->num_of_entries;
+
+	int valid = memcmp(h->magic,HT_SNAPSHOT_MAGIC,sizeof(h->magic)) == 0
+		&& h->version == HT_SNAPSHOT_VERSION
+		&& h->byte_order == HT_SNAPSHOT_BYTE_ORDER
+		&& h->file_length == length
+		&& hash_function != 0
+		&& strcmp(hash_function->name,name) == 0
+		&& l != 0 && (l & (l - 1)) == 0
+		&& h->buckets + (l + 1) * sizeof(uint64_t) <= length
+		&& h->records + n * sizeof(ht_snapshot_record_t) <= length;
+
+	if(!valid)
+	{
+		munmap(base,length);
+		return 0;
+	}
+
+	////////////////////////////////////////
+	//	lookups land anywhere in the file,
+	//		so read ahead would only waste
+	//		page cache
+	////////////////////////////////////////
+	madvise(base,length,MADV_RANDOM);
+
+	ht_map_t *m = malloc(sizeof(ht_map_t));
+	*m = (ht_map_t) {
+		.base		= base,
+		.length		= length,
+		.buckets	= (const uint64_t *) (base + h->buckets),
+		.records	= (const ht_snapshot_record_t *) (base + h->records),
+	};
+
+	ht_t *ht = malloc(sizeof(ht_t));
+
+	*ht = (ht_t) {
+		.layout			= HT_LAYOUT_CHAINED,
+		.map			= m,
+		.min_table_length	= l,
+		.table_length		= l,
+		.hash_size		= h->hash_size,
+		.hash_bits		= ht_hash_bits(h->hash_size),
+		.index_mode		= HT_INDEX_MASK,
+		.index_shift		= 64 - ht_hash_bits(h->hash_size),
+		.node_size		= sizeof(ht_entry_t),
+		.seed			= h->seed,
+		.hash_function		= hash_function,
+		.num_of_entries		= n,
+	};
+
+	return ht;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	NAMESPACES
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_iterate_namespace
+(
+	ht_t		*ht,
+	ht_prefix	*prefix,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		*context
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_PREFIX(prefix);
+	TEST_NULL_ITERATOR(function);
+
+	if(ht->namespace_link == 0)
+	{
+		return HT_NO_NAMESPACES;
+	}
+
+	if(ht->namespaces == 0)
+	{
+		return HT_SUCCESS;
+	}
+
+	ht_namespace_t *space = *ht_ns_find(ht,prefix);
+	ht_entry_t *data = space ? space->entries : 0;
+
+	for(size_t i = 0; data != 0; i++)
+	{
+		function(data->value,data->value_length,data->key,data->key_length,i,context);
+		data = ht_ns_link(ht,data)->next;
+	}
+
+	return HT_SUCCESS;
+}
+
+ht_status_t
+ht_remove_namespace
+(
+	ht_t		*ht,
+	ht_prefix	*prefix,
+	size_t		*removed
+)
+{
+	TEST_NULL_TABLE(ht);
+	TEST_NULL_PREFIX(prefix);
+
+	if(ht->map != 0)
+	{
+		return HT_READ_ONLY_TABLE;
+	}
+
+	if(ht->namespace_link == 0)
+	{
+		return HT_NO_NAMESPACES;
+	}
+
+	size_t n = 0;
+	ht_namespace_t **link = ht->namespaces ? ht_ns_find(ht,prefix) : 0;
+
+	if(link != 0 && *link != 0)
+	{
+		ht_namespace_t *space = *link;
+		ht_entry_t *data = space->entries;
+
+		////////////////////////////////////////
+		//	entries are unlinked from their
+		//		bucket by address, their keys
+		//		are not compared again
+		////////////////////////////////////////
+		while(data)
+		{
+			ht_entry_t *next = ht_ns_link(ht,data)->next;
+			ht_entry_t **bucket = 0;
+
+			if(ht->old_table != 0)
+			{
+				size_t oi = ht_old_index(ht,data->hash);
+				if(oi >= ht->rehash_index)
+				{
+					bucket = ht_v_link_to(&ht->old_table[oi],data);
+				}
+			}
+
+			if(bucket == 0)
+			{
+				bucket = ht_v_link_to(&ht->table[ht_index(ht,data->hash)],data);
+			}
+			*bucket = data->next;
+
+			ht_v_destroy(data,ht);
+			n++;
+
+			data = next;
+		}
+
+		*link = space->next;
+		ht->num_of_namespaces--;
+		free(space);
+
+		ht->num_of_entries -= n;
+		ht_v_shrink(ht);
+	}
+
+	if(removed != 0)
+	{
+		*removed = n;
+	}
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	STATISTICS
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////
+//	what the buckets visited hold, before
+//		scaling to the whole table
+////////////////////////////////////////
+typedef struct
+{
+	size_t	 buckets;
+	size_t	 empty;
+	size_t	 entries;
+	size_t	 probes;
+	size_t	 max;
+	size_t	 keys;
+	size_t	 values;
+	size_t	*histogram;
+} ht_stats_walk_t;
+
+static
+inline
+void
+ht_stats_count
+(
+	ht_stats_walk_t	*w,
+	size_t		 length
+)
+{
+	w->histogram[length < HT_STATS_HISTOGRAM ? length : HT_STATS_HISTOGRAM - 1]++;
+
+	if(length > w->max)
+	{
+		w->max = length;
+	}
+}
+
+////////////////////////////////////////
+//	next pointers are loaded as
+//		ht_cc_find loads them, so
+//		concurrent chains can be walked
+//		in a reader section
+////////////////////////////////////////
+static
+void
+ht_stats_chain
+(
+	ht_t		*ht,
+	ht_stats_walk_t	*w,
+	ht_entry_t	*data
+)
+{
+	size_t length = 0;
+
+	while(data)
+	{
+		length++;
+
+		if(ht->inline_key_length == 0)
+		{
+			w->keys += data->key_length;
+		}
+
+		if(ht->own_values && data->value != ht_v_inline_value(ht,data))
+		{
+			w->values += data->value_length ? data->value_length : 1;
+		}
+
+		data = __atomic_load_n(&data->next,__ATOMIC_ACQUIRE);
+	}
+
+	w->buckets++;
+	w->empty += length == 0;
+	w->entries += length;
+	w->probes += length * (length + 1) / 2;
+
+	ht_stats_count(w,length);
+}
+
+////////////////////////////////////////
+//	a group's full slots count as the
+//		groups probed from their home
+//		group, following ht_oa_find
+////////////////////////////////////////
+static
+void
+ht_stats_group
+(
+	ht_t		*ht,
+	ht_stats_walk_t	*w,
+	size_t		 g
+)
+{
+	size_t groups_mask = ht->table_length / HT_GROUP_WIDTH - 1;
+
+	for(size_t i = g * HT_GROUP_WIDTH; i < (g + 1) * HT_GROUP_WIDTH; i++)
+	{
+		w->buckets++;
+
+		if(ht->control[i] == HT_CTRL_EMPTY)
+		{
+			w->empty++;
+			continue;
+		}
+
+		if(ht->control[i] & 0x80)
+		{
+			continue;
+		}
+
+		ht_slot_t *s = &ht->slots[i];
+		size_t h = s->hash & groups_mask;
+		size_t length = 1;
+
+		for(size_t step = 1; h != g; step++)
+		{
+			h = (h + step) & groups_mask;
+			length++;
+		}
+
+		w->entries++;
+		w->probes += length;
+		w->keys += s->key_length;
+
+		ht_stats_count(w,length);
+	}
+}
+
+////////////////////////////////////////
+//	a cuckoo bucket's entries count as
+//		the buckets looked at to find
+//		them, following ht_ck_find
+//	- units past the last bucket are the
+//		stash, HT_CUCKOO_WAYS slots each,
+//		after both buckets
+////////////////////////////////////////
+static
+void
+ht_stats_cuckoo
 (
-	size_t		table_length,
-	ht_hash_size_t	hash_size,
-	ht_seed_t	seed,
-	void		*extra,
-	void		(*destroy_value)
-			(
-				void	*data,
-				void	*extra
-			),
+	ht_t		*ht,
+	ht_stats_walk_t	*w,
+	size_t		 b
+)
+{
+	size_t buckets = ht_ck_buckets(ht);
+
+	for(size_t i = b * HT_CUCKOO_WAYS; i < (b + 1) * HT_CUCKOO_WAYS; i++)
+	{
+		w->buckets++;
+
+		if(ht->control[i] == HT_CTRL_EMPTY)
+		{
+			w->empty++;
+			continue;
+		}
+
+		size_t home = ht->slots[i].hash & (buckets - 1);
+		size_t length = b >= buckets ? 3 : home == b ? 1 : 2;
+
+		w->entries++;
+		w->probes += length;
+		w->keys += ht->slots[i].key_length;
+
+		ht_stats_count(w,length);
+	}
+}
+
+////////////////////////////////////////
+//	bucket b of a chained table, counting
+//		the new table first, then the old
+//		table's buckets still to be moved
+////////////////////////////////////////
+static
+void
+ht_stats_bucket
+(
+	ht_t		*ht,
+	ht_stats_walk_t	*w,
+	size_t		 b
+)
+{
+	if(ht->map != 0)
+	{
+		size_t length = ht->map->buckets[b + 1] - ht->map->buckets[b];
+
+		w->buckets++;
+		w->empty += length == 0;
+		w->entries += length;
+		w->probes += length * (length + 1) / 2;
+
+		ht_stats_count(w,length);
+		return;
+	}
+
+	if(b < ht->table_length)
+	{
+		ht_stats_chain(ht,w,ht->table[b]);
+	}
+	else
+	{
+		ht_stats_chain(ht,w,ht->old_table[ht->rehash_index + b - ht->table_length]);
+	}
+}
+
+static
+size_t
+ht_stats_slabs
+(
+	ht_slab_t	*s
+)
+{
+	size_t n = 0;
+
+	for(; s != 0; s = s->next)
+	{
+		n += sizeof(ht_slab_t) + s->size;
+	}
+
+	return n;
+}
+
+////////////////////////////////////////
+//	visit every bucket, or units spread
+//		evenly with stride between them
+////////////////////////////////////////
+static
+void
+ht_stats_walk
+(
+	ht_t		*ht,
+	ht_stats_walk_t	*w,
+	size_t		 units,
+	size_t		 sample,
+	ht_cc_table_t	*t
+)
+{
+	size_t stride = sample == 0 || sample >= units ? 1 : units / sample;
+
+	for(size_t u = stride / 2; u < units; u += stride)
+	{
+		if(t != 0)
+		{
+			ht_stats_chain(ht,w,__atomic_load_n(&t->buckets[u],__ATOMIC_ACQUIRE));
+		}
+		else if(ht->layout == HT_LAYOUT_OPEN && ht->map == 0)
+		{
+			ht_stats_group(ht,w,u);
+		}
+		else if(ht->layout == HT_LAYOUT_CUCKOO && ht->map == 0)
+		{
+			ht_stats_cuckoo(ht,w,u);
+		}
+		else
+		{
+			ht_stats_bucket(ht,w,u);
+		}
+	}
+}
+
+ht_status_t
+ht_stats
+(
+	ht_t		*ht,
+	size_t		 sample,
+	ht_stats_t	*stats
+)
+{
+	TEST_NULL_TABLE(ht);
+
+	*stats = (ht_stats_t) {0};
+
+	ht_stats_walk_t w = {
+		.histogram = stats->chain_lengths,
+	};
+	ht_memory_t *m = &stats->memory;
+	size_t buckets;
+
+	m->table = sizeof(ht_t);
+
+	if(ht->cc != 0)
+	{
+		ht_concurrent_t *cc = ht->cc;
+		ht_reader_slot_t *r = ht_cc_enter(cc);
+		ht_cc_table_t *t = __atomic_load_n(&cc->table,__ATOMIC_ACQUIRE);
+
+		buckets = t->length;
+		ht_stats_walk(ht,&w,buckets,sample,t);
+
+		ht_cc_exit(r);
+
+		stats->num_of_entries = __atomic_load_n(&ht->num_of_entries,__ATOMIC_RELAXED);
+		m->table += sizeof(ht_concurrent_t)
+			+ __atomic_load_n(&cc->retired_size,__ATOMIC_RELAXED) * sizeof(ht_retired_t);
+		m->buckets = sizeof(ht_cc_table_t) + buckets * sizeof(ht_entry_t *);
+	}
+	else if(ht->layout == HT_LAYOUT_OPEN && ht->map == 0)
+	{
+		buckets = ht->table_length;
+		ht_stats_walk(ht,&w,buckets / HT_GROUP_WIDTH,sample ? (sample + HT_GROUP_WIDTH - 1) / HT_GROUP_WIDTH : 0,0);
+
+		stats->num_of_entries = ht->num_of_entries;
+		m->buckets = buckets * (1 + sizeof(ht_slot_t));
+	}
+	else if(ht->layout == HT_LAYOUT_CUCKOO && ht->map == 0)
+	{
+		buckets = ht->table_length;
+		ht_stats_walk(ht,&w,buckets / HT_CUCKOO_WAYS,sample ? (sample + HT_CUCKOO_WAYS - 1) / HT_CUCKOO_WAYS : 0,0);
+
+		stats->num_of_entries = ht->num_of_entries;
+		m->buckets = buckets * (1 + sizeof(ht_slot_t) + sizeof(uint64_t));
+	}
+	else
+	{
+		buckets = ht->table_length;
+		if(ht->old_table != 0)
+		{
+			buckets += ht->old_table_length - ht->rehash_index;
+		}
+		ht_stats_walk(ht,&w,buckets,sample,0);
+
+		stats->num_of_entries = ht->num_of_entries;
+
+		if(ht->map != 0)
+		{
+			m->table += sizeof(ht_map_t);
+			m->mapped = ht->map->length;
+		}
+		else
+		{
+			m->buckets = (ht->table_length + ht->old_table_length) * sizeof(ht_entry_t *);
+		}
+	}
+
+	////////////////////////////////////////
+	//	scale what the sample saw up to the
+	//		whole table
+	////////////////////////////////////////
+	double scale = w.buckets ? (double) buckets / w.buckets : 0;
+
+	for(size_t i = 0; i < HT_STATS_HISTOGRAM; i++)
+	{
+		stats->chain_lengths[i] = stats->chain_lengths[i] * scale + 0.5;
+	}
+
+	size_t n = stats->num_of_entries;
+
+	stats->num_of_buckets = buckets;
+	stats->sampled_buckets = w.buckets;
+	stats->load_factor = buckets ? (double) n / buckets : 0;
+	stats->empty_buckets = w.empty * scale + 0.5;
+	stats->empty_bucket_ratio = w.buckets ? (double) w.empty / w.buckets : 0;
+	stats->max_chain_length = w.max;
+	stats->reseeds = ht->reseeds;
+	stats->observed_probe_length = w.entries ? (double) w.probes / w.entries : 0;
+	stats->expected_probe_length = ht->layout != HT_LAYOUT_CHAINED && ht->map == 0
+		? 1
+		: 1 + stats->load_factor / 2;
+
+	////////////////////////////////////////
+	//	entries and keys carved from slabs
+	//		are counted by the slab
+	////////////////////////////////////////
+	if(ht->map == 0)
+	{
+		if(ht->inline_key_length != 0)
+		{
+			m->entries = ht_stats_slabs(ht->node_slabs);
+			m->keys = ht_stats_slabs(ht->key_slabs);
+		}
+		else
+		{
+			m->entries = ht->layout != HT_LAYOUT_CHAINED && ht->cc == 0 ? 0 : n * ht->node_size;
+			m->keys = w.keys * scale + 0.5;
+		}
+		m->values = w.values * scale + 0.5;
+	}
+
+	if(ht->namespaces != 0)
+	{
+		m->namespaces = ht->namespaces_length * sizeof(ht_namespace_t *);
+
+		for(size_t i = 0; i < ht->namespaces_length; i++)
+		{
+			for(ht_namespace_t *space = ht->namespaces[i]; space != 0; space = space->next)
+			{
+				m->namespaces += sizeof(ht_namespace_t) + space->prefix_length;
+			}
+		}
+	}
+
+	m->total = m->table + m->buckets + m->entries + m->keys + m->values + m->namespaces;
+
+	return HT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	INSTRUMENTATION
+////////////////////////////////////////////////////////////////////////////////
+ht_status_t
+ht_instrument_read
+(
+	ht_op_stats_t	stats[HT_NUM_OF_OPS]
+)
+{
+#ifdef HT_INSTRUMENT
+	for(size_t op = 0; op < HT_NUM_OF_OPS; op++)
+	{
+		ht_op_stats_t *s = &ht_op_stats[op];
+		ht_op_stats_t *d = &stats[op];
+
+		d->sampled = 0;
+		d->timed = 0;
+		d->probes = __atomic_load_n(&s->probes,__ATOMIC_RELAXED);
+
+		for(size_t i = 0; i < HT_LATENCY_BUCKETS; i++)
+		{
+			d->latency[i] = __atomic_load_n(&s->latency[i],__ATOMIC_RELAXED);
+			d->timed += d->latency[i];
+		}
+
+		for(size_t i = 0; i < HT_PROBE_BUCKETS; i++)
+		{
+			d->probe_counts[i] = __atomic_load_n(&s->probe_counts[i],__ATOMIC_RELAXED);
+			d->sampled += d->probe_counts[i];
+		}
+	}
+
+	return HT_SUCCESS;
+#else
+	(void) stats;
+
+	return HT_NOT_INSTRUMENTED;
+#endif
+}
+
+ht_status_t
+ht_instrument_reset
+(
+	void
+)
+{
+#ifdef HT_INSTRUMENT
+	for(size_t op = 0; op < HT_NUM_OF_OPS; op++)
+	{
+		ht_op_stats_t *s = &ht_op_stats[op];
+
+		__atomic_store_n(&s->probes,0,__ATOMIC_RELAXED);
+
+		for(size_t i = 0; i < HT_LATENCY_BUCKETS; i++)
+		{
+			__atomic_store_n(&s->latency[i],0,__ATOMIC_RELAXED);
+		}
+
+		for(size_t i = 0; i < HT_PROBE_BUCKETS; i++)
+		{
+			__atomic_store_n(&s->probe_counts[i],0,__ATOMIC_RELAXED);
+		}
+	}
+
+	return HT_SUCCESS;
+#else
+	return HT_NOT_INSTRUMENTED;
+#endif
+}
+
+uint64_t
+ht_latency_bucket_floor
+(
+	size_t	bucket
+)
+{
+	if(bucket < 4)
+	{
+		return bucket;
+	}
+
+	return (uint64_t) (4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	SHARDED TABLES
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////
+//	- shards share hash_function, seed and
+//		hash_size, so any shard can hash
+//		a key for all of them
+//	- the shard is taken from the top of
+//		the first word of a 128 bit hash,
+//		of which cuckoo tables use only
+//		the low bits and others nothing
+//	- otherwise from the word, low bits
+//		for HT_INDEX_FASTRANGE, which
+//		scales by the high ones, and high
+//		bits below the open layout's
+//		control bits for the rest
+//	- each shard's lock and table pointer
+//		share a cache line of their own,
+//		so threads on different shards do
+//		not share a line, and taking the
+//		lock brings in the pointer
+//	- locks are mutexes rather than spin
+//		locks like the stripes, a shard
+//		holds its lock through its own
+//		resize, and waiters should sleep
+//		through it
+//	- keys are hashed with hasher, shard
+//		0, kept apart from the shards so
+//		reading it does not contend with
+//		shard 0's lock
+////////////////////////////////////////
+typedef struct
+{
+	pthread_mutex_t	 mutex;
+	ht_t		*ht;
+} __attribute__((aligned(64))) ht_shard_t;
+
+struct ht_sharded_t
+{
+	ht_shard_t	 *shards;
+	ht_t		 *hasher;
+	size_t		  num_of_shards;
+	int		  first_word;
+	unsigned int	  shard_shift;
+	uint64_t	  shard_mask;
+	void		 *extra;
 	void		(*destroy_extra)
 			(
 				void	*extra
-			)
+			);
+};
+
+static
+inline
+size_t
+ht_shard
+(
+	ht_sharded_t	*st,
+	ht_hash_t	 hash
 )
 {
-	if(table_length <= 0)
+	uint64_t w = st->first_word ? hash.h128[0] : hash.word;
+
+	return (w >> st->shard_shift) & st->shard_mask;
+}
+
+typedef struct
+{
+	ht_sharded_t		*st;
+	ht_iterate_function_t	 function;
+	void			**contexts;
+	size_t			 next_shard;
+} ht_sharded_walk_t;
+
+static
+void
+ht_sharded_iterate_worker
+(
+	void		*context,
+	unsigned int	 index
+)
+{
+	ht_sharded_walk_t *w = context;
+	ht_sharded_t *st = w->st;
+	void *c = w->contexts ? w->contexts[index] : 0;
+
+	for(;;)
 	{
-		return 0;
-	}
+		size_t i = __atomic_fetch_add(&w->next_shard,1,__ATOMIC_RELAXED);
 
-	ht_t *h = malloc(sizeof(ht_t));
+		if(i >= st->num_of_shards)
+		{
+			return;
+		}
 
-	*h = (ht_t) {
-		.table_length		= table_length,
-		.hash_size		= hash_size,
-		.seed			= seed,
-		.num_of_entries		= 0,
-		.extra			= extra,
-		.destroy_value		= destroy_value,
-		.destroy_extra		= destroy_extra,
-	};
+		pthread_mutex_lock(&st->shards[i].mutex);
+		ht_iterate_range(st->shards[i].ht,0,ht_units(st->shards[i].ht),w->function,c);
+		pthread_mutex_unlock(&st->shards[i].mutex);
+	}
+}
 
-	h->table = malloc(table_length * sizeof(ht_entry_t *));
+ht_sharded_t *
+ht_sharded_create
+(
+	size_t			 num_of_shards,
+	size_t			 table_length,
+	ht_hash_size_t		 hash_size,
+	ht_seed_t		 seed,
+	void			*extra,
+	void			(*destroy_value)
+				(
+					void	*data,
+					void	*extra
+				),
+	void			(*destroy_extra)
+				(
+					void	*extra
+				),
+	const ht_options_t	*options
+)
+{
+	if(num_of_shards == 0 || num_of_shards > HT_MAX_SHARDS || table_length == 0)
+	{
+		return 0;
+	}
+
+	ht_options_t o = {0};
+	if(options != 0)
+	{
+		o = *options;
+	}
 
-	for(int i = 0; i < table_length; i++)
+	////////////////////////////////////////
+	//	a reseed would give one shard a
+	//		hash the others don't share,
+	//		and the other two have locks
+	//		or lists of their own
+	////////////////////////////////////////
+	if(o.concurrent || o.namespaces || o.max_chain_length)
 	{
-		h->table[i] = 0;
+		return 0;
 	}
 
-	return h;
-}
+	num_of_shards = ht_round_up_pow2(num_of_shards);
 
-void
-ht_destroy
-(
-	ht_t	*ht
-)
-{
-	if(ht == 0)
+	unsigned int bits = __builtin_ctzll(num_of_shards);
+	unsigned int hash_bits = ht_hash_bits(hash_size);
+
+	ht_sharded_t *st = calloc(1,sizeof(ht_sharded_t));
+	st->shards = aligned_alloc(64,num_of_shards * sizeof(ht_shard_t));
+	st->num_of_shards = num_of_shards;
+	st->shard_mask = num_of_shards - 1;
+	st->extra = extra;
+	st->destroy_extra = destroy_extra;
+
+	if(bits == 0)
 	{
-		return;
+		st->shard_shift = 0;
+	}
+	else if(hash_size == HT_HASH_SIZE_128)
+	{
+		st->first_word = 1;
+		st->shard_shift = 64 - bits;
+	}
+	else if(o.layout == HT_LAYOUT_CHAINED && o.index_mode == HT_INDEX_FASTRANGE)
+	{
+		st->shard_shift = 0;
+	}
+	else if(o.layout == HT_LAYOUT_OPEN)
+	{
+		st->shard_shift = hash_bits - 7 - bits;
+	}
+	else
+	{
+		st->shard_shift = hash_bits - bits;
 	}
 
-	ht_clear_table(ht);
+	size_t length = (table_length + num_of_shards - 1) / num_of_shards;
 
-	if(ht->extra)
+	for(size_t i = 0; i < num_of_shards; i++)
 	{
-		if(ht->destroy_extra)
+		pthread_mutex_init(&st->shards[i].mutex,0);
+		st->shards[i].ht = 0;
+	}
+
+	for(size_t i = 0; i < num_of_shards; i++)
+	{
+		st->shards[i].ht = ht_create_with_options(length,hash_size,seed,extra,destroy_value,0,&o);
+
+		if(st->shards[i].ht == 0)
 		{
-			ht->destroy_extra(ht->extra);
+			st->destroy_extra = 0;
+			ht_sharded_destroy(st);
+			return 0;
 		}
 	}
 
-	free(ht->table);
+	st->hasher = st->shards[0].ht;
 
-	free(ht);
+	return st;
 }
 
-
-////////////////////////////////////////////////////////////////////////////////
-//	MODIFICATION
-////////////////////////////////////////////////////////////////////////////////
-ht_status_t
-ht_add_with_prefix
+void
+ht_sharded_destroy
 (
-	ht_t		*ht,
-	void		*value,
-	size_t		 value_length,
-	const void	*key,
-	size_t		 key_length,
-	ht_prefix	*prefix
+	ht_sharded_t	*st
 )
 {
-	TEST_NULL_TABLE(ht);
-	TEST_NULL_KEY(key);
-	TEST_NULL_VALUE(value);
-
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
-
-	ht_entry_t *vs = ht->table[index];
-
-	void *k;
-	size_t kl = 0;
-	if(prefix != 0)
+	if(st == 0)
 	{
-		kl = key_length + prefix->prefix_length;
-		k = malloc(kl);
-		memcpy(k,prefix->prefix,prefix->prefix_length);
-		memcpy(k + prefix->prefix_length,key,key_length);
+		return;
 	}
-	else
+
+	for(size_t i = 0; i < st->num_of_shards; i++)
 	{
-		kl = key_length;
-		k = malloc(kl);
-		memcpy(k,key,kl);
+		ht_destroy(st->shards[i].ht);
+		pthread_mutex_destroy(&st->shards[i].mutex);
 	}
 
-	ht_entry_t *v = malloc(sizeof(ht_entry_t));
-	*v = (ht_entry_t) {
-		.key = (uint8_t *) k,
-		.key_length = kl,
-		.value = (void *) value,
-		.value_length = value_length,
-		.next = 0,
-	};
-
-	ht_entry_t *data = ht_v_find(vs,v,ht_v_compare);
-
-	if(data != 0)
+	if(st->destroy_extra)
 	{
-		free(v);
-		return HT_KEY_ALREADY_IN_USE;
+		st->destroy_extra(st->extra);
 	}
 
-	ht_v_append(ht,index,v);
-	ht->num_of_entries++;
-
-	return HT_SUCCESS;
+	free(st->shards);
+	free(st);
 }
 
 ht_status_t
-ht_update_with_prefix
+ht_sharded_add_with_prefix
 (
-	ht_t		*ht,
+	ht_sharded_t	*st,
 	void		*value,
 	size_t		 value_length,
 	const void	*key,
@@ -564,49 +9047,30 @@ ht_update_with_prefix
 	ht_prefix	*prefix
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_KEY(key);
 	TEST_NULL_VALUE(value);
 
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
-
-	ht_entry_t *vs = ht->table[index];
+	HT_OP_BEGIN(HT_OP_ADD,key,key_length);
 
-	void *k = malloc(key_length);
-	memcpy(k,key,key_length);
+	ht_hash_t hash = ht_hash(st->hasher,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_ADD,hash);
 
-	ht_entry_t *v = malloc(sizeof(ht_entry_t));
-	*v = (ht_entry_t) {
-		.key = (uint8_t *) k,
-		.key_length = key_length,
-		.value = (void *) value,
-		.value_length = value_length,
-	};
+	size_t i = ht_shard(st,hash);
 
-	ht_entry_t *data = ht_v_find(vs,v,ht_v_compare);
+	pthread_mutex_lock(&st->shards[i].mutex);
+	ht_status_t status = ht_add_hashed(st->shards[i].ht,hash,value,value_length,key,key_length,prefix);
+	pthread_mutex_unlock(&st->shards[i].mutex);
 
-	if(data == 0)
-	{
-		ht_v_append(ht,index,v);
-		ht->num_of_entries++;
-	}
-	else
-	{
-		data->value = value;
-		data->value_length = value_length;
-		free(k);
-		free(v);
-	}
+	HT_OP_END(HT_OP_ADD,status);
 
-	return HT_SUCCESS;
+	return status;
 }
 
 ht_status_t
-ht_update_strict_with_prefix
+ht_sharded_update_with_prefix
 (
-	ht_t		*ht,
+	ht_sharded_t	*st,
 	void		*value,
 	size_t		 value_length,
 	const void	*key,
@@ -614,299 +9078,265 @@ ht_update_strict_with_prefix
 	ht_prefix	*prefix
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_KEY(key);
 	TEST_NULL_VALUE(value);
 
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
-
-	ht_entry_t *vs = ht->table[index];
-
-	ht_entry_t *v = malloc(sizeof(ht_entry_t));
-	*v = (ht_entry_t) {
-		.key = (uint8_t *) key,
-		.key_length = key_length,
-		.value = (void *) value,
-		.value_length = value_length,
-	};
+	HT_OP_BEGIN(HT_OP_UPDATE,key,key_length);
 
-	ht_entry_t *data = ht_v_find(vs,v,ht_v_compare);
+	ht_hash_t hash = ht_hash(st->hasher,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_UPDATE,hash);
 
-	free(v);
+	size_t i = ht_shard(st,hash);
 
-	if(data == 0)
-	{
-		return HT_KEY_NOT_IN_USE;
-	}
+	pthread_mutex_lock(&st->shards[i].mutex);
+	ht_status_t status = ht_update_hashed(st->shards[i].ht,hash,value,value_length,key,key_length,prefix);
+	pthread_mutex_unlock(&st->shards[i].mutex);
 
-	data->value = value;
-	data->value_length = value_length;
+	HT_OP_END(HT_OP_UPDATE,status);
 
-	return HT_SUCCESS;
+	return status;
 }
 
 ht_status_t
-ht_get_with_prefix
+ht_sharded_get_copy_with_prefix
 (
-	ht_t		 *ht,
+	ht_sharded_t	 *st,
 	const void	 *key,
 	size_t		  key_length,
 	void		**destination,
 	size_t		 *value_length,
-	ht_prefix	*prefix
+	ht_prefix	 *prefix
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_KEY(key);
 
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
+	HT_OP_BEGIN(HT_OP_GET,key,key_length);
 
-	ht_entry_t *vs = ht->table[index];
+	ht_hash_t hash = ht_hash(st->hasher,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_GET,hash);
 
-	ht_entry_t v = {
-		.key = (uint8_t *) key,
-		.key_length = key_length,
+	ht_copy_t copy = {
+		.destination = destination,
+		.value_length = destination ? value_length : 0,
 	};
 
-	ht_entry_t *data = ht_v_find(vs,&v,ht_v_compare);
+	size_t i = ht_shard(st,hash);
 
-	if(data == 0)
-	{
-		return HT_KEY_NOT_IN_USE;
-	}
+	pthread_mutex_lock(&st->shards[i].mutex);
+	ht_status_t status = ht_get_copied(st->shards[i].ht,hash,key,key_length,&copy,prefix);
+	pthread_mutex_unlock(&st->shards[i].mutex);
 
-	if(destination != 0)
-	{
-		*destination = data->value;
-		*value_length = data->value_length;
-	}
+	HT_OP_END(HT_OP_GET,status);
 
-	return HT_SUCCESS;
+	return status;
 }
 
 ht_status_t
-ht_get_copy_with_prefix
+ht_sharded_get_into_with_prefix
 (
-	ht_t		 *ht,
-	const void	 *key,
-	size_t		  key_length,
-	void		**destination,
-	size_t		 *value_length,
+	ht_sharded_t	*st,
+	const void	*key,
+	size_t		 key_length,
+	void		*buffer,
+	size_t		 buffer_length,
+	size_t		*value_length,
 	ht_prefix	*prefix
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_KEY(key);
 
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
+	HT_OP_BEGIN(HT_OP_GET,key,key_length);
 
-	ht_entry_t *vs = ht->table[index];
+	ht_hash_t hash = ht_hash(st->hasher,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_GET,hash);
 
-	ht_entry_t v = {
-		.key = (uint8_t *) key,
-		.key_length = key_length,
+	ht_copy_t copy = {
+		.buffer = buffer,
+		.buffer_length = buffer_length,
+		.value_length = value_length,
 	};
 
-	ht_entry_t *data = ht_v_find(vs,&v,ht_v_compare);
+	size_t i = ht_shard(st,hash);
 
-	if(data == 0)
-	{
-		return HT_KEY_NOT_IN_USE;
-	}
+	pthread_mutex_lock(&st->shards[i].mutex);
+	ht_status_t status = ht_get_copied(st->shards[i].ht,hash,key,key_length,&copy,prefix);
+	pthread_mutex_unlock(&st->shards[i].mutex);
 
-	if(destination != 0)
-	{
-		void *value = malloc(data->value_length);
-		strncpy(value,data->value,data->value_length);
-		*destination = value;
-		*value_length = data->value_length;
-	}
+	HT_OP_END(HT_OP_GET,status);
 
-	return HT_SUCCESS;
+	return status;
 }
 
 ht_status_t
-ht_remove_with_prefix
+ht_sharded_remove_with_prefix
 (
-	ht_t		*ht,
+	ht_sharded_t	*st,
 	const void	*key,
 	size_t		 key_length,
 	ht_prefix	*prefix
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_KEY(key);
 
-	ht_hash_t hash = ht_hash(ht,(uint8_t *)key,key_length,prefix);
-
-	size_t index = ht_index(ht,hash);
-
-	ht_entry_t *vs = ht->table[index];
-
-	ht_entry_t v = {
-		.key = (uint8_t *) key,
-		.key_length = key_length,
-	};
-
-	ht_entry_t *data = ht_v_find(vs,&v,ht_v_compare);
+	HT_OP_BEGIN(HT_OP_REMOVE,key,key_length);
 
-	if(data == 0)
-	{
-		return HT_KEY_NOT_IN_USE;
-	}
+	ht_hash_t hash = ht_hash(st->hasher,(uint8_t *)key,key_length,prefix);
+	HT_OP_HASHED(HT_OP_REMOVE,hash);
 
-	if(data == vs)
-	{
-		ht_v_destroy(data,ht);
+	size_t i = ht_shard(st,hash);
 
-		ht->table[index] = 0;
+	pthread_mutex_lock(&st->shards[i].mutex);
+	ht_status_t status = ht_remove_hashed(st->shards[i].ht,hash,key,key_length,prefix);
+	pthread_mutex_unlock(&st->shards[i].mutex);
 
-		ht->num_of_entries--;
+	HT_OP_END(HT_OP_REMOVE,status);
 
+	return status;
+}
 
-		return HT_SUCCESS;
-	}
+ht_status_t
+ht_sharded_clear_table
+(
+	ht_sharded_t	*st
+)
+{
+	TEST_NULL_TABLE(st);
 
-	ht_entry_t *prev = vs;
-	while(prev)
+	for(size_t i = 0; i < st->num_of_shards; i++)
 	{
-		if(prev->next == data)
-		{
-			break;
-		}
-		prev = prev->next;
+		pthread_mutex_lock(&st->shards[i].mutex);
+		ht_clear_table(st->shards[i].ht);
+		pthread_mutex_unlock(&st->shards[i].mutex);
 	}
 
-	prev->next = data->next;
-
-	ht_v_destroy(data,ht);
-
-	ht->num_of_entries--;
-
 	return HT_SUCCESS;
 }
 
 ht_status_t
-ht_clear_table
+ht_sharded_resize_table
 (
-	ht_t		*ht
+	ht_sharded_t	*st,
+	size_t		 num_of_entries
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 
-	size_t l = ht->table_length;
-
-	for(int i = 0; i < l; i++)
+	if(num_of_entries == 0)
 	{
-		ht_entry_t *data = ht->table[i];
-
-		while(data)
-		{
-			ht_entry_t *next = data->next;
-
-			ht_v_destroy(data,ht);
+		return HT_NONPOSITIVE_LENGTH;
+	}
 
-			data = next;
-		}
+	size_t length = (num_of_entries + st->num_of_shards - 1) / st->num_of_shards;
 
-		ht->table[i] = 0;
+	for(size_t i = 0; i < st->num_of_shards; i++)
+	{
+		pthread_mutex_lock(&st->shards[i].mutex);
+		ht_resize_table(st->shards[i].ht,length);
+		pthread_mutex_unlock(&st->shards[i].mutex);
 	}
 
-	ht->num_of_entries = 0;
-
 	return HT_SUCCESS;
 }
 
 ht_status_t
-ht_resize_table
+ht_sharded_stats
 (
-	ht_t		*ht,
-	size_t		 table_length
+	ht_sharded_t	*st,
+	size_t		 sample,
+	ht_stats_t	*stats
 )
 {
-	TEST_NULL_TABLE(ht);
-
-	size_t l = ht->table_length;
-	ht_entry_t **ot = ht->table;
+	TEST_NULL_TABLE(st);
 
-	ht_entry_t **nt = malloc(table_length * sizeof(ht_entry_t *));
-	for(int i = 0; i < table_length; i++)
-	{
-		nt[i] = 0;
-	}
+	*stats = (ht_stats_t) {0};
 
-	ht->table = nt;
-	ht->table_length = table_length;
+	ht_memory_t *m = &stats->memory;
+	double expected = 0;
+	double observed = 0;
+	size_t per = sample ? (sample + st->num_of_shards - 1) / st->num_of_shards : 0;
 
-	for(int i = 0; i < l; i++)
+	for(size_t i = 0; i < st->num_of_shards; i++)
 	{
-		ht_entry_t *data = ot[i];
+		ht_stats_t s;
 
-		while(data)
-		{
-			ht_entry_t *next = data->next;
+		pthread_mutex_lock(&st->shards[i].mutex);
+		ht_stats(st->shards[i].ht,per,&s);
+		pthread_mutex_unlock(&st->shards[i].mutex);
 
-			ht_add(
-				ht,
-				data->value,
-				data->value_length,
-				data->key,
-				data->key_length
-			);
+		stats->num_of_entries += s.num_of_entries;
+		stats->num_of_buckets += s.num_of_buckets;
+		stats->sampled_buckets += s.sampled_buckets;
+		stats->empty_buckets += s.empty_buckets;
+		stats->reseeds += s.reseeds;
 
-			ht_v_destroy(data,ht);
+		for(size_t j = 0; j < HT_STATS_HISTOGRAM; j++)
+		{
+			stats->chain_lengths[j] += s.chain_lengths[j];
+		}
 
-			data = next;
+		if(s.max_chain_length > stats->max_chain_length)
+		{
+			stats->max_chain_length = s.max_chain_length;
 		}
+
+		expected += s.expected_probe_length * s.num_of_entries;
+		observed += s.observed_probe_length * s.num_of_entries;
+
+		m->table += s.memory.table;
+		m->buckets += s.memory.buckets;
+		m->entries += s.memory.entries;
+		m->keys += s.memory.keys;
+		m->values += s.memory.values;
+		m->namespaces += s.memory.namespaces;
+		m->mapped += s.memory.mapped;
+		m->total += s.memory.total;
 	}
 
-	free(ot);
+	size_t n = stats->num_of_entries;
+	size_t own = sizeof(ht_sharded_t) + st->num_of_shards * sizeof(ht_shard_t);
+
+	stats->load_factor = stats->num_of_buckets ? (double) n / stats->num_of_buckets : 0;
+	stats->empty_bucket_ratio = stats->num_of_buckets ? (double) stats->empty_buckets / stats->num_of_buckets : 0;
+	stats->expected_probe_length = n ? expected / n : 0;
+	stats->observed_probe_length = n ? observed / n : 0;
+
+	m->table += own;
+	m->total += own;
 
 	return HT_SUCCESS;
 }
 
 ht_status_t
-ht_iterate
+ht_sharded_parallel_iterate
 (
-	ht_t	*ht,
-	void	(*function)
-		(
-			void	*value,
-			size_t	 value_length,
-			void	*key,
-			size_t	 key_length,
-			size_t	 index
-		)
+	ht_sharded_t	 *st,
+	unsigned int	  threads,
+	void		(*function)
+			(
+				void	*value,
+				size_t	 value_length,
+				void	*key,
+				size_t	 key_length,
+				size_t	 index,
+				void	*context
+			),
+	void		**contexts
 )
 {
-	TEST_NULL_TABLE(ht);
+	TEST_NULL_TABLE(st);
 	TEST_NULL_ITERATOR(function);
 
-	size_t l = ht->table_length;
-
-	for(int i = 0; i < l; i++)
-	{
-		ht_entry_t *data = ht->table[i];
-
-		while(data)
-		{
-			function(
-				data->value,
-				data->value_length,
-				data->key,
-				data->key_length,
-				i
-			);
+	ht_sharded_walk_t w = {
+		.st		= st,
+		.function	= function,
+		.contexts	= contexts,
+	};
 
-			data = data->next;
-		}
-	}
+	ht_parallel(threads,ht_sharded_iterate_worker,&w);
 
 	return HT_SUCCESS;
 }
@@ -926,14 +9356,11 @@ ht_create_prefix
 	void *kp = malloc(key_prefix_length);
 	memcpy(kp,key_prefix,key_prefix_length);
 
-	spookyhash_state_t *h = malloc(sizeof(spookyhash_state_t));
-	spookyhash_init(h,0,0);
-	spookyhash_update(h,key_prefix,key_prefix_length);
-
 	*p = (ht_prefix) {
 		.prefix		= kp,
 		.prefix_length	= key_prefix_length,
-		.state		= h,
+		.id		= spookyhash64(kp,key_prefix_length,0),
+		.cache		= 0,
 	};
 
 	return p;
@@ -950,13 +9377,11 @@ ht_clone_prefix
 	void *key_prefix = malloc(prefix->prefix_length);
 	memcpy(key_prefix,prefix->prefix,prefix->prefix_length);
 
-	spookyhash_state_t *state = malloc(sizeof(spookyhash_state_t));
-	spookyhash_clone_state(prefix->state,state);
-
 	*p = (ht_prefix) {
 		.prefix		= key_prefix,
 		.prefix_length	= prefix->prefix_length,
-		.state		= state,
+		.id		= prefix->id,
+		.cache		= 0,
 	};
 
 	return p;
@@ -972,13 +9397,12 @@ ht_append_prefix
 {
 	ht_prefix *p = ht_clone_prefix(prefix);
 
-	spookyhash_update(p->state,key_prefix_appendage,key_prefix_appendage_length);
-
 	size_t pl = p->prefix_length + key_prefix_appendage_length;
 	p->prefix = realloc(p->prefix,pl);
 	memcpy(p->prefix + p->prefix_length,key_prefix_appendage,key_prefix_appendage_length);
 
 	p->prefix_length += key_prefix_appendage_length;
+	p->id = spookyhash64(p->prefix,p->prefix_length,0);
 
 	return p;
 }
@@ -992,7 +9416,7 @@ ht_destroy_prefix
 	TEST_NULL_PREFIX(prefix);
 
 	free(prefix->prefix);
-	free(prefix->state);
+	free(prefix->cache);
 
 	return HT_SUCCESS;
 }
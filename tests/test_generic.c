@@ -0,0 +1,177 @@
+#include "ht_generic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//	HT_GENERIC TESTS
+//	- a u64 table is driven with random operations against an array of the
+//		keys it should hold, a u128 table is filled and read back
+////////////////////////////////////////////////////////////////////////////////
+#define CHECK(condition) \
+	do \
+	{ \
+		if(!(condition)) \
+		{ \
+			fprintf(stderr,"%s:%d: %s: check failed: %s\n", \
+				__FILE__,__LINE__,__func__,#condition); \
+			abort(); \
+		} \
+	} while(0)
+
+typedef struct
+{
+	uint64_t	high;
+	uint64_t	low;
+} key128_t;
+
+HT_GENERIC(u64,uint64_t,long,ht_generic_hash_u64,ht_generic_equal_u64)
+HT_GENERIC(uuid,key128_t,int,ht_generic_hash_u128,ht_generic_equal_u128)
+
+#define KEYS	5000
+#define OPS	400000
+
+static long expected[KEYS];
+static int present[KEYS];
+
+static
+uint64_t
+rnd
+(
+	uint64_t	*state
+)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static
+void
+visit
+(
+	uint64_t	*key,
+	long		*value,
+	void		*context
+)
+{
+	uint64_t k = *key >> 32;
+	CHECK(k < KEYS && present[k] && expected[k] == *value);
+	(*(size_t *) context)++;
+}
+
+static
+void
+test_u64
+(
+	void
+)
+{
+	uint64_t rng = 1;
+
+	for(int round = 0; round < 3; round++)
+	{
+		u64_t *t = u64_create(round * 10,round);
+		size_t entries = 0, visited = 0;
+
+		CHECK(t != 0);
+		memset(present,0,sizeof(present));
+		for(int op = 0; op < OPS; op++)
+		{
+			uint64_t k = rnd(&rng) % KEYS;
+			uint64_t key = k << 32;
+			long value = rnd(&rng), found;
+			ht_status_t status;
+
+			switch(rnd(&rng) % 5)
+			{
+			case 0:
+				status = u64_add(t,key,value);
+				CHECK(status == (present[k] ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS));
+				if(!present[k])
+				{
+					present[k] = 1;
+					expected[k] = value;
+				}
+				break;
+			case 1:
+				CHECK(u64_update(t,key,value) == HT_SUCCESS);
+				present[k] = 1;
+				expected[k] = value;
+				break;
+			case 2:
+				status = u64_get(t,key,&found);
+				CHECK(status == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+				CHECK(status != HT_SUCCESS || found == expected[k]);
+				CHECK((u64_find(t,key) != 0) == present[k]);
+				break;
+			case 3:
+				CHECK(u64_remove(t,key) == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+				present[k] = 0;
+				break;
+			default:
+				if(rnd(&rng) % 20000 == 0)
+				{
+					u64_clear(t);
+					memset(present,0,sizeof(present));
+					break;
+				}
+				status = u64_update_strict(t,key,value);
+				CHECK(status == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+				if(present[k])
+				{
+					expected[k] = value;
+				}
+				break;
+			}
+		}
+
+		for(int k = 0; k < KEYS; k++)
+		{
+			entries += present[k];
+		}
+		u64_iterate(t,visit,&visited);
+		CHECK(visited == entries);
+		CHECK(u64_size(t) == entries);
+		u64_destroy(t);
+	}
+}
+
+static
+void
+test_uuid
+(
+	void
+)
+{
+	uuid_t *t = uuid_create(0,7);
+	key128_t missing = { 1, 1 };
+
+	for(int i = 0; i < 100000; i++)
+	{
+		key128_t key = { i, ~(uint64_t) i };
+		CHECK(uuid_add(t,key,i) == HT_SUCCESS);
+	}
+	for(int i = 0; i < 100000; i++)
+	{
+		key128_t key = { i, ~(uint64_t) i };
+		int value;
+		CHECK(uuid_get(t,key,&value) == HT_SUCCESS && value == i);
+	}
+	CHECK(uuid_find(t,missing) == 0);
+	CHECK(uuid_size(t) == 100000);
+	uuid_destroy(t);
+}
+
+int
+main
+(
+	void
+)
+{
+	test_u64();
+	test_uuid();
+	printf("generic tests passed\n");
+	return 0;
+}
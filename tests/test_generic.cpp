@@ -0,0 +1,98 @@
+#include "ht_generic.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////////////
+//	ht::table TESTS
+//	- driven with random operations against std::unordered_map
+////////////////////////////////////////////////////////////////////////////////
+#define CHECK(condition) \
+	do \
+	{ \
+		if(!(condition)) \
+		{ \
+			std::fprintf(stderr,"%s:%d: %s: check failed: %s\n", \
+				__FILE__,__LINE__,__func__,#condition); \
+			std::abort(); \
+		} \
+	} while(0)
+
+struct uuid
+{
+	uint64_t	high;
+	uint64_t	low;
+};
+
+static
+uint64_t
+rnd
+(
+	uint64_t	&state
+)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+int
+main()
+{
+	ht::table<uint64_t,double> t;
+	std::unordered_map<uint64_t,double> m;
+	uint64_t rng = 1;
+
+	for(int op = 0; op < 300000; op++)
+	{
+		uint64_t k = rnd(rng) % 3000;
+		double v = rnd(rng);
+
+		switch(rnd(rng) % 4)
+		{
+		case 0:
+			CHECK(t.add(k,v) == (m.count(k) ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS));
+			m.emplace(k,v);
+			break;
+		case 1:
+			CHECK(t.update(k,v) == HT_SUCCESS);
+			m[k] = v;
+			break;
+		case 2:
+			{
+				double *found = t.find(k);
+				CHECK(m.count(k) ? found != 0 && *found == m[k] : found == 0);
+			}
+			break;
+		default:
+			CHECK(t.remove(k) == (m.erase(k) ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+			break;
+		}
+	}
+
+	size_t visited = 0;
+	t.iterate([&](uint64_t k,double v)
+	{
+		CHECK(m.at(k) == v);
+		visited++;
+	});
+	CHECK(visited == m.size() && t.size() == visited);
+
+	ht::table<uuid,int,ht::mix_hash<uuid>,ht::bytes_equal<uuid>> u(100,3);
+	int value;
+	for(int i = 0; i < 1000; i++)
+	{
+		CHECK(u.add(uuid{ (uint64_t) i, 2 },i) == HT_SUCCESS);
+	}
+	CHECK(u.get(uuid{ 5, 2 },value) == HT_SUCCESS && value == 5);
+
+	ht::table<uuid,int,ht::mix_hash<uuid>,ht::bytes_equal<uuid>> moved(std::move(u));
+	CHECK(moved.size() == 1000);
+	moved.clear();
+	CHECK(moved.size() == 0 && moved.find(uuid{ 5, 2 }) == 0);
+
+	std::printf("ht::table tests passed\n");
+	return 0;
+}
@@ -0,0 +1,2229 @@
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//	TESTS
+//	- ./test_ht runs every test, ./test_ht name... runs the ones named
+//	- checks abort with the failing expression, so a test stops at the first
+//		failure and the sanitizers can report the stack
+//	- built twice by make test, once against a library built with
+//		HT_INSTRUMENT, test_instrument checks the counts only then
+////////////////////////////////////////////////////////////////////////////////
+#define CHECK(condition) \
+	do \
+	{ \
+		if(!(condition)) \
+		{ \
+			fprintf(stderr,"%s:%d: %s: check failed: %s\n", \
+				__FILE__,__LINE__,__func__,#condition); \
+			abort(); \
+		} \
+	} while(0)
+
+static const ht_hash_size_t hash_sizes[] =
+{
+	HT_HASH_SIZE_32,
+	HT_HASH_SIZE_64,
+	HT_HASH_SIZE_64_DIFFUSE_32,
+	HT_HASH_SIZE_128,
+	HT_HASH_SIZE_128_DIFFUSE_64,
+	HT_HASH_SIZE_128_DIFFUSE_32,
+};
+#define NUM_OF_HASH_SIZES	(sizeof(hash_sizes) / sizeof(hash_sizes[0]))
+
+static
+uint64_t
+rnd
+(
+	uint64_t	*state
+)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static
+ht_seed_t
+make_seed
+(
+	uint64_t	s
+)
+{
+	ht_seed_t seed;
+	seed.s128[0] = s;
+	seed.s128[1] = s * 0x9e3779b97f4a7c15ULL + 1;
+	return seed;
+}
+
+static
+char *
+snapshot_path
+(
+	const char	*name
+)
+{
+	static char path[256];
+	snprintf(path,sizeof(path),"/tmp/ht_test_%d_%s.snap",(int) getpid(),name);
+	return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	MODEL
+//	- a table is driven with random operations and checked after each one
+//		against an array of the keys it should hold
+//	- keys carry their index in their first two bytes, odd keys start with
+//		"pre:" and are used through a prefix or in full at random
+//	- values are records of up to RECORD bytes holding a number, pointed
+//		into a pool, or copied for own_values tables
+////////////////////////////////////////////////////////////////////////////////
+#define MODEL_KEYS	3000
+#define MODEL_OPS	40000
+#define MODEL_POOL	(1 << 18)
+#define MODEL_BATCH	32
+#define RECORD		40
+
+typedef struct
+{
+	long	number;
+	char	pad[RECORD - sizeof(long)];
+} record_t;
+
+typedef struct
+{
+	const char	*name;
+	ht_options_t	 options;
+} model_config_t;
+
+static const model_config_t model_configs[] =
+{
+	{ "chained fixed",	{ 0 } },
+	{ "chained grow",	{ .max_load_factor = 0.75, .min_load_factor = 0.2 } },
+	{ "chained mask",	{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .index_mode = HT_INDEX_MASK } },
+	{ "chained fastrange",	{ .max_load_factor = 2, .min_load_factor = 0.1,
+				  .index_mode = HT_INDEX_FASTRANGE } },
+	{ "pooled",		{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .index_mode = HT_INDEX_MASK,
+				  .inline_key_length = 16 } },
+	{ "pooled fixed",	{ .inline_key_length = 24 } },
+	{ "open",		{ .layout = HT_LAYOUT_OPEN } },
+	{ "open wyhash",	{ .layout = HT_LAYOUT_OPEN,
+				  .hash_function = &ht_hash_wyhash } },
+	{ "cuckoo",		{ .layout = HT_LAYOUT_CUCKOO } },
+	{ "cuckoo mix64",	{ .layout = HT_LAYOUT_CUCKOO,
+				  .hash_function = &ht_hash_mix64 } },
+	{ "concurrent",		{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .concurrent = 1 } },
+	{ "concurrent mask",	{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .index_mode = HT_INDEX_MASK, .concurrent = 1 } },
+	{ "mix64",		{ .max_load_factor = 1,
+				  .hash_function = &ht_hash_mix64 } },
+	{ "namespaces",		{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .namespaces = 1 } },
+	{ "own values",		{ .max_load_factor = 1, .min_load_factor = 0.25,
+				  .own_values = 1, .inline_value_length = 16 } },
+	{ "own values pooled",	{ .own_values = 1, .inline_key_length = 16,
+				  .index_mode = HT_INDEX_FASTRANGE } },
+	{ "reseed",		{ .max_chain_length = 4 } },
+	{ "reseed pooled",	{ .max_chain_length = 4, .inline_key_length = 16,
+				  .index_mode = HT_INDEX_MASK } },
+};
+#define NUM_OF_MODEL_CONFIGS	(sizeof(model_configs) / sizeof(model_configs[0]))
+
+typedef struct
+{
+	ht_t		*ht;
+	ht_prefix	*prefix;
+	int		 own_values;
+	uint64_t	 rng;
+
+	char		 keys[MODEL_KEYS][48];
+	size_t		 key_lengths[MODEL_KEYS];
+	int		 present[MODEL_KEYS];
+	long		 numbers[MODEL_KEYS];
+	size_t		 lengths[MODEL_KEYS];
+
+	record_t	 pool[MODEL_POOL];
+	size_t		 pool_used;
+
+	unsigned char	 seen[MODEL_KEYS];
+	size_t		 visits;
+} model_t;
+
+static
+record_t *
+model_record
+(
+	model_t	*m,
+	long	 number
+)
+{
+	CHECK(m->pool_used < MODEL_POOL);
+	record_t *r = &m->pool[m->pool_used++];
+	r->number = number;
+	memset(r->pad,(int) number,sizeof(r->pad));
+	return r;
+}
+
+static
+int
+model_key_index
+(
+	const void	*key,
+	size_t		 key_length
+)
+{
+	const unsigned char *k = key;
+	if(key_length >= 6 && memcmp(k,"pre:",4) == 0)
+	{
+		k += 4;
+	}
+	return k[0] | ((k[1] & 0x3f) << 8);
+}
+
+static
+void
+model_check_value
+(
+	model_t		*m,
+	int		 i,
+	const void	*value,
+	size_t		 value_length
+)
+{
+	const record_t *r = value;
+	CHECK(m->present[i]);
+	CHECK(value_length == m->lengths[i]);
+	CHECK(r->number == m->numbers[i]);
+	if(value_length > sizeof(long))
+	{
+		CHECK((unsigned char) r->pad[value_length - sizeof(long) - 1]
+			== (unsigned char) m->numbers[i]);
+	}
+}
+
+static
+void
+model_visit
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	model_t *m = context;
+	int i = model_key_index(key,key_length);
+	(void) index;
+
+	CHECK(key_length == m->key_lengths[i]);
+	CHECK(memcmp(key,m->keys[i],key_length) == 0);
+	model_check_value(m,i,value,value_length);
+	if(m->seen[i] < 255)
+	{
+		m->seen[i]++;
+	}
+	m->visits++;
+}
+
+static
+void
+model_merge
+(
+	void	**value,
+	size_t	 *value_length,
+	void	 *context
+)
+{
+	record_t *next = context;
+	const record_t *stored = *value;
+	long number = stored->number + 1;
+
+	next->number = number;
+	memset(next->pad,(int) number,sizeof(next->pad));
+	*value = next;
+	*value_length = sizeof(long) + 8;
+}
+
+////////////////////////////////////////////////////////////
+//	the key to pass for key i
+//	- odd keys go through the prefix half the time
+////////////////////////////////////////////////////////////
+static
+ht_prefix *
+model_key
+(
+	model_t		 *m,
+	int		  i,
+	const void	**key,
+	size_t		 *key_length
+)
+{
+	if((i & 1) && rnd(&m->rng) % 2)
+	{
+		*key = m->keys[i] + 4;
+		*key_length = m->key_lengths[i] - 4;
+		return m->prefix;
+	}
+	*key = m->keys[i];
+	*key_length = m->key_lengths[i];
+	return 0;
+}
+
+static
+void
+model_expect
+(
+	model_t	*m,
+	int	 i
+)
+{
+	const void *key;
+	size_t key_length;
+	ht_prefix *prefix = model_key(m,i,&key,&key_length);
+	void *value;
+	size_t value_length;
+	ht_status_t status = ht_get_with_prefix(m->ht,key,key_length,&value,&value_length,prefix);
+
+	if(m->present[i])
+	{
+		CHECK(status == HT_SUCCESS);
+		model_check_value(m,i,value,value_length);
+	}
+	else
+	{
+		CHECK(status == HT_KEY_NOT_IN_USE);
+	}
+}
+
+static
+void
+model_check_all
+(
+	model_t	*m
+)
+{
+	size_t expected = 0;
+
+	for(int i = 0; i < MODEL_KEYS; i++)
+	{
+		model_expect(m,i);
+		expected += m->present[i];
+	}
+
+	memset(m->seen,0,sizeof(m->seen));
+	m->visits = 0;
+	CHECK(ht_iterate_with_context(m->ht,model_visit,m) == HT_SUCCESS);
+	CHECK(m->visits == expected);
+}
+
+static
+void
+model_step
+(
+	model_t	*m
+)
+{
+	int i = rnd(&m->rng) % MODEL_KEYS;
+	long number = rnd(&m->rng) % 100000;
+	size_t length = sizeof(long) + 8 * (rnd(&m->rng) % 5);
+	const void *key;
+	size_t key_length;
+	ht_prefix *prefix = model_key(m,i,&key,&key_length);
+	ht_status_t status;
+	void *value;
+	size_t value_length;
+
+	switch(rnd(&m->rng) % 12)
+	{
+	case 0:
+	case 1:
+		status = ht_add_with_prefix(m->ht,model_record(m,number),length,key,key_length,prefix);
+		if(m->present[i])
+		{
+			CHECK(status == HT_KEY_ALREADY_IN_USE);
+			break;
+		}
+		CHECK(status == HT_SUCCESS);
+		m->present[i] = 1;
+		m->numbers[i] = number;
+		m->lengths[i] = length;
+		break;
+	case 2:
+		status = ht_update_with_prefix(m->ht,model_record(m,number),length,key,key_length,prefix);
+		CHECK(status == HT_SUCCESS);
+		m->present[i] = 1;
+		m->numbers[i] = number;
+		m->lengths[i] = length;
+		break;
+	case 3:
+		status = ht_update_strict_with_prefix(m->ht,model_record(m,number),length,key,key_length,prefix);
+		CHECK(status == (m->present[i] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+		if(m->present[i])
+		{
+			m->numbers[i] = number;
+			m->lengths[i] = length;
+		}
+		break;
+	case 4:
+	case 5:
+		status = ht_remove_with_prefix(m->ht,key,key_length,prefix);
+		CHECK(status == (m->present[i] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+		m->present[i] = 0;
+		break;
+	case 6:
+		status = ht_get_with_prefix(m->ht,key,key_length,&value,&value_length,prefix);
+		CHECK(status == (m->present[i] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+		if(status == HT_SUCCESS)
+		{
+			model_check_value(m,i,value,value_length);
+		}
+		break;
+	case 7:
+		status = ht_get_copy_with_prefix(m->ht,key,key_length,&value,&value_length,prefix);
+		CHECK(status == (m->present[i] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+		if(status == HT_SUCCESS)
+		{
+			model_check_value(m,i,value,value_length);
+			free(value);
+		}
+		break;
+	case 8:
+		{
+			record_t buffer;
+			status = ht_get_into_with_prefix(m->ht,key,key_length,&buffer,sizeof(long),&value_length,prefix);
+			if(!m->present[i])
+			{
+				CHECK(status == HT_KEY_NOT_IN_USE);
+				break;
+			}
+			CHECK(value_length == m->lengths[i]);
+			CHECK(status == (value_length > sizeof(long) ? HT_BUFFER_TOO_SMALL : HT_SUCCESS));
+			status = ht_get_into_with_prefix(m->ht,key,key_length,&buffer,sizeof(buffer),&value_length,prefix);
+			CHECK(status == HT_SUCCESS);
+			model_check_value(m,i,&buffer,value_length);
+		}
+		break;
+	case 9:
+		{
+			int inserted;
+			status = ht_get_or_insert_with_prefix(m->ht,model_record(m,number),length,key,key_length,
+				&value,&value_length,&inserted,prefix);
+			CHECK(status == HT_SUCCESS);
+			CHECK(inserted == !m->present[i]);
+			if(inserted)
+			{
+				m->present[i] = 1;
+				m->numbers[i] = number;
+				m->lengths[i] = length;
+			}
+			model_check_value(m,i,value,value_length);
+		}
+		break;
+	case 10:
+		{
+			int inserted;
+			status = ht_upsert_with_prefix(m->ht,model_record(m,number),length,key,key_length,
+				model_merge,model_record(m,0),&inserted,prefix);
+			CHECK(status == HT_SUCCESS);
+			CHECK(inserted == !m->present[i]);
+			if(inserted)
+			{
+				m->present[i] = 1;
+				m->numbers[i] = number;
+				m->lengths[i] = length;
+			}
+			else
+			{
+				m->numbers[i]++;
+				m->lengths[i] = sizeof(long) + 8;
+			}
+		}
+		break;
+	default:
+		{
+			const void *keys[MODEL_BATCH];
+			size_t key_lengths[MODEL_BATCH];
+			void *values[MODEL_BATCH];
+			size_t value_lengths[MODEL_BATCH];
+			ht_status_t statuses[MODEL_BATCH];
+			int index[MODEL_BATCH];
+			size_t count = 1 + rnd(&m->rng) % MODEL_BATCH;
+			int prefixed = rnd(&m->rng) % 3 == 0;
+
+			////////////////////////////////////////
+			//	a prefixed batch is odd keys only
+			for(size_t q = 0; q < count; q++)
+			{
+				index[q] = rnd(&m->rng) % MODEL_KEYS;
+				if(prefixed)
+				{
+					index[q] |= 1;
+				}
+				keys[q] = m->keys[index[q]] + (prefixed ? 4 : 0);
+				key_lengths[q] = m->key_lengths[index[q]] - (prefixed ? 4 : 0);
+			}
+
+			if(rnd(&m->rng) % 2)
+			{
+				ht_get_many_with_prefix(m->ht,count,keys,key_lengths,values,value_lengths,
+					statuses,prefixed ? m->prefix : 0);
+				for(size_t q = 0; q < count; q++)
+				{
+					CHECK(statuses[q] == (m->present[index[q]] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+					if(statuses[q] == HT_SUCCESS)
+					{
+						model_check_value(m,index[q],values[q],value_lengths[q]);
+					}
+				}
+				break;
+			}
+
+			for(size_t q = 0; q < count; q++)
+			{
+				values[q] = model_record(m,number + q);
+				value_lengths[q] = length;
+			}
+			ht_add_many_with_prefix(m->ht,count,values,value_lengths,keys,key_lengths,
+				statuses,prefixed ? m->prefix : 0);
+			for(size_t q = 0; q < count; q++)
+			{
+				if(m->present[index[q]])
+				{
+					CHECK(statuses[q] == HT_KEY_ALREADY_IN_USE);
+					continue;
+				}
+				CHECK(statuses[q] == HT_SUCCESS);
+				m->present[index[q]] = 1;
+				m->numbers[index[q]] = number + q;
+				m->lengths[index[q]] = length;
+			}
+		}
+		break;
+	}
+}
+
+static
+void
+model_run
+(
+	const model_config_t	*config,
+	ht_hash_size_t		 hash_size,
+	uint64_t		 seed
+)
+{
+	static model_t m;
+	ht_stats_t stats;
+	size_t entries = 0;
+
+	memset(&m,0,sizeof(m));
+	m.rng = seed * 0x2545f4914f6cdd1dULL + 1;
+	m.ht = ht_create_with_options(7,hash_size,make_seed(seed),0,0,0,&config->options);
+	if(config->options.layout == HT_LAYOUT_CUCKOO && hash_size != HT_HASH_SIZE_128)
+	{
+		CHECK(m.ht == 0);
+		return;
+	}
+	CHECK(m.ht != 0);
+	m.prefix = ht_create_prefix("pre:",4);
+	m.own_values = config->options.own_values;
+
+	for(int i = 0; i < MODEL_KEYS; i++)
+	{
+		size_t at = (i & 1) ? 4 : 0;
+		if(at)
+		{
+			memcpy(m.keys[i],"pre:",4);
+		}
+		m.key_lengths[i] = at + 2 + rnd(&m.rng) % 40;
+		m.keys[i][at] = i & 0xff;
+		m.keys[i][at + 1] = (i >> 8) | 0x40;
+		for(size_t j = at + 2; j < m.key_lengths[i]; j++)
+		{
+			m.keys[i][j] = rnd(&m.rng) % 4;
+		}
+	}
+
+	for(int op = 0; op < MODEL_OPS; op++)
+	{
+		model_step(&m);
+
+		if(op % 5000 == 4999)
+		{
+			model_check_all(&m);
+		}
+		if(rnd(&m.rng) % 4000 == 0)
+		{
+			CHECK(ht_resize_table(m.ht,1 + rnd(&m.rng) % 5000) == HT_SUCCESS);
+		}
+		if(rnd(&m.rng) % 20000 == 0)
+		{
+			CHECK(ht_clear_table(m.ht) == HT_SUCCESS);
+			memset(m.present,0,sizeof(m.present));
+		}
+	}
+	model_check_all(&m);
+
+	for(int i = 0; i < MODEL_KEYS; i++)
+	{
+		entries += m.present[i];
+	}
+	CHECK(ht_stats(m.ht,0,&stats) == HT_SUCCESS);
+	CHECK(stats.num_of_entries == entries);
+
+	////////////////////////////////////////
+	//	a cursor walk sees every entry
+	{
+		ht_cursor_t cursor = { 0 };
+		memset(m.seen,0,sizeof(m.seen));
+		while(!cursor.finished)
+		{
+			CHECK(ht_cursor_next(m.ht,&cursor,13,model_visit,&m) == HT_SUCCESS);
+		}
+		for(int i = 0; i < MODEL_KEYS; i++)
+		{
+			CHECK((m.seen[i] != 0) == m.present[i]);
+		}
+	}
+
+	////////////////////////////////////////
+	//	the snapshot finds the same keys
+	{
+		const char *path = snapshot_path("model");
+		ht_t *table = m.ht;
+		CHECK(ht_save(m.ht,path) == HT_SUCCESS);
+		m.ht = ht_map(path,config->options.hash_function);
+		CHECK(m.ht != 0);
+		unlink(path);
+		model_check_all(&m);
+		CHECK(ht_add(m.ht,model_record(&m,0),8,"x",1) == HT_READ_ONLY_TABLE);
+		CHECK(ht_remove(m.ht,m.keys[0],m.key_lengths[0]) == HT_READ_ONLY_TABLE);
+		CHECK(ht_clear_table(m.ht) == HT_READ_ONLY_TABLE);
+		ht_destroy(m.ht);
+		m.ht = table;
+	}
+
+	ht_destroy(m.ht);
+	ht_destroy_prefix(m.prefix);
+	free(m.prefix);
+}
+
+static
+void
+test_model
+(
+	void
+)
+{
+	for(size_t c = 0; c < NUM_OF_MODEL_CONFIGS; c++)
+	{
+		for(size_t h = 0; h < NUM_OF_HASH_SIZES; h++)
+		{
+			model_run(&model_configs[c],hash_sizes[h],c * NUM_OF_HASH_SIZES + h + 1);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	OPTIONS
+////////////////////////////////////////////////////////////////////////////////
+static
+void
+test_options
+(
+	void
+)
+{
+	ht_seed_t seed = make_seed(1);
+	ht_stats_t stats;
+	ht_options_t o;
+	ht_t *ht;
+
+	CHECK(ht_create(0,HT_HASH_SIZE_64,seed) == 0);
+
+	memset(&o,0,sizeof(o));
+	o.layout = HT_LAYOUT_OPEN;
+	o.concurrent = 1;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+
+	memset(&o,0,sizeof(o));
+	o.layout = HT_LAYOUT_OPEN;
+	o.namespaces = 1;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+
+	memset(&o,0,sizeof(o));
+	o.concurrent = 1;
+	o.own_values = 1;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+
+	memset(&o,0,sizeof(o));
+	o.concurrent = 1;
+	o.max_chain_length = 8;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+
+	memset(&o,0,sizeof(o));
+	o.max_load_factor = 1;
+	o.min_load_factor = 0.5;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+
+	////////////////////////////////////////
+	//	a single load factor leaves the
+	//		other direction alone
+	////////////////////////////////////////
+	memset(&o,0,sizeof(o));
+	o.min_load_factor = 0.5;
+	ht = ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o);
+	CHECK(ht != 0);
+	for(uint64_t k = 0; k < 64; k++)
+	{
+		CHECK(ht_add(ht,"x",1,&k,sizeof(k)) == HT_SUCCESS);
+	}
+	CHECK(ht_resize_table(ht,64) == HT_SUCCESS);
+	for(uint64_t k = 0; k < 60; k++)
+	{
+		CHECK(ht_remove(ht,&k,sizeof(k)) == HT_SUCCESS);
+	}
+	CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+	CHECK(stats.num_of_buckets < 64);
+	ht_destroy(ht);
+
+	memset(&o,0,sizeof(o));
+	o.layout = HT_LAYOUT_CUCKOO;
+	CHECK(ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,&o) == 0);
+	ht = ht_create_with_options(8,HT_HASH_SIZE_128,seed,0,0,0,&o);
+	CHECK(ht != 0);
+	ht_destroy(ht);
+
+	ht = ht_create_with_options(8,HT_HASH_SIZE_64,seed,0,0,0,0);
+	CHECK(ht != 0);
+	ht_destroy(ht);
+
+	CHECK(ht_find_hash_function("spookyhash") == &ht_hash_spookyhash);
+	CHECK(ht_find_hash_function("mix64") == &ht_hash_mix64);
+	CHECK(ht_find_hash_function("wyhash") == &ht_hash_wyhash);
+	CHECK(ht_find_hash_function("nope") == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	HASH FUNCTIONS AND PREFIXES
+////////////////////////////////////////////////////////////////////////////////
+static
+void
+test_hash_functions
+(
+	void
+)
+{
+	const ht_hash_function_t *functions[] = { &ht_hash_spookyhash, &ht_hash_mix64, &ht_hash_wyhash };
+	unsigned char key[300];
+	uint64_t rng = 5;
+
+	for(size_t j = 0; j < sizeof(key); j++)
+	{
+		key[j] = rnd(&rng);
+	}
+
+	for(size_t f = 0; f < 3; f++)
+	{
+		const ht_hash_function_t *hf = functions[f];
+		for(size_t length = 0; length <= sizeof(key); length += 1 + length / 4)
+		{
+			uint64_t a1, a2, b1, b2;
+			hf->hash(key,length,1,2,&a1,&a2);
+			hf->hash(key,length,1,2,&b1,&b2);
+			CHECK(a1 == b1 && a2 == b2);
+			hf->hash(key,length,3,2,&b1,&b2);
+			CHECK(a1 != b1 || a2 != b2);
+
+			if(hf->init == 0)
+			{
+				continue;
+			}
+
+			////////////////////////////////////////
+			//	a key given in pieces hashes as one
+			uint64_t state[64];
+			CHECK(hf->state_size <= sizeof(state));
+			for(size_t cut = 0; cut <= length; cut += 1 + cut / 2)
+			{
+				hf->init(state,1,2);
+				hf->update(state,key,cut);
+				hf->update(state,key + cut,length - cut);
+				hf->final(state,&b1,&b2);
+				CHECK(a1 == b1 && a2 == b2);
+			}
+		}
+	}
+}
+
+static
+void
+test_prefix
+(
+	void
+)
+{
+	ht_prefix *a = ht_create_prefix("tenant/",7);
+	ht_prefix *b = ht_append_prefix(a,"users/",6);
+	ht_prefix *c = ht_clone_prefix(b);
+	void *bytes;
+	size_t length;
+	long value = 1;
+
+	CHECK(ht_prefix_key(c,&bytes,&length) == HT_SUCCESS);
+	CHECK(length == 13 && memcmp(bytes,"tenant/users/",13) == 0);
+	free(bytes);
+
+	for(size_t h = 0; h < NUM_OF_HASH_SIZES; h++)
+	{
+		ht_t *ht = ht_create_full(16,hash_sizes[h],make_seed(h),0,0,0);
+		void *found;
+		size_t found_length;
+
+		CHECK(ht_add_with_prefix(ht,&value,sizeof(value),"bob",3,c) == HT_SUCCESS);
+		CHECK(ht_get(ht,"tenant/users/bob",16,&found,&found_length) == HT_SUCCESS);
+		CHECK(found == &value);
+		CHECK(ht_get_with_prefix(ht,"users/bob",9,&found,&found_length,a) == HT_SUCCESS);
+		CHECK(ht_add(ht,&value,sizeof(value),"tenant/users/bob",16) == HT_KEY_ALREADY_IN_USE);
+		CHECK(ht_remove_with_prefix(ht,"bob",3,b) == HT_SUCCESS);
+		CHECK(ht_get(ht,"tenant/users/bob",16,&found,&found_length) == HT_KEY_NOT_IN_USE);
+		CHECK(ht_add_with_prefix(ht,&value,sizeof(value),"bob",3,0) == HT_SUCCESS);
+		CHECK(ht_get_with_prefix(ht,"bob",3,&found,&found_length,a) == HT_KEY_NOT_IN_USE);
+		ht_destroy(ht);
+	}
+
+	ht_destroy_prefix(a);
+	ht_destroy_prefix(b);
+	ht_destroy_prefix(c);
+	free(a);
+	free(b);
+	free(c);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	VALUES
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	long	destroyed;
+	long	extra_destroyed;
+} counts_t;
+
+static
+void
+count_value
+(
+	void	*value,
+	void	*extra
+)
+{
+	(void) value;
+	CHECK(((counts_t *) extra)->extra_destroyed == 0);
+	__atomic_fetch_add(&((counts_t *) extra)->destroyed,1,__ATOMIC_RELAXED);
+}
+
+static
+void
+count_extra
+(
+	void	*extra
+)
+{
+	((counts_t *) extra)->extra_destroyed++;
+}
+
+static
+void
+test_destroy_value
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ 0 },
+		{ .max_load_factor = 1, .min_load_factor = 0.25 },
+		{ .inline_key_length = 16, .index_mode = HT_INDEX_MASK },
+		{ .layout = HT_LAYOUT_OPEN },
+		{ .layout = HT_LAYOUT_CUCKOO },
+		{ .concurrent = 1, .max_load_factor = 1 },
+	};
+	static long values[1000];
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		counts_t counts = { 0, 0 };
+		ht_t *ht = ht_create_with_options(8,HT_HASH_SIZE_128,make_seed(c),&counts,
+			count_value,count_extra,&options[c]);
+		CHECK(ht != 0);
+
+		for(long i = 0; i < 1000; i++)
+		{
+			CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		for(long i = 0; i < 100; i++)
+		{
+			CHECK(ht_remove(ht,&i,sizeof(i)) == HT_SUCCESS);
+		}
+		CHECK(ht_clear_table(ht) == HT_SUCCESS);
+		for(long i = 0; i < 500; i++)
+		{
+			CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		ht_destroy(ht);
+
+		CHECK(counts.destroyed == 1500);
+		CHECK(counts.extra_destroyed == 1);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	a concurrent table frees its retired entries on
+//		ht_destroy, their values must be destroyed
+//		while extra is still there
+////////////////////////////////////////////////////////////
+static
+void
+free_extra
+(
+	void	*extra
+)
+{
+	((counts_t *) extra)->extra_destroyed++;
+	free(extra);
+}
+
+static
+void
+test_destroy_order
+(
+	void
+)
+{
+	ht_options_t o = { .concurrent = 1 };
+	counts_t *counts = calloc(1,sizeof(counts_t));
+	ht_t *ht = ht_create_with_options(8,HT_HASH_SIZE_64,make_seed(4),counts,count_value,free_extra,&o);
+	static long values[200];
+
+	for(long i = 0; i < 100; i++)
+	{
+		CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+	}
+	for(long i = 0; i < 100; i++)
+	{
+		CHECK(ht_update(ht,&values[100 + i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+	}
+	ht_destroy(ht);
+}
+
+static
+void
+test_own_values
+(
+	void
+)
+{
+	ht_options_t o = { .own_values = 1, .inline_value_length = 16, .max_load_factor = 1 };
+	ht_t *ht = ht_create_with_options(8,HT_HASH_SIZE_64,make_seed(3),0,0,0,&o);
+	char small[8] = "abcdefg";
+	char large[100];
+	char buffer[100];
+	void *value;
+	size_t length;
+
+	memset(large,'x',sizeof(large));
+	CHECK(ht_add(ht,small,sizeof(small),"s",1) == HT_SUCCESS);
+	CHECK(ht_add(ht,large,sizeof(large),"l",1) == HT_SUCCESS);
+	memset(small,0,sizeof(small));
+	memset(large,0,sizeof(large));
+
+	CHECK(ht_get(ht,"s",1,&value,&length) == HT_SUCCESS);
+	CHECK(length == 8 && memcmp(value,"abcdefg",8) == 0);
+	((char *) value)[0] = 'A';
+	CHECK(ht_get_into(ht,"s",1,buffer,sizeof(buffer),&length) == HT_SUCCESS);
+	CHECK(length == 8 && memcmp(buffer,"Abcdefg",8) == 0);
+
+	CHECK(ht_get_into(ht,"l",1,buffer,10,&length) == HT_BUFFER_TOO_SMALL);
+	CHECK(length == 100);
+	length = 0;
+	CHECK(ht_get_into(ht,"l",1,0,0,&length) == HT_SUCCESS);
+	CHECK(length == 100);
+	CHECK(ht_get_into(ht,"l",1,buffer,sizeof(buffer),&length) == HT_SUCCESS);
+	CHECK(buffer[99] == 'x');
+
+	////////////////////////////////////////
+	//	updates move values between the entry
+	//		and a block of their own
+	CHECK(ht_update(ht,buffer,sizeof(buffer),"s",1) == HT_SUCCESS);
+	CHECK(ht_update(ht,"tiny",5,"l",1) == HT_SUCCESS);
+	CHECK(ht_get(ht,"s",1,&value,&length) == HT_SUCCESS);
+	CHECK(length == 100 && ((char *) value)[50] == 'x');
+	CHECK(ht_get(ht,"l",1,&value,&length) == HT_SUCCESS);
+	CHECK(length == 5 && strcmp(value,"tiny") == 0);
+	CHECK(((uintptr_t) value & 7) == 0);
+
+	ht_destroy(ht);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	RESEEDING
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//	every key collides whatever the seed
+////////////////////////////////////////////////////////////
+static
+void
+constant_hash
+(
+	const void	*key,
+	size_t		 key_length,
+	uint64_t	 seed1,
+	uint64_t	 seed2,
+	uint64_t	*hash1,
+	uint64_t	*hash2
+)
+{
+	(void) key;
+	(void) key_length;
+	(void) seed1;
+	(void) seed2;
+	*hash1 = 42;
+	*hash2 = 42;
+}
+
+static const ht_hash_function_t constant_hash_function = { .name = "constant", .hash = constant_hash };
+
+static
+void
+test_reseed
+(
+	void
+)
+{
+	ht_options_t o = { .max_chain_length = 4 };
+	ht_stats_t stats;
+	long values[2000];
+
+	for(size_t h = 0; h < NUM_OF_HASH_SIZES; h++)
+	{
+		ht_t *ht = ht_create_with_options(16,hash_sizes[h],make_seed(h),0,0,0,&o);
+		CHECK(ht != 0);
+		for(long i = 0; i < 2000; i++)
+		{
+			values[i] = i;
+			CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		for(long i = 0; i < 2000; i++)
+		{
+			void *value;
+			size_t length;
+			CHECK(ht_get(ht,&i,sizeof(i),&value,&length) == HT_SUCCESS);
+			CHECK(value == &values[i]);
+		}
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.reseeds > 0);
+		CHECK(stats.num_of_entries == 2000);
+		ht_destroy(ht);
+	}
+
+	////////////////////////////////////////
+	//	a batch that reseeds part way through
+	//		adds the rest under the new seed
+	{
+		const void *keys[64];
+		size_t key_lengths[64];
+		void *batch[64];
+		size_t value_lengths[64];
+		ht_status_t statuses[64];
+		long ids[64];
+
+		o.max_chain_length = 2;
+		ht_t *ht = ht_create_with_options(4,HT_HASH_SIZE_64,make_seed(1),0,0,0,&o);
+		for(long i = 0; i < 64; i++)
+		{
+			ids[i] = i;
+			keys[i] = &ids[i];
+			key_lengths[i] = sizeof(long);
+			batch[i] = &values[i];
+			value_lengths[i] = sizeof(long);
+		}
+		CHECK(ht_add_many(ht,64,batch,value_lengths,keys,key_lengths,statuses) == HT_SUCCESS);
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.reseeds > 0);
+		for(long i = 0; i < 64; i++)
+		{
+			void *value;
+			size_t length;
+			CHECK(statuses[i] == HT_SUCCESS);
+			CHECK(ht_get(ht,&ids[i],sizeof(long),&value,&length) == HT_SUCCESS);
+			CHECK(value == &values[i]);
+		}
+		ht_destroy(ht);
+	}
+
+	////////////////////////////////////////
+	//	a cleared table reseeds on its first
+	//		long chain again, rather than
+	//		waiting to double the entries it
+	//		had before the clear
+	for(int parallel = 0; parallel < 2; parallel++)
+	{
+		o.max_chain_length = 4;
+		o.hash_function = &constant_hash_function;
+		ht_t *ht = ht_create_with_options(16,HT_HASH_SIZE_64,make_seed(2),0,0,0,&o);
+		CHECK(ht != 0);
+		for(long i = 0; i < 8; i++)
+		{
+			CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.reseeds == 1);
+
+		CHECK((parallel ? ht_parallel_clear_table(ht,2) : ht_clear_table(ht)) == HT_SUCCESS);
+		for(long i = 0; i < 8; i++)
+		{
+			CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.reseeds == 2);
+		ht_destroy(ht);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	STATISTICS
+////////////////////////////////////////////////////////////////////////////////
+static
+void
+test_stats
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ 0 },
+		{ .max_load_factor = 1 },
+		{ .inline_key_length = 8 },
+		{ .layout = HT_LAYOUT_OPEN },
+		{ .layout = HT_LAYOUT_CUCKOO },
+		{ .concurrent = 1, .max_load_factor = 1 },
+		{ .namespaces = 1, .own_values = 1 },
+	};
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		ht_t *ht = ht_create_with_options(1000,HT_HASH_SIZE_128,make_seed(c),0,0,0,&options[c]);
+		ht_stats_t stats;
+		ht_memory_t *m = &stats.memory;
+		static long value;
+		size_t chains = 0;
+
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.num_of_entries == 0);
+		CHECK(stats.empty_buckets == stats.num_of_buckets);
+
+		for(long i = 0; i < 5000; i++)
+		{
+			CHECK(ht_add(ht,&value,sizeof(value),&i,sizeof(i)) == HT_SUCCESS);
+		}
+		CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+		CHECK(stats.num_of_entries == 5000);
+		CHECK(stats.sampled_buckets == stats.num_of_buckets);
+		CHECK(stats.max_chain_length >= 1);
+		CHECK(stats.observed_probe_length >= 1);
+		CHECK(m->table > 0 && m->buckets > 0);
+		CHECK(m->total == m->table + m->buckets + m->entries + m->keys + m->values + m->namespaces);
+		for(size_t i = 0; i < HT_STATS_HISTOGRAM; i++)
+		{
+			chains += stats.chain_lengths[i];
+		}
+		if(options[c].layout == HT_LAYOUT_CHAINED)
+		{
+			CHECK(chains == stats.num_of_buckets);
+			CHECK(stats.chain_lengths[0] == stats.empty_buckets);
+		}
+		else
+		{
+			CHECK(chains == stats.num_of_entries);
+		}
+
+		CHECK(ht_stats(ht,64,&stats) == HT_SUCCESS);
+		CHECK(stats.sampled_buckets <= stats.num_of_buckets);
+		ht_destroy(ht);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	CONCURRENT TABLES
+//	- each writer owns a range of keys and checks them against its own
+//		model, readers look up every range and check that a found value
+//		belongs to its key
+////////////////////////////////////////////////////////////////////////////////
+#define CC_WRITERS	4
+#define CC_READERS	2
+#define CC_KEYS		1000
+#define CC_OPS		40000
+
+typedef struct
+{
+	ht_t		*ht;
+	long		 values[CC_WRITERS * CC_KEYS][4];
+	int		 stop;
+} cc_test_t;
+
+typedef struct
+{
+	cc_test_t	*test;
+	long		 thread;
+} cc_thread_t;
+
+static
+void *
+cc_writer
+(
+	void	*arg
+)
+{
+	cc_thread_t *t = arg;
+	cc_test_t *test = t->test;
+	uint64_t rng = t->thread * 7919 + 1;
+	static __thread int present[CC_KEYS];
+
+	memset(present,0,sizeof(present));
+	for(int op = 0; op < CC_OPS; op++)
+	{
+		int k = rnd(&rng) % CC_KEYS;
+		long id = t->thread * CC_KEYS + k;
+		void *value;
+		size_t length;
+		ht_status_t status;
+
+		switch(rnd(&rng) % 4)
+		{
+		case 0:
+			status = ht_add(test->ht,&test->values[id][op & 3],sizeof(long),&id,sizeof(id));
+			CHECK(status == (present[k] ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS));
+			present[k] = 1;
+			break;
+		case 1:
+			status = ht_remove(test->ht,&id,sizeof(id));
+			CHECK(status == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+			present[k] = 0;
+			break;
+		case 2:
+			CHECK(ht_update(test->ht,&test->values[id][(op + 1) & 3],sizeof(long),&id,sizeof(id)) == HT_SUCCESS);
+			present[k] = 1;
+			break;
+		default:
+			status = ht_get(test->ht,&id,sizeof(id),&value,&length);
+			CHECK(status == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+			if(status == HT_SUCCESS)
+			{
+				CHECK((long *) value - test->values[id] >= 0 && (long *) value - test->values[id] < 4);
+			}
+			break;
+		}
+
+		if(t->thread == 0 && op % 10000 == 5000)
+		{
+			CHECK(ht_resize_table(test->ht,64 + rnd(&rng) % 4096) == HT_SUCCESS);
+		}
+	}
+	return 0;
+}
+
+static
+void
+cc_reader_visit
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	cc_test_t *test = context;
+	long id;
+	(void) value_length;
+	(void) index;
+
+	CHECK(key_length == sizeof(long));
+	memcpy(&id,key,sizeof(id));
+	CHECK(id >= 0 && id < CC_WRITERS * CC_KEYS);
+	CHECK((long *) value - test->values[id] >= 0 && (long *) value - test->values[id] < 4);
+}
+
+static
+void *
+cc_reader
+(
+	void	*arg
+)
+{
+	cc_thread_t *t = arg;
+	cc_test_t *test = t->test;
+	uint64_t rng = t->thread * 104729 + 3;
+
+	while(!__atomic_load_n(&test->stop,__ATOMIC_ACQUIRE))
+	{
+		for(int q = 0; q < 1000; q++)
+		{
+			long id = rnd(&rng) % (CC_WRITERS * CC_KEYS);
+			void *value;
+			size_t length;
+			ht_status_t status = ht_get(test->ht,&id,sizeof(id),&value,&length);
+			CHECK(status == HT_SUCCESS || status == HT_KEY_NOT_IN_USE);
+			if(status == HT_SUCCESS)
+			{
+				CHECK((long *) value - test->values[id] >= 0 && (long *) value - test->values[id] < 4);
+			}
+		}
+
+		ht_cursor_t cursor = { 0 };
+		for(int calls = 0; calls < 20 && !cursor.finished; calls++)
+		{
+			CHECK(ht_cursor_next(test->ht,&cursor,50,cc_reader_visit,test) == HT_SUCCESS);
+		}
+		CHECK(ht_iterate_with_context(test->ht,cc_reader_visit,test) == HT_SUCCESS);
+	}
+	return 0;
+}
+
+static
+void
+test_concurrent
+(
+	void
+)
+{
+	static const ht_index_mode_t modes[] = { HT_INDEX_MODULO, HT_INDEX_MASK, HT_INDEX_FASTRANGE };
+
+	for(size_t m = 0; m < 3; m++)
+	{
+		static cc_test_t test;
+		ht_options_t o = { .concurrent = 1, .max_load_factor = 1, .min_load_factor = 0.1,
+			.index_mode = modes[m] };
+		pthread_t threads[CC_WRITERS + CC_READERS];
+		cc_thread_t args[CC_WRITERS + CC_READERS];
+
+		memset(&test,0,sizeof(test));
+		test.ht = ht_create_with_options(16,HT_HASH_SIZE_64,make_seed(m),0,0,0,&o);
+		CHECK(test.ht != 0);
+
+		for(long i = 0; i < CC_WRITERS + CC_READERS; i++)
+		{
+			args[i].test = &test;
+			args[i].thread = i;
+			CHECK(pthread_create(&threads[i],0,i < CC_WRITERS ? cc_writer : cc_reader,&args[i]) == 0);
+		}
+		for(int i = 0; i < CC_WRITERS; i++)
+		{
+			pthread_join(threads[i],0);
+		}
+		__atomic_store_n(&test.stop,1,__ATOMIC_RELEASE);
+		for(int i = CC_WRITERS; i < CC_WRITERS + CC_READERS; i++)
+		{
+			pthread_join(threads[i],0);
+		}
+		ht_destroy(test.ht);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	BULK LOADING
+////////////////////////////////////////////////////////////////////////////////
+#define BULK_RECORDS	20000
+#define BULK_KEYS	(BULK_RECORDS / 2)
+
+typedef struct
+{
+	const ht_record_t	*records;
+	size_t			 position;
+} bulk_source_t;
+
+static
+int
+bulk_next
+(
+	ht_record_t	*record,
+	void		*context
+)
+{
+	bulk_source_t *source = context;
+	if(source->position >= BULK_RECORDS)
+	{
+		return 0;
+	}
+	*record = source->records[source->position++];
+	return 1;
+}
+
+static
+void
+test_bulk_load
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ 0 },
+		{ .layout = HT_LAYOUT_OPEN },
+		{ .max_load_factor = 0.75 },
+		{ .inline_key_length = 16, .index_mode = HT_INDEX_MASK, .max_load_factor = 1 },
+		{ .concurrent = 1 },
+		{ .index_mode = HT_INDEX_FASTRANGE, .max_load_factor = 2, .min_load_factor = 0.1 },
+		{ .hash_function = &ht_hash_wyhash, .inline_key_length = 8 },
+	};
+	static char keys[BULK_RECORDS][16];
+	static long values[BULK_RECORDS];
+	static long preloaded[BULK_KEYS];
+	static ht_record_t records[BULK_RECORDS];
+	static ht_status_t statuses[BULK_RECORDS];
+	static long expected[BULK_KEYS];
+	static int present[BULK_KEYS];
+	uint64_t rng = 11;
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		for(int duplicates = HT_DUPLICATES_REJECT; duplicates <= HT_DUPLICATES_KEEP_LAST; duplicates++)
+		{
+			for(unsigned int threads = 1; threads <= 4; threads *= 2)
+			{
+				ht_t *ht = ht_create_with_options(100,hash_sizes[(c + threads) % NUM_OF_HASH_SIZES],
+					make_seed(c),0,0,0,&options[c]);
+				ht_prefix *prefix = threads == 2 ? ht_create_prefix("tenant/",7) : 0;
+				ht_status_t status, first = HT_SUCCESS;
+				size_t count = 0;
+
+				memset(present,0,sizeof(present));
+				for(int k = 0; k < BULK_KEYS; k += 7)
+				{
+					char key[16];
+					snprintf(key,sizeof(key),"key-%d",k);
+					preloaded[k] = -k;
+					CHECK(ht_add_with_prefix(ht,&preloaded[k],sizeof(long),key,strlen(key),prefix) == HT_SUCCESS);
+					present[k] = 1;
+					expected[k] = -k;
+				}
+
+				for(int i = 0; i < BULK_RECORDS; i++)
+				{
+					int k = rnd(&rng) % BULK_KEYS;
+					snprintf(keys[i],sizeof(keys[i]),"key-%d",k);
+					values[i] = i;
+					records[i] = (ht_record_t) { keys[i], strlen(keys[i]), &values[i], sizeof(long) };
+					if(!present[k])
+					{
+						present[k] = 1;
+						expected[k] = i;
+					}
+					else if(duplicates == HT_DUPLICATES_KEEP_LAST)
+					{
+						expected[k] = i;
+					}
+					else if(duplicates == HT_DUPLICATES_REJECT && first == HT_SUCCESS)
+					{
+						first = HT_KEY_ALREADY_IN_USE;
+					}
+				}
+
+				if(prefix == 0 && duplicates == HT_DUPLICATES_KEEP_FIRST)
+				{
+					bulk_source_t source = { records, 0 };
+					status = ht_bulk_load_from(ht,bulk_next,&source,duplicates,threads);
+				}
+				else
+				{
+					status = ht_bulk_load_with_prefix(ht,records,BULK_RECORDS,duplicates,threads,statuses,prefix);
+				}
+				CHECK(status == first);
+
+				for(int k = 0; k < BULK_KEYS; k++)
+				{
+					char key[16];
+					void *value;
+					size_t length;
+					snprintf(key,sizeof(key),"key-%d",k);
+					status = ht_get_with_prefix(ht,key,strlen(key),&value,&length,prefix);
+					CHECK(status == (present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+					if(status == HT_SUCCESS)
+					{
+						CHECK(*(long *) value == expected[k]);
+						count++;
+					}
+				}
+
+				ht_stats_t stats;
+				CHECK(ht_stats(ht,0,&stats) == HT_SUCCESS);
+				CHECK(stats.num_of_entries == count);
+
+				ht_destroy(ht);
+				if(prefix)
+				{
+					ht_destroy_prefix(prefix);
+					free(prefix);
+				}
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	PARALLEL ITERATE, CLEAR AND DESTROY
+////////////////////////////////////////////////////////////////////////////////
+#define PARALLEL_ENTRIES	50000
+
+static
+void
+parallel_sum
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	long *sum = context;
+	(void) value_length;
+	(void) key;
+	(void) key_length;
+	(void) index;
+
+	sum[0] += *(long *) value;
+	sum[1]++;
+}
+
+static
+void
+test_parallel
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ 0 },
+		{ .max_load_factor = 1 },
+		{ .inline_key_length = 16 },
+		{ .layout = HT_LAYOUT_OPEN },
+		{ .layout = HT_LAYOUT_CUCKOO },
+		{ .concurrent = 1, .max_load_factor = 1 },
+	};
+	static long values[PARALLEL_ENTRIES];
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		for(unsigned int threads = 0; threads <= 4; threads += 2)
+		{
+			counts_t counts = { 0, 0 };
+			ht_t *ht = ht_create_with_options(1000,HT_HASH_SIZE_128,make_seed(c),&counts,
+				count_value,0,&options[c]);
+			long sums[4][2];
+			void *contexts[4] = { sums[0], sums[1], sums[2], sums[3] };
+			long sum = 0, count = 0;
+
+			for(long i = 0; i < PARALLEL_ENTRIES; i++)
+			{
+				values[i] = i;
+				CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+			}
+
+			memset(sums,0,sizeof(sums));
+			CHECK(ht_parallel_iterate(ht,threads ? threads : 1,parallel_sum,contexts) == HT_SUCCESS);
+			for(int t = 0; t < 4; t++)
+			{
+				sum += sums[t][0];
+				count += sums[t][1];
+			}
+			CHECK(count == PARALLEL_ENTRIES);
+			CHECK(sum == (long) PARALLEL_ENTRIES * (PARALLEL_ENTRIES - 1) / 2);
+
+			////////////////////////////////////////
+			//	concurrent tables destroy the values
+			//		of removed entries later on
+			CHECK(ht_parallel_clear_table(ht,threads) == HT_SUCCESS);
+			CHECK(counts.destroyed == PARALLEL_ENTRIES || options[c].concurrent);
+			for(long i = 0; i < 1000; i++)
+			{
+				CHECK(ht_add(ht,&values[i],sizeof(long),&i,sizeof(i)) == HT_SUCCESS);
+			}
+			ht_parallel_destroy(ht,threads);
+			CHECK(counts.destroyed == PARALLEL_ENTRIES + 1000);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	CURSORS
+//	- the table changes between calls, every key there for the whole walk
+//		must be seen
+////////////////////////////////////////////////////////////////////////////////
+#define CURSOR_STAYING	3000
+#define CURSOR_CHURN	6000
+
+static
+void
+cursor_visit
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	int *seen = context;
+	(void) value_length;
+	(void) key;
+	(void) key_length;
+	(void) index;
+
+	seen[*(int *) value]++;
+}
+
+static
+void
+test_cursor
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ .max_load_factor = 1, .min_load_factor = 0.25 },
+		{ .max_load_factor = 1, .min_load_factor = 0.25, .index_mode = HT_INDEX_MASK },
+		{ .max_load_factor = 1, .min_load_factor = 0.25, .index_mode = HT_INDEX_FASTRANGE },
+		{ .inline_key_length = 16, .index_mode = HT_INDEX_FASTRANGE, .max_load_factor = 1 },
+		{ .index_mode = HT_INDEX_MASK },
+		{ .layout = HT_LAYOUT_OPEN },
+		{ .layout = HT_LAYOUT_CUCKOO },
+		{ .concurrent = 1, .max_load_factor = 1, .min_load_factor = 0.25 },
+		{ .concurrent = 1, .max_load_factor = 1, .min_load_factor = 0.25, .index_mode = HT_INDEX_MASK },
+	};
+	static int ids[CURSOR_STAYING + CURSOR_CHURN];
+	static int seen[CURSOR_STAYING + CURSOR_CHURN];
+	static int in[CURSOR_STAYING + CURSOR_CHURN];
+	uint64_t rng = 7;
+
+	for(int i = 0; i < CURSOR_STAYING + CURSOR_CHURN; i++)
+	{
+		ids[i] = i;
+	}
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		int hash_order = options[c].index_mode != HT_INDEX_MODULO && options[c].layout == HT_LAYOUT_CHAINED;
+		ht_t *ht = ht_create_with_options(8,HT_HASH_SIZE_128,make_seed(c),0,0,0,&options[c]);
+		ht_cursor_t cursor = { 0 };
+		int calls = 0;
+
+		memset(in,0,sizeof(in));
+		memset(seen,0,sizeof(seen));
+		for(int i = 0; i < CURSOR_STAYING; i++)
+		{
+			char key[16];
+			snprintf(key,sizeof(key),"s%d",i);
+			CHECK(ht_add(ht,&ids[i],sizeof(int),key,strlen(key)) == HT_SUCCESS);
+		}
+
+		////////////////////////////////////////
+		//	tables that start over on a resize
+		//		only change now and then, or the
+		//		walk would never finish
+		while(!cursor.finished)
+		{
+			CHECK(ht_cursor_next(ht,&cursor,7,cursor_visit,seen) == HT_SUCCESS);
+			calls++;
+			CHECK(calls < 1000000);
+
+			int changes = hash_order ? 3 : calls % 50 == 0;
+			for(int q = 0; q < changes; q++)
+			{
+				int i = CURSOR_STAYING + rnd(&rng) % CURSOR_CHURN;
+				char key[16];
+				snprintf(key,sizeof(key),"x%d",i);
+				if(in[i])
+				{
+					CHECK(ht_remove(ht,key,strlen(key)) == HT_SUCCESS);
+				}
+				else
+				{
+					CHECK(ht_add(ht,&ids[i],sizeof(int),key,strlen(key)) == HT_SUCCESS);
+				}
+				in[i] = !in[i];
+			}
+			if(hash_order && rnd(&rng) % 200 == 0)
+			{
+				CHECK(ht_resize_table(ht,1 + rnd(&rng) % 20000) == HT_SUCCESS);
+			}
+		}
+
+		for(int i = 0; i < CURSOR_STAYING; i++)
+		{
+			CHECK(seen[i] >= 1);
+		}
+
+		////////////////////////////////////////
+		//	a finished cursor stays finished
+		CHECK(ht_cursor_next(ht,&cursor,7,cursor_visit,seen) == HT_SUCCESS);
+		CHECK(cursor.finished);
+		ht_destroy(ht);
+	}
+}
+
+////////////////////////////////////////////////////////////
+//	cursors over a concurrent table another thread keeps
+//		resizing, a walk that finishes must have seen
+//		every key
+////////////////////////////////////////////////////////////
+#define CC_CURSOR_KEYS	4000
+
+typedef struct
+{
+	ht_t	*ht;
+	int	 stop;
+	long	 resizes;
+} cc_resizer_t;
+
+static
+void *
+cc_resizer
+(
+	void	*arg
+)
+{
+	cc_resizer_t *c = arg;
+	uint64_t rng = 99;
+
+	while(!__atomic_load_n(&c->stop,__ATOMIC_ACQUIRE))
+	{
+		CHECK(ht_resize_table(c->ht,500 + rnd(&rng) % 8000) == HT_SUCCESS);
+		__atomic_fetch_add(&c->resizes,1,__ATOMIC_RELAXED);
+		usleep(rnd(&rng) % 200);
+	}
+	return 0;
+}
+
+static
+void
+test_cursor_concurrent
+(
+	void
+)
+{
+	static const ht_index_mode_t modes[] = { HT_INDEX_MODULO, HT_INDEX_MASK, HT_INDEX_FASTRANGE };
+	static int ids[CC_CURSOR_KEYS];
+	static int seen[CC_CURSOR_KEYS];
+
+	for(int i = 0; i < CC_CURSOR_KEYS; i++)
+	{
+		ids[i] = i;
+	}
+
+	for(size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+	{
+		ht_options_t o = { .concurrent = 1, .index_mode = modes[m] };
+		cc_resizer_t resizer = { ht_create_with_options(1000,HT_HASH_SIZE_64,make_seed(m),0,0,0,&o), 0, 0 };
+		pthread_t thread;
+		int walks = 0;
+
+		for(int i = 0; i < CC_CURSOR_KEYS; i++)
+		{
+			CHECK(ht_add(resizer.ht,&ids[i],sizeof(int),&ids[i],sizeof(int)) == HT_SUCCESS);
+		}
+		CHECK(pthread_create(&thread,0,cc_resizer,&resizer) == 0);
+
+		for(int attempt = 0; attempt < 20000
+			&& (walks < 100 || __atomic_load_n(&resizer.resizes,__ATOMIC_RELAXED) < 500); attempt++)
+		{
+			ht_cursor_t cursor = { 0 };
+			memset(seen,0,sizeof(seen));
+			for(int calls = 0; calls < 5000 && !cursor.finished; calls++)
+			{
+				CHECK(ht_cursor_next(resizer.ht,&cursor,64,cursor_visit,seen) == HT_SUCCESS);
+			}
+			if(!cursor.finished)
+			{
+				continue;
+			}
+			for(int i = 0; i < CC_CURSOR_KEYS; i++)
+			{
+				CHECK(seen[i] >= 1);
+			}
+			walks++;
+		}
+		CHECK(walks > 0);
+
+		__atomic_store_n(&resizer.stop,1,__ATOMIC_RELEASE);
+		pthread_join(thread,0);
+		ht_destroy(resizer.ht);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	NAMESPACES
+////////////////////////////////////////////////////////////////////////////////
+#define NS_TENANTS	10
+#define NS_KEYS		300
+
+typedef struct
+{
+	int	tenant;
+	int	seen[NS_KEYS];
+} ns_visit_t;
+
+static
+void
+ns_visit
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	ns_visit_t *v = context;
+	int id = *(int *) value;
+	char prefix[16];
+	(void) value_length;
+	(void) index;
+
+	snprintf(prefix,sizeof(prefix),"tenant%02d/",v->tenant);
+	CHECK(key_length > 9 && memcmp(key,prefix,9) == 0);
+	CHECK(id / NS_KEYS == v->tenant);
+	v->seen[id % NS_KEYS]++;
+}
+
+static
+void
+test_namespaces
+(
+	void
+)
+{
+	static const ht_options_t options[] =
+	{
+		{ .namespaces = 1, .max_load_factor = 1, .min_load_factor = 0.2 },
+		{ .namespaces = 1, .inline_key_length = 24 },
+		{ .namespaces = 1, .index_mode = HT_INDEX_MASK, .max_load_factor = 1 },
+		{ .namespaces = 1, .own_values = 1 },
+	};
+	static int ids[NS_TENANTS * NS_KEYS];
+	static int present[NS_TENANTS][NS_KEYS];
+	uint64_t rng = 3;
+
+	for(int i = 0; i < NS_TENANTS * NS_KEYS; i++)
+	{
+		ids[i] = i;
+	}
+
+	for(size_t c = 0; c < sizeof(options) / sizeof(options[0]); c++)
+	{
+		ht_t *ht = ht_create_with_options(4,HT_HASH_SIZE_64,make_seed(c),0,0,0,&options[c]);
+		ht_prefix *prefixes[NS_TENANTS];
+		ns_visit_t visit;
+
+		CHECK(ht != 0);
+		memset(present,0,sizeof(present));
+		for(int t = 0; t < NS_TENANTS; t++)
+		{
+			char name[16];
+			snprintf(name,sizeof(name),"tenant%02d/",t);
+			prefixes[t] = ht_create_prefix(name,strlen(name));
+		}
+
+		for(int op = 0; op < 50000; op++)
+		{
+			int t = rnd(&rng) % NS_TENANTS;
+			int k = rnd(&rng) % NS_KEYS;
+			char key[32];
+			size_t removed;
+			ht_status_t status;
+
+			snprintf(key,sizeof(key),"k%d",k);
+			switch(rnd(&rng) % 8)
+			{
+			case 0:
+			case 1:
+			case 2:
+				status = ht_add_with_prefix(ht,&ids[t * NS_KEYS + k],sizeof(int),key,strlen(key),prefixes[t]);
+				CHECK(status == (present[t][k] ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS));
+				present[t][k] = 1;
+				break;
+			case 3:
+				status = ht_remove_with_prefix(ht,key,strlen(key),prefixes[t]);
+				CHECK(status == (present[t][k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+				present[t][k] = 0;
+				break;
+			case 4:
+				////////////////////////////////////////
+				//	removing the full key takes it out
+				//		of its namespace too
+				snprintf(key,sizeof(key),"tenant%02d/k%d",t,k);
+				status = ht_remove(ht,key,strlen(key));
+				CHECK(status == (present[t][k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+				present[t][k] = 0;
+				break;
+			case 5:
+				if(rnd(&rng) % 20 == 0)
+				{
+					size_t expected = 0;
+					for(int q = 0; q < NS_KEYS; q++)
+					{
+						expected += present[t][q];
+					}
+					CHECK(ht_remove_namespace(ht,prefixes[t],&removed) == HT_SUCCESS);
+					CHECK(removed == expected);
+					memset(present[t],0,sizeof(present[t]));
+				}
+				break;
+			case 6:
+				if(rnd(&rng) % 20 == 0)
+				{
+					memset(&visit,0,sizeof(visit));
+					visit.tenant = t;
+					CHECK(ht_iterate_namespace(ht,prefixes[t],ns_visit,&visit) == HT_SUCCESS);
+					for(int q = 0; q < NS_KEYS; q++)
+					{
+						CHECK(visit.seen[q] == present[t][q]);
+					}
+				}
+				break;
+			default:
+				if(rnd(&rng) % 2000 == 0)
+				{
+					CHECK(ht_resize_table(ht,1 + rnd(&rng) % 3000) == HT_SUCCESS);
+				}
+				break;
+			}
+		}
+
+		////////////////////////////////////////
+		//	a key added without a prefix is in no
+		//		namespace
+		CHECK(ht_add(ht,&ids[0],sizeof(int),"tenant03/zz",11) == HT_SUCCESS);
+		for(int t = 0; t < NS_TENANTS; t++)
+		{
+			memset(&visit,0,sizeof(visit));
+			visit.tenant = t;
+			CHECK(ht_iterate_namespace(ht,prefixes[t],ns_visit,&visit) == HT_SUCCESS);
+			for(int q = 0; q < NS_KEYS; q++)
+			{
+				CHECK(visit.seen[q] == present[t][q]);
+			}
+			CHECK(ht_remove_namespace(ht,prefixes[t],0) == HT_SUCCESS);
+		}
+		void *value;
+		size_t length;
+		CHECK(ht_get(ht,"tenant03/zz",11,&value,&length) == HT_SUCCESS);
+
+		ht_destroy(ht);
+		for(int t = 0; t < NS_TENANTS; t++)
+		{
+			ht_destroy_prefix(prefixes[t]);
+			free(prefixes[t]);
+		}
+	}
+
+	ht_t *plain = ht_create_full(4,HT_HASH_SIZE_64,make_seed(1),0,0,0);
+	ht_prefix *prefix = ht_create_prefix("a",1);
+	CHECK(ht_remove_namespace(plain,prefix,0) == HT_NO_NAMESPACES);
+	CHECK(ht_iterate_namespace(plain,prefix,ns_visit,0) == HT_NO_NAMESPACES);
+	ht_destroy(plain);
+	ht_destroy_prefix(prefix);
+	free(prefix);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	SHARDED TABLES
+////////////////////////////////////////////////////////////////////////////////
+#define SHARD_THREADS	4
+#define SHARD_KEYS	2000
+
+typedef struct
+{
+	ht_sharded_t	*table;
+	long		 thread;
+	long		 values[SHARD_KEYS];
+	int		 present[SHARD_KEYS];
+} shard_thread_t;
+
+static
+void *
+shard_worker
+(
+	void	*arg
+)
+{
+	shard_thread_t *t = arg;
+	uint64_t rng = t->thread + 17;
+
+	for(int op = 0; op < 30000; op++)
+	{
+		int k = rnd(&rng) % SHARD_KEYS;
+		long id = t->thread * SHARD_KEYS + k;
+		ht_status_t status;
+		long value;
+		size_t length;
+
+		switch(rnd(&rng) % 4)
+		{
+		case 0:
+			status = ht_sharded_add(t->table,&t->values[k],sizeof(long),&id,sizeof(id));
+			CHECK(status == (t->present[k] ? HT_KEY_ALREADY_IN_USE : HT_SUCCESS));
+			t->present[k] = 1;
+			break;
+		case 1:
+			status = ht_sharded_remove(t->table,&id,sizeof(id));
+			CHECK(status == (t->present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+			t->present[k] = 0;
+			break;
+		case 2:
+			CHECK(ht_sharded_update(t->table,&t->values[k],sizeof(long),&id,sizeof(id)) == HT_SUCCESS);
+			t->present[k] = 1;
+			break;
+		default:
+			status = ht_sharded_get_into(t->table,&id,sizeof(id),&value,sizeof(value),&length);
+			CHECK(status == (t->present[k] ? HT_SUCCESS : HT_KEY_NOT_IN_USE));
+			if(status == HT_SUCCESS)
+			{
+				CHECK(length == sizeof(long) && value == id);
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
+static
+void
+shard_count
+(
+	void	*value,
+	size_t	 value_length,
+	void	*key,
+	size_t	 key_length,
+	size_t	 index,
+	void	*context
+)
+{
+	(void) value;
+	(void) value_length;
+	(void) key;
+	(void) key_length;
+	(void) index;
+	(*(size_t *) context)++;
+}
+
+static
+void
+test_sharded
+(
+	void
+)
+{
+	static shard_thread_t args[SHARD_THREADS];
+	ht_options_t o = { .max_load_factor = 1, .min_load_factor = 0.25 };
+	ht_sharded_t *table = ht_sharded_create(8,64,HT_HASH_SIZE_128,make_seed(9),0,0,0,&o);
+	pthread_t threads[SHARD_THREADS];
+	size_t counts[SHARD_THREADS] = { 0 };
+	void *contexts[SHARD_THREADS];
+	size_t expected = 0, visited = 0;
+	ht_stats_t stats;
+
+	CHECK(table != 0);
+	for(long i = 0; i < SHARD_THREADS; i++)
+	{
+		args[i].table = table;
+		args[i].thread = i;
+		for(int k = 0; k < SHARD_KEYS; k++)
+		{
+			args[i].values[k] = i * SHARD_KEYS + k;
+		}
+		CHECK(pthread_create(&threads[i],0,shard_worker,&args[i]) == 0);
+	}
+	for(int i = 0; i < SHARD_THREADS; i++)
+	{
+		pthread_join(threads[i],0);
+		contexts[i] = &counts[i];
+		for(int k = 0; k < SHARD_KEYS; k++)
+		{
+			expected += args[i].present[k];
+		}
+	}
+
+	CHECK(ht_sharded_stats(table,0,&stats) == HT_SUCCESS);
+	CHECK(stats.num_of_entries == expected);
+	CHECK(ht_sharded_parallel_iterate(table,SHARD_THREADS,shard_count,contexts) == HT_SUCCESS);
+	for(int i = 0; i < SHARD_THREADS; i++)
+	{
+		visited += counts[i];
+	}
+	CHECK(visited == expected);
+
+	CHECK(ht_sharded_resize_table(table,100000) == HT_SUCCESS);
+	CHECK(ht_sharded_stats(table,0,&stats) == HT_SUCCESS);
+	CHECK(stats.num_of_entries == expected);
+	CHECK(ht_sharded_clear_table(table) == HT_SUCCESS);
+	CHECK(ht_sharded_stats(table,0,&stats) == HT_SUCCESS);
+	CHECK(stats.num_of_entries == 0);
+	ht_sharded_destroy(table);
+
+	o.concurrent = 1;
+	CHECK(ht_sharded_create(8,64,HT_HASH_SIZE_128,make_seed(9),0,0,0,&o) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	INSTRUMENTATION
+////////////////////////////////////////////////////////////////////////////////
+static
+void
+test_instrument
+(
+	void
+)
+{
+	static ht_op_stats_t stats[HT_NUM_OF_OPS];
+	ht_t *ht = ht_create_full(16,HT_HASH_SIZE_64,make_seed(2),0,0,0);
+	static long value;
+
+#ifndef HT_INSTRUMENT
+	CHECK(ht_instrument_read(stats) == HT_NOT_INSTRUMENTED);
+	CHECK(ht_instrument_reset() == HT_NOT_INSTRUMENTED);
+#else
+	CHECK(ht_instrument_reset() == HT_SUCCESS);
+#endif
+	for(long i = 0; i < 10000; i++)
+	{
+		CHECK(ht_add(ht,&value,sizeof(value),&i,sizeof(i)) == HT_SUCCESS);
+	}
+	for(long i = 0; i < 100000; i++)
+	{
+		long key = i % 10000;
+		void *found;
+		size_t length;
+		CHECK(ht_get(ht,&key,sizeof(key),&found,&length) == HT_SUCCESS);
+	}
+	CHECK(ht_resize_table(ht,20000) == HT_SUCCESS);
+	ht_destroy(ht);
+
+#ifdef HT_INSTRUMENT
+	CHECK(ht_instrument_read(stats) == HT_SUCCESS);
+	CHECK(stats[HT_OP_ADD].sampled >= 10000 / 100 - 1);
+	CHECK(stats[HT_OP_GET].sampled >= 100000 / 100 - 1);
+	CHECK(stats[HT_OP_RESIZE].sampled >= 1);
+	CHECK(stats[HT_OP_GET].timed >= 100000 / 10000 - 1);
+	CHECK(stats[HT_OP_GET].timed <= stats[HT_OP_GET].sampled);
+	CHECK(stats[HT_OP_RESIZE].timed == stats[HT_OP_RESIZE].sampled);
+	CHECK(stats[HT_OP_GET].probes >= stats[HT_OP_GET].sampled);
+	for(int op = 0; op < HT_NUM_OF_OPS; op++)
+	{
+		uint64_t latencies = 0, probes = 0;
+		for(int b = 0; b < HT_LATENCY_BUCKETS; b++)
+		{
+			latencies += stats[op].latency[b];
+		}
+		CHECK(latencies == stats[op].timed);
+		if(op == HT_OP_RESIZE)
+		{
+			continue;
+		}
+		for(int b = 0; b < HT_PROBE_BUCKETS; b++)
+		{
+			probes += stats[op].probe_counts[b];
+		}
+		CHECK(probes == stats[op].sampled);
+	}
+	CHECK(ht_latency_bucket_floor(0) == 0);
+	CHECK(ht_latency_bucket_floor(4) == 4);
+	for(size_t b = 1; b < HT_LATENCY_BUCKETS; b++)
+	{
+		CHECK(ht_latency_bucket_floor(b) > ht_latency_bucket_floor(b - 1));
+	}
+	CHECK(ht_instrument_reset() == HT_SUCCESS);
+	CHECK(ht_instrument_read(stats) == HT_SUCCESS);
+	CHECK(stats[HT_OP_ADD].sampled == 0);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//	MAIN
+////////////////////////////////////////////////////////////////////////////////
+static const struct
+{
+	const char	*name;
+	void		(*run)(void);
+} tests[] =
+{
+	{ "options",		test_options },
+	{ "hash_functions",	test_hash_functions },
+	{ "prefix",		test_prefix },
+	{ "model",		test_model },
+	{ "destroy_value",	test_destroy_value },
+	{ "destroy_order",	test_destroy_order },
+	{ "own_values",		test_own_values },
+	{ "reseed",		test_reseed },
+	{ "stats",		test_stats },
+	{ "concurrent",		test_concurrent },
+	{ "bulk_load",		test_bulk_load },
+	{ "parallel",		test_parallel },
+	{ "cursor",		test_cursor },
+	{ "cursor_concurrent",	test_cursor_concurrent },
+	{ "namespaces",		test_namespaces },
+	{ "sharded",		test_sharded },
+	{ "instrument",		test_instrument },
+};
+
+int
+main
+(
+	int	 argc,
+	char	**argv
+)
+{
+	size_t run = 0;
+
+	for(size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++)
+	{
+		int wanted = argc < 2;
+		for(int a = 1; a < argc; a++)
+		{
+			wanted |= strcmp(argv[a],tests[t].name) == 0;
+		}
+		if(!wanted)
+		{
+			continue;
+		}
+		printf("%s\n",tests[t].name);
+		fflush(stdout);
+		tests[t].run();
+		run++;
+	}
+
+	if(run == 0)
+	{
+		fprintf(stderr,"no test named %s\n",argv[1]);
+		return 1;
+	}
+	printf("%zu tests passed\n",run);
+	return 0;
+}